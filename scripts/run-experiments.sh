@@ -119,6 +119,7 @@ run_experiment() {
         --detector "$detector" \
         --ransac-threshold "$threshold" \
         --blend-mode "$blend" \
+        --diagnostics full \
         --output "$output" 2>&1)
 
     if echo "$exp_output" | grep -q "Panorama saved"; then
@@ -172,6 +173,7 @@ run_multi_experiment() {
 
     local exp_output=$(./scripts/run_panorama.sh --stitch-multiple "$img1" "$img2" "$img3" \
         --detector "$detector" \
+        --diagnostics full \
         --output "$output" 2>&1)
 
     if echo "$exp_output" | grep -q "Panorama saved\|created successfully"; then
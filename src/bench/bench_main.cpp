@@ -0,0 +1,366 @@
+#include "benchmark.h"
+#include "../feature_detection/detector_factory.h"
+#include "../feature_matching/matcher.h"
+#include "../feature_matching/ransac.h"
+#include "../homography/homography_estimator.h"
+#include "../kernels/kernel_dispatch.h"
+#include "../stitching/image_warper.h"
+#include "../stitching/blender_factory.h"
+#include <opencv2/imgproc.hpp>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct BenchArguments {
+    std::vector<cv::Size> resolutions = {{1280, 720}, {1920, 1080}};
+    std::vector<int> feature_counts = {2000, 8000};
+    int warmup = 2;
+    int iterations = 10;
+    double min_time_ms = 200.0;
+    std::string filter;
+    std::string output_path = "bench_results.csv";
+    std::string baseline_path;
+    std::string isa;
+    double threshold = 0.1;
+    bool show_help = false;
+};
+
+// Synthetic pair with a known homography between the views: a blurred
+// noise texture with random shapes, seen once directly and once through a
+// shift to the right with a slight rotation and perspective.
+struct BenchScene {
+    cv::Mat img1;
+    cv::Mat img2;
+    cv::Mat homography;  // img1 -> img2
+};
+
+BenchScene makeScene(const cv::Size& size, uint64 seed) {
+    cv::RNG rng(seed);
+    cv::Size world_size(size.width * 3 / 2, size.height);
+
+    cv::Mat noise(world_size, CV_8UC3);
+    rng.fill(noise, cv::RNG::UNIFORM, 0, 256);
+    cv::Mat world;
+    cv::GaussianBlur(noise, world, cv::Size(0, 0), 2.0);
+
+    int shapes = world_size.area() / 4000;
+    for (int i = 0; i < shapes; i++) {
+        cv::Point centre(rng.uniform(0, world_size.width), rng.uniform(0, world_size.height));
+        cv::Scalar colour(rng.uniform(0, 256), rng.uniform(0, 256), rng.uniform(0, 256));
+        int radius = rng.uniform(3, 30);
+        if (i % 2) {
+            cv::circle(world, centre, radius, colour, cv::FILLED, cv::LINE_AA);
+        } else {
+            cv::rectangle(world, cv::Rect(centre, cv::Size(radius, radius * 2)), colour, cv::FILLED);
+        }
+    }
+
+    BenchScene scene;
+    scene.img1 = world(cv::Rect(0, 0, size.width, size.height)).clone();
+
+    double angle = 2.0 * CV_PI / 180.0;
+    double shift = size.width / 2.0;
+    cv::Mat world_to_img2 = (cv::Mat_<double>(3, 3) <<
+        std::cos(angle), -std::sin(angle), -shift,
+        std::sin(angle), std::cos(angle), 10.0,
+        1e-5, 0.0, 1.0);
+    cv::warpPerspective(world, scene.img2, world_to_img2, size);
+    scene.homography = world_to_img2;
+
+    return scene;
+}
+
+std::string sizeLabel(const cv::Size& size) {
+    return std::to_string(size.width) + "x" + std::to_string(size.height);
+}
+
+bool parseSizes(const std::string& text, std::vector<cv::Size>& sizes) {
+    sizes.clear();
+    std::istringstream list(text);
+    std::string item;
+    while (std::getline(list, item, ',')) {
+        int width = 0, height = 0;
+        char x = 0;
+        std::istringstream dims(item);
+        if (!(dims >> width >> x >> height) || x != 'x' || width < 64 || height < 64) {
+            std::cerr << "Error: Invalid resolution: '" << item << "'\n";
+            return false;
+        }
+        sizes.emplace_back(width, height);
+    }
+    return !sizes.empty();
+}
+
+bool parseInts(const std::string& text, std::vector<int>& values) {
+    values.clear();
+    std::istringstream list(text);
+    std::string item;
+    while (std::getline(list, item, ',')) {
+        try {
+            int value = std::stoi(item);
+            if (value <= 0) {
+                throw std::invalid_argument(item);
+            }
+            values.push_back(value);
+        } catch (const std::exception&) {
+            std::cerr << "Error: Invalid feature count: '" << item << "'\n";
+            return false;
+        }
+    }
+    return !values.empty();
+}
+
+void printUsage(const char* program_name) {
+    std::cout << "Usage: " << program_name << " [options]\n"
+              << "Options:\n"
+              << "  --resolutions <WxH,...>   : Image sizes to benchmark (default: 1280x720,1920x1080)\n"
+              << "  --features <n,...>        : Feature budgets to benchmark (default: 2000,8000)\n"
+              << "  --warmup <n>              : Untimed runs before measuring (default: 2)\n"
+              << "  --iterations <n>          : Minimum timed runs (default: 10)\n"
+              << "  --min-time <ms>           : Minimum timed duration per benchmark (default: 200)\n"
+              << "  --filter <text>           : Only run benchmarks whose name contains text\n"
+              << "  --output <path>           : CSV output (default: bench_results.csv)\n"
+              << "  --baseline <path>         : Compare medians with a previous CSV output\n"
+              << "  --threshold <fraction>    : Slowdown reported as a regression (default: 0.1)\n"
+              << "  --isa <level>             : Kernel ISA level (baseline|sse4.2|avx2|avx512, default: best)\n"
+              << "  --help                    : Show this message\n";
+}
+
+BenchArguments parseArguments(int argc, char** argv) {
+    BenchArguments args;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        bool ok = true;
+        try {
+            if (arg == "--help") {
+                args.show_help = true;
+            } else if (arg == "--resolutions" && has_value) {
+                ok = parseSizes(argv[++i], args.resolutions);
+            } else if (arg == "--features" && has_value) {
+                ok = parseInts(argv[++i], args.feature_counts);
+            } else if (arg == "--warmup" && has_value) {
+                args.warmup = std::stoi(argv[++i]);
+            } else if (arg == "--iterations" && has_value) {
+                args.iterations = std::stoi(argv[++i]);
+            } else if (arg == "--min-time" && has_value) {
+                args.min_time_ms = std::stod(argv[++i]);
+            } else if (arg == "--filter" && has_value) {
+                args.filter = argv[++i];
+            } else if (arg == "--output" && has_value) {
+                args.output_path = argv[++i];
+            } else if (arg == "--baseline" && has_value) {
+                args.baseline_path = argv[++i];
+            } else if (arg == "--isa" && has_value) {
+                args.isa = argv[++i];
+            } else if (arg == "--threshold" && has_value) {
+                args.threshold = std::stod(argv[++i]);
+            } else {
+                std::cerr << "Error: Unknown or incomplete option: " << arg << "\n";
+                ok = false;
+            }
+        } catch (const std::exception&) {
+            std::cerr << "Error: Invalid value for " << arg << "\n";
+            ok = false;
+        }
+
+        if (!ok) {
+            args.show_help = true;
+            break;
+        }
+    }
+    return args;
+}
+
+void benchDetectors(BenchmarkRunner& bench, const BenchScene& scene, const std::string& size,
+                    const std::vector<int>& feature_counts) {
+    for (const std::string& type : {"orb", "akaze", "sift"}) {
+        for (int features : feature_counts) {
+            std::string name = "detect/" + type + "/" + size + "/" + std::to_string(features);
+            if (!bench.selected(name)) {
+                continue;
+            }
+
+            auto detector = DetectorFactory::createDetector(type);
+            detector->setMaxFeatures(features);
+            bench.run(name, [&]() { detector->detect(scene.img1); });
+        }
+    }
+}
+
+void benchMatching(BenchmarkRunner& bench, const BenchScene& scene, const std::string& size,
+                   const std::vector<int>& feature_counts) {
+    struct MatcherCase {
+        const char* detector;
+        const char* matcher;
+    };
+    const MatcherCase cases[] = {
+        {"orb", "BruteForce-Hamming"},
+        {"orb", "HammingSIMD"},
+        {"sift", "BruteForce-L2"},
+    };
+
+    for (int features : feature_counts) {
+        for (const auto& c : cases) {
+            std::string name = std::string("match/") + c.detector + "/" + c.matcher + "/" + size +
+                               "/" + std::to_string(features);
+            if (!bench.selected(name)) {
+                continue;
+            }
+
+            auto detector = DetectorFactory::createDetector(c.detector);
+            detector->setMaxFeatures(features);
+            DetectionResult result1 = detector->detect(scene.img1);
+            DetectionResult result2 = detector->detect(scene.img2);
+
+            FeatureMatcher matcher;
+            matcher.setMatcherType(c.matcher);
+            bench.run(name, [&]() {
+                matcher.matchFeatures(result1.descriptors, result2.descriptors,
+                                      result1.keypoints, result2.keypoints, 0.75);
+            });
+        }
+    }
+}
+
+void benchHomography(BenchmarkRunner& bench, const BenchScene& scene, const std::string& size,
+                     const std::vector<int>& feature_counts) {
+    for (int features : feature_counts) {
+        std::string suffix = "/" + size + "/" + std::to_string(features);
+
+        auto detector = DetectorFactory::createDetector("orb");
+        detector->setMaxFeatures(features);
+        DetectionResult result1 = detector->detect(scene.img1);
+        DetectionResult result2 = detector->detect(scene.img2);
+
+        FeatureMatcher matcher;
+        matcher.setMatcherType("HammingSIMD");
+        MatchingResult matches = matcher.matchFeatures(result1.descriptors, result2.descriptors,
+                                                       result1.keypoints, result2.keypoints, 0.75);
+        if (matches.good_matches.size() < 4) {
+            std::cerr << "Warning: Too few matches for homography benchmarks at " << suffix << "\n";
+            continue;
+        }
+
+        std::vector<cv::Point2f> points1 = RANSAC::extractPoints(result1.keypoints, matches.good_matches, true);
+        std::vector<cv::Point2f> points2 = RANSAC::extractPoints(result2.keypoints, matches.good_matches, false);
+
+        RANSAC ransac;
+        bench.run("ransac/findHomography" + suffix, [&]() {
+            ransac.findHomography(points1, points2, 3.0);
+        });
+        bench.run("ransac/findHomographyPROSAC" + suffix, [&]() {
+            ransac.findHomographyPROSAC(points1, points2, matches.match_ratios, 3.0);
+        });
+
+        for (const std::string& backend : {"opencv", "ransac", "prosac"}) {
+            HomographyEstimator estimator;
+            estimator.setRANSACThreshold(3.0);
+            estimator.setBackend(HomographyEstimator::stringToBackend(backend));
+            std::vector<cv::DMatch> inliers;
+            bench.run("estimator/" + backend + suffix, [&]() {
+                estimator.estimateHomography(result1.keypoints, result2.keypoints,
+                                             matches.good_matches, matches.match_ratios, inliers);
+            });
+        }
+    }
+}
+
+void benchWarping(BenchmarkRunner& bench, const BenchScene& scene, const std::string& size) {
+    cv::Size canvas_size(scene.img1.cols * 2, scene.img1.rows + scene.img1.rows / 4);
+    cv::Mat to_canvas = (cv::Mat_<double>(3, 3) << 1, 0, 0, 0, 1, scene.img1.rows / 8.0, 0, 0, 1);
+    cv::Mat transform = to_canvas * scene.homography.inv();
+
+    cv::Mat warped;
+    bench.run("warp/warpPerspective/" + size, [&]() {
+        cv::warpPerspective(scene.img2, warped, transform, canvas_size);
+    });
+
+    ImageWarper warper;
+    bench.run("warp/warpToFootprint/" + size, [&]() {
+        warper.warpToFootprint(scene.img2, transform, canvas_size);
+    });
+}
+
+void benchBlending(BenchmarkRunner& bench, const BenchScene& scene, const std::string& size) {
+    cv::Size canvas_size(scene.img1.cols * 3 / 2, scene.img1.rows);
+    cv::Mat identity = cv::Mat::eye(3, 3, CV_64F);
+    cv::Mat shift = (cv::Mat_<double>(3, 3) << 1, 0, scene.img1.cols / 2.0, 0, 1, 0, 0, 0, 1);
+
+    ImageWarper warper;
+    cv::Mat canvas1, mask1, canvas2, mask2;
+    ImageWarper::placeOnCanvas(warper.warpToFootprint(scene.img1, identity, canvas_size),
+                               canvas_size, canvas1, mask1);
+    ImageWarper::placeOnCanvas(warper.warpToFootprint(scene.img2, shift, canvas_size),
+                               canvas_size, canvas2, mask2);
+
+    for (const std::string& mode : {"simple", "feather", "multiband", "seam"}) {
+        std::unique_ptr<Blender> blender = BlenderFactory::createBlender(mode);
+        bench.run("blend/" + mode + "/" + size, [&]() {
+            blender->blend(canvas1, canvas2, mask1, mask2);
+        });
+    }
+}
+
+}
+
+int main(int argc, char** argv) {
+    BenchArguments args = parseArguments(argc, argv);
+    if (args.show_help) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (!args.isa.empty() && !KernelDispatch::select(args.isa)) {
+        std::cerr << "Error: Kernel level '" << args.isa << "' is not available, this CPU supports:";
+        for (const std::string& level : KernelDispatch::supportedLevels()) {
+            std::cerr << " " << level;
+        }
+        std::cerr << "\n";
+        return 1;
+    }
+    std::cout << "Using " << KernelDispatch::active().isa << " kernels\n";
+
+    BenchmarkRunner bench(args.warmup, args.iterations, args.min_time_ms);
+    bench.setFilter(args.filter);
+
+    for (const cv::Size& resolution : args.resolutions) {
+        std::string size = sizeLabel(resolution);
+        std::cout << "\n=== " << size << " ===\n";
+
+        BenchScene scene = makeScene(resolution, 0x5eed);
+        try {
+            benchDetectors(bench, scene, size, args.feature_counts);
+            benchMatching(bench, scene, size, args.feature_counts);
+            benchHomography(bench, scene, size, args.feature_counts);
+            benchWarping(bench, scene, size);
+            benchBlending(bench, scene, size);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: Benchmark failed: " << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    if (bench.results().empty()) {
+        std::cerr << "Error: No benchmark matches filter '" << args.filter << "'\n";
+        return 1;
+    }
+
+    bench.writeCSV(args.output_path);
+
+    if (!args.baseline_path.empty()) {
+        int regressions = bench.compare(BenchmarkRunner::loadBaseline(args.baseline_path), args.threshold);
+        if (regressions > 0) {
+            std::cout << regressions << " benchmarks regressed\n";
+            return 2;
+        }
+    }
+
+    return 0;
+}
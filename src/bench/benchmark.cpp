@@ -0,0 +1,145 @@
+#include "benchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+
+BenchmarkRunner::BenchmarkRunner(int warmup, int iterations, double min_time_ms)
+    : warmup_(std::max(0, warmup)),
+      iterations_(std::max(1, iterations)),
+      min_time_ms_(std::max(0.0, min_time_ms)) {}
+
+bool BenchmarkRunner::selected(const std::string& name) const {
+    return filter_.empty() || name.find(filter_) != std::string::npos;
+}
+
+bool BenchmarkRunner::run(const std::string& name, const std::function<void()>& body) {
+    if (!selected(name)) {
+        return false;
+    }
+
+    for (int i = 0; i < warmup_; i++) {
+        body();
+    }
+
+    std::vector<double> samples;
+    double spent_ms = 0.0;
+    while (static_cast<int>(samples.size()) < iterations_ || spent_ms < min_time_ms_) {
+        auto start = std::chrono::high_resolution_clock::now();
+        body();
+        auto end = std::chrono::high_resolution_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        samples.push_back(ms);
+        spent_ms += ms;
+    }
+
+    BenchmarkStats stats = summarize(name, std::move(samples));
+    std::cout << std::left << std::setw(48) << stats.name << std::right << std::fixed << std::setprecision(3)
+              << " median " << std::setw(10) << stats.median_ms << " ms"
+              << "  min " << std::setw(10) << stats.min_ms << " ms"
+              << "  p90 " << std::setw(10) << stats.p90_ms << " ms"
+              << "  (" << stats.iterations << " iterations)\n";
+    results_.push_back(stats);
+    return true;
+}
+
+BenchmarkStats BenchmarkRunner::summarize(const std::string& name, std::vector<double> samples) {
+    BenchmarkStats stats;
+    stats.name = name;
+    stats.iterations = static_cast<int>(samples.size());
+
+    std::sort(samples.begin(), samples.end());
+    size_t n = samples.size();
+    stats.min_ms = samples.front();
+    stats.median_ms = n % 2 ? samples[n / 2] : 0.5 * (samples[n / 2 - 1] + samples[n / 2]);
+    stats.p90_ms = samples[std::min(n - 1, static_cast<size_t>(std::ceil(0.9 * n)) - 1)];
+    stats.mean_ms = std::accumulate(samples.begin(), samples.end(), 0.0) / n;
+
+    double variance = 0.0;
+    for (double sample : samples) {
+        variance += (sample - stats.mean_ms) * (sample - stats.mean_ms);
+    }
+    stats.stddev_ms = n > 1 ? std::sqrt(variance / (n - 1)) : 0.0;
+
+    return stats;
+}
+
+bool BenchmarkRunner::writeCSV(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file) {
+        std::cerr << "Error: Cannot open file: " << path << "\n";
+        return false;
+    }
+
+    file << "name,iterations,min_ms,median_ms,mean_ms,p90_ms,stddev_ms\n";
+    file << std::fixed << std::setprecision(4);
+    for (const auto& stats : results_) {
+        file << stats.name << "," << stats.iterations << "," << stats.min_ms << ","
+             << stats.median_ms << "," << stats.mean_ms << "," << stats.p90_ms << ","
+             << stats.stddev_ms << "\n";
+    }
+
+    std::cout << "Benchmark results saved to " << path << "\n";
+    return true;
+}
+
+std::map<std::string, double> BenchmarkRunner::loadBaseline(const std::string& path) {
+    std::map<std::string, double> baseline;
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Error: Cannot open baseline: " << path << "\n";
+        return baseline;
+    }
+
+    std::string line;
+    std::getline(file, line);
+    while (std::getline(file, line)) {
+        std::istringstream row(line);
+        std::string name, iterations, min_ms, median_ms;
+        if (std::getline(row, name, ',') && std::getline(row, iterations, ',') &&
+            std::getline(row, min_ms, ',') && std::getline(row, median_ms, ',')) {
+            try {
+                baseline[name] = std::stod(median_ms);
+            } catch (const std::exception&) {
+                std::cerr << "Warning: Ignoring malformed baseline row: " << line << "\n";
+            }
+        }
+    }
+
+    return baseline;
+}
+
+int BenchmarkRunner::compare(const std::map<std::string, double>& baseline, double threshold) const {
+    int regressions = 0;
+
+    std::cout << "\nComparison with baseline (median, threshold "
+              << static_cast<int>(threshold * 100) << "%):\n";
+    for (const auto& stats : results_) {
+        auto it = baseline.find(stats.name);
+        if (it == baseline.end() || it->second <= 0.0) {
+            std::cout << std::left << std::setw(48) << stats.name << " new\n";
+            continue;
+        }
+
+        double ratio = stats.median_ms / it->second;
+        const char* verdict = "";
+        if (ratio > 1.0 + threshold) {
+            verdict = "  REGRESSION";
+            regressions++;
+        } else if (ratio < 1.0 - threshold) {
+            verdict = "  faster";
+        }
+
+        std::cout << std::left << std::setw(48) << stats.name << std::right << std::fixed
+                  << std::setprecision(3) << std::setw(10) << it->second << " -> "
+                  << std::setw(10) << stats.median_ms << " ms  ("
+                  << std::showpos << std::setprecision(1) << (ratio - 1.0) * 100.0
+                  << std::noshowpos << "%)" << verdict << "\n";
+    }
+
+    return regressions;
+}
@@ -0,0 +1,54 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+struct BenchmarkStats {
+    std::string name;
+    int iterations = 0;
+    double min_ms = 0.0;
+    double median_ms = 0.0;
+    double mean_ms = 0.0;
+    double p90_ms = 0.0;
+    double stddev_ms = 0.0;
+};
+
+// Runs each benchmark body `warmup` times untimed, then at least
+// `iterations` times and until `min_time_ms` has been spent, and keeps
+// per-iteration statistics. Results can be written as CSV and compared
+// with a previous CSV run by median time.
+class BenchmarkRunner {
+public:
+    BenchmarkRunner(int warmup = 2, int iterations = 10, double min_time_ms = 200.0);
+
+    void setFilter(const std::string& filter) { filter_ = filter; }
+    bool selected(const std::string& name) const;
+
+    // Skipped (returns false) when the name does not match the filter.
+    bool run(const std::string& name, const std::function<void()>& body);
+
+    const std::vector<BenchmarkStats>& results() const { return results_; }
+
+    bool writeCSV(const std::string& path) const;
+
+    // Median times by benchmark name.
+    static std::map<std::string, double> loadBaseline(const std::string& path);
+
+    // Prints each result against the baseline and returns how many are
+    // slower than the baseline by more than `threshold` (0.1 = 10%).
+    int compare(const std::map<std::string, double>& baseline, double threshold) const;
+
+private:
+    int warmup_;
+    int iterations_;
+    double min_time_ms_;
+    std::string filter_;
+    std::vector<BenchmarkStats> results_;
+
+    static BenchmarkStats summarize(const std::string& name, std::vector<double> samples);
+};
+
+#endif
@@ -2,18 +2,44 @@
 #include "../config.h"
 #include <iostream>
 #include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <set>
+#include <sstream>
 
 void ArgumentParser::printUsage(const char* program_name) {
     std::cout << "Usage: " << program_name << " [options]\n"
               << "Options:\n"
               << "  --stitch <img1> <img2>       : Stitch two images\n"
               << "  --stitch-multiple <img1> ...  : Stitch multiple images\n"
+              << "  --video <path>               : Stitch a video pan or image sequence (e.g. burst_%03d.jpg)\n"
+              << "  --keyframe-overlap <value>   : Video: target overlap between keyframes (default: 0.6)\n"
+              << "  --batch <manifest>           : Run the stitch jobs listed in a manifest, one per line\n"
+              << "  --batch-workers <num>        : Jobs run concurrently in batch and experiment modes (default: auto)\n"
               << "  --experiment-mode            : Run all experiments\n"
+              << "  --no-experiment-images       : Experiment mode: skip input, keypoint and match images\n"
               << "  --detector <orb|akaze|sift>  : Choose feature detector (default: orb)\n"
-              << "  --blend-mode <mode>          : Choose blend mode (simple|feather|multiband)\n"
+              << "  --blend-mode <mode>          : Choose blend mode (simple|feather|multiband|seam)\n"
+              << "  --multi-mode <mode>          : Multi-image strategy (sequential|global|streaming|unordered)\n"
+              << "  --estimator <backend>        : Homography estimator (opencv|ransac|prosac, default: opencv)\n"
               << "  --ransac-threshold <value>   : Set RANSAC threshold (default: 3.0)\n"
-              << "  --max-features <num>         : Set max features (default: 2000)\n"
+              << "  --max-features <num>         : Set max features (default: 4000)\n"
+              << "  --blend-memory <MB>          : Memory budget for multiband blending (default: 1024)\n"
+              << "  --cache-dir <dir>            : Reuse features and registrations stored in this directory\n"
+              << "  --ann-checks <num>           : SIFT: KD-forest matching with this search budget (0 = exact)\n"
               << "  --output <path>              : Output path for panorama\n"
+              << "  --tiled-output <dir>         : Write a JPEG tile pyramid using an out-of-core canvas\n"
+              << "  --diagnostics <level>        : Debug image output (off|summary|full, default: off)\n"
+              << "  --profile <path>             : Append per-stage timings and memory peaks as a JSON line\n"
+              << "                                 (wall time; \"describe\" is CPU time summed over images)\n"
+              << "  --coarse-to-fine             : Register on ~2 MP proxies and refine at full resolution\n"
+              << "  --projection <type>          : Multi-image surface (plane|cylindrical|spherical, default: plane)\n"
+              << "  --focal <px>                 : Focal length for --projection (default: estimated)\n"
+              << "  --gain-compensation          : Equalise exposure across overlaps before blending\n"
+              << "  --opencl                     : Warp and blend multi-image panoramas on an OpenCL device\n"
+              << "  --quick-reject               : Skip pairs whose thumbnails do not match before registering\n"
+              << "  --response-keypoints         : Keep the strongest keypoints instead of a uniform spread\n"
+              << "  --guided-matching            : Sequential mode: match only near the predicted overlap\n"
               << "  --visualize                  : Show intermediate results\n"
               << "  --help                       : Show this message\n";
 }
@@ -77,8 +103,15 @@ ProgramArguments ArgumentParser::parse(int argc, char** argv) {
         return args;
     }
 
-    for (int i = 1; i < argc; ++i) {
-        std::string arg = argv[i];
+    return parse(std::vector<std::string>(argv + 1, argv + argc), args);
+}
+
+ProgramArguments ArgumentParser::parse(const std::vector<std::string>& tokens, const ProgramArguments& defaults) {
+    ProgramArguments args = defaults;
+    const int argc = static_cast<int>(tokens.size());
+
+    for (int i = 0; i < argc; ++i) {
+        std::string arg = tokens[i];
 
         if (arg == "--help") {
             args.show_help = true;
@@ -91,13 +124,13 @@ ProgramArguments ArgumentParser::parse(int argc, char** argv) {
                 return args;
             }
             args.mode = ProgramArguments::STITCH_TWO;
-            args.image_paths.push_back(argv[++i]);
-            args.image_paths.push_back(argv[++i]);
+            args.image_paths.push_back(tokens[++i]);
+            args.image_paths.push_back(tokens[++i]);
         }
         else if (arg == "--stitch-multiple") {
             args.mode = ProgramArguments::STITCH_MULTIPLE;
-            while (i + 1 < argc && argv[i + 1][0] != '-') {
-                args.image_paths.push_back(argv[++i]);
+            while (i + 1 < argc && tokens[i + 1][0] != '-') {
+                args.image_paths.push_back(tokens[++i]);
             }
             if (args.image_paths.size() < 2) {
                 std::cerr << "Error: --stitch-multiple requires at least two images\n";
@@ -105,16 +138,62 @@ ProgramArguments ArgumentParser::parse(int argc, char** argv) {
                 return args;
             }
         }
+        else if (arg == "--video") {
+            if (++i >= argc) {
+                std::cerr << "Error: --video requires a path\n";
+                args.show_help = true;
+                return args;
+            }
+            args.mode = ProgramArguments::VIDEO;
+            args.image_paths.push_back(tokens[i]);
+        }
+        else if (arg == "--keyframe-overlap") {
+            if (++i >= argc) {
+                std::cerr << "Error: --keyframe-overlap requires a value\n";
+                args.show_help = true;
+                return args;
+            }
+            if (!parseDouble(tokens[i], args.keyframe_overlap, "keyframe overlap",
+                            PanoramaConfig::MIN_KEYFRAME_OVERLAP,
+                            PanoramaConfig::MAX_KEYFRAME_OVERLAP)) {
+                args.show_help = true;
+                return args;
+            }
+        }
+        else if (arg == "--batch") {
+            if (++i >= argc) {
+                std::cerr << "Error: --batch requires a manifest path\n";
+                args.show_help = true;
+                return args;
+            }
+            args.mode = ProgramArguments::BATCH;
+            args.batch_manifest = tokens[i];
+        }
+        else if (arg == "--batch-workers") {
+            if (++i >= argc) {
+                std::cerr << "Error: --batch-workers requires a value\n";
+                args.show_help = true;
+                return args;
+            }
+            if (!parseInt(tokens[i], args.batch_workers, "batch workers",
+                         0, PanoramaConfig::MAX_BATCH_WORKERS)) {
+                args.show_help = true;
+                return args;
+            }
+        }
         else if (arg == "--experiment-mode") {
             args.mode = ProgramArguments::EXPERIMENT;
         }
+        else if (arg == "--no-experiment-images") {
+            args.experiment_images = false;
+        }
         else if (arg == "--detector") {
             if (++i >= argc) {
                 std::cerr << "Error: --detector requires a value\n";
                 args.show_help = true;
                 return args;
             }
-            args.detector_type = argv[i];
+            args.detector_type = tokens[i];
             if (args.detector_type != "orb" && args.detector_type != "akaze" && args.detector_type != "sift") {
                 std::cerr << "Error: Unknown detector type: " << args.detector_type << "\n";
                 args.show_help = true;
@@ -127,20 +206,76 @@ ProgramArguments ArgumentParser::parse(int argc, char** argv) {
                 args.show_help = true;
                 return args;
             }
-            args.blend_mode = argv[i];
-            if (args.blend_mode != "simple" && args.blend_mode != "feather" && args.blend_mode != "multiband") {
+            args.blend_mode = tokens[i];
+            if (args.blend_mode != "simple" && args.blend_mode != "feather" &&
+                args.blend_mode != "multiband" && args.blend_mode != "seam") {
                 std::cerr << "Error: Unknown blend mode: " << args.blend_mode << "\n";
                 args.show_help = true;
                 return args;
             }
         }
+        else if (arg == "--projection") {
+            if (++i >= argc) {
+                std::cerr << "Error: --projection requires a value\n";
+                args.show_help = true;
+                return args;
+            }
+            args.projection = tokens[i];
+            if (args.projection != "plane" && args.projection != "cylindrical" &&
+                args.projection != "spherical") {
+                std::cerr << "Error: Unknown projection: " << args.projection << "\n";
+                args.show_help = true;
+                return args;
+            }
+        }
+        else if (arg == "--focal") {
+            if (++i >= argc) {
+                std::cerr << "Error: --focal requires a value\n";
+                args.show_help = true;
+                return args;
+            }
+            if (!parseDouble(tokens[i], args.focal_length, "focal length",
+                            PanoramaConfig::MIN_FOCAL_LENGTH,
+                            PanoramaConfig::MAX_FOCAL_LENGTH)) {
+                args.show_help = true;
+                return args;
+            }
+        }
+        else if (arg == "--multi-mode") {
+            if (++i >= argc) {
+                std::cerr << "Error: --multi-mode requires a value\n";
+                args.show_help = true;
+                return args;
+            }
+            args.multi_mode = tokens[i];
+            if (args.multi_mode != "sequential" && args.multi_mode != "global" &&
+                args.multi_mode != "streaming" && args.multi_mode != "unordered") {
+                std::cerr << "Error: Unknown multi-image mode: " << args.multi_mode << "\n";
+                args.show_help = true;
+                return args;
+            }
+        }
+        else if (arg == "--estimator") {
+            if (++i >= argc) {
+                std::cerr << "Error: --estimator requires a value\n";
+                args.show_help = true;
+                return args;
+            }
+            args.estimator_backend = tokens[i];
+            if (args.estimator_backend != "opencv" && args.estimator_backend != "ransac" &&
+                args.estimator_backend != "prosac") {
+                std::cerr << "Error: Unknown estimator backend: " << args.estimator_backend << "\n";
+                args.show_help = true;
+                return args;
+            }
+        }
         else if (arg == "--ransac-threshold") {
             if (++i >= argc) {
                 std::cerr << "Error: --ransac-threshold requires a value\n";
                 args.show_help = true;
                 return args;
             }
-            if (!parseDouble(argv[i], args.ransac_threshold, "RANSAC threshold",
+            if (!parseDouble(tokens[i], args.ransac_threshold, "RANSAC threshold",
                             PanoramaConfig::MIN_RANSAC_THRESHOLD,
                             PanoramaConfig::MAX_RANSAC_THRESHOLD)) {
                 args.show_help = true;
@@ -153,28 +288,121 @@ ProgramArguments ArgumentParser::parse(int argc, char** argv) {
                 args.show_help = true;
                 return args;
             }
-            if (!parseInt(argv[i], args.max_features, "max features",
+            if (!parseInt(tokens[i], args.max_features, "max features",
                          PanoramaConfig::MIN_FEATURES,
                          PanoramaConfig::MAX_FEATURES)) {
                 args.show_help = true;
                 return args;
             }
         }
+        else if (arg == "--blend-memory") {
+            if (++i >= argc) {
+                std::cerr << "Error: --blend-memory requires a value\n";
+                args.show_help = true;
+                return args;
+            }
+            if (!parseInt(tokens[i], args.blend_memory_mb, "blend memory",
+                         PanoramaConfig::MIN_BLEND_MEMORY_MB,
+                         PanoramaConfig::MAX_BLEND_MEMORY_MB)) {
+                args.show_help = true;
+                return args;
+            }
+        }
+        else if (arg == "--cache-dir") {
+            if (++i >= argc) {
+                std::cerr << "Error: --cache-dir requires a directory\n";
+                args.show_help = true;
+                return args;
+            }
+            args.cache_dir = tokens[i];
+            if (!isValidOutputPath(args.cache_dir)) {
+                args.show_help = true;
+                return args;
+            }
+        }
+        else if (arg == "--ann-checks") {
+            if (++i >= argc) {
+                std::cerr << "Error: --ann-checks requires a value\n";
+                args.show_help = true;
+                return args;
+            }
+            if (!parseInt(tokens[i], args.ann_checks, "ANN checks",
+                         0, PanoramaConfig::MAX_ANN_CHECKS)) {
+                args.show_help = true;
+                return args;
+            }
+        }
         else if (arg == "--output") {
             if (++i >= argc) {
                 std::cerr << "Error: --output requires a path\n";
                 args.show_help = true;
                 return args;
             }
-            args.output_path = argv[i];
+            args.output_path = tokens[i];
             if (!isValidOutputPath(args.output_path)) {
                 args.show_help = true;
                 return args;
             }
         }
+        else if (arg == "--tiled-output") {
+            if (++i >= argc) {
+                std::cerr << "Error: --tiled-output requires a directory\n";
+                args.show_help = true;
+                return args;
+            }
+            args.tiled_output_dir = tokens[i];
+            if (!isValidOutputPath(args.tiled_output_dir)) {
+                args.show_help = true;
+                return args;
+            }
+        }
+        else if (arg == "--profile") {
+            if (++i >= argc) {
+                std::cerr << "Error: --profile requires a path\n";
+                args.show_help = true;
+                return args;
+            }
+            args.profile_path = tokens[i];
+            if (!isValidOutputPath(args.profile_path)) {
+                args.show_help = true;
+                return args;
+            }
+        }
+        else if (arg == "--diagnostics") {
+            if (++i >= argc) {
+                std::cerr << "Error: --diagnostics requires a value\n";
+                args.show_help = true;
+                return args;
+            }
+            args.diagnostics_level = tokens[i];
+            if (args.diagnostics_level != "off" && args.diagnostics_level != "summary" &&
+                args.diagnostics_level != "full") {
+                std::cerr << "Error: Unknown diagnostics level: " << args.diagnostics_level << "\n";
+                args.show_help = true;
+                return args;
+            }
+        }
         else if (arg == "--visualize") {
             args.visualize = true;
         }
+        else if (arg == "--coarse-to-fine") {
+            args.coarse_to_fine = true;
+        }
+        else if (arg == "--gain-compensation") {
+            args.gain_compensation = true;
+        }
+        else if (arg == "--opencl") {
+            args.opencl = true;
+        }
+        else if (arg == "--quick-reject") {
+            args.quick_reject = true;
+        }
+        else if (arg == "--response-keypoints") {
+            args.uniform_keypoints = false;
+        }
+        else if (arg == "--guided-matching") {
+            args.guided_matching = true;
+        }
         else {
             std::cerr << "Error: Unknown option: " << arg << "\n";
             args.show_help = true;
@@ -183,4 +411,64 @@ ProgramArguments ArgumentParser::parse(int argc, char** argv) {
     }
 
     return args;
-}
\ No newline at end of file
+}
+
+bool ArgumentParser::loadManifest(const std::string& path, const ProgramArguments& defaults,
+                                  std::vector<ProgramArguments>& jobs) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Error: Could not open batch manifest: " << path << "\n";
+        return false;
+    }
+
+    ProgramArguments base = defaults;
+    base.mode = ProgramArguments::NONE;
+    base.image_paths.clear();
+    base.batch_manifest.clear();
+    base.visualize = false;
+
+    std::set<std::string> outputs;
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line)) {
+        line_number++;
+
+        std::istringstream iss(line);
+        std::vector<std::string> tokens;
+        std::string token;
+        while (iss >> std::quoted(token)) {
+            tokens.push_back(token);
+        }
+        if (tokens.empty() || tokens[0][0] == '#') {
+            continue;
+        }
+
+        ProgramArguments job = parse(tokens, base);
+        if (job.show_help ||
+            (job.mode != ProgramArguments::STITCH_TWO && job.mode != ProgramArguments::STITCH_MULTIPLE)) {
+            std::cerr << "Error: " << path << ":" << line_number
+                      << ": expected a --stitch or --stitch-multiple job\n";
+            return false;
+        }
+        if (job.visualize) {
+            std::cerr << "Warning: " << path << ":" << line_number << ": --visualize is ignored in batch mode\n";
+            job.visualize = false;
+        }
+
+        const std::string& output = job.tiled_output_dir.empty() ? job.output_path : job.tiled_output_dir;
+        if (!outputs.insert(output).second) {
+            std::cerr << "Error: " << path << ":" << line_number
+                      << ": output " << output << " is written by an earlier job\n";
+            return false;
+        }
+
+        jobs.push_back(std::move(job));
+    }
+
+    if (jobs.empty()) {
+        std::cerr << "Error: Batch manifest " << path << " lists no jobs\n";
+        return false;
+    }
+
+    return true;
+}
@@ -12,23 +12,53 @@ struct ProgramArguments {
         NONE,
         STITCH_TWO,
         STITCH_MULTIPLE,
+        BATCH,
+        VIDEO,
         EXPERIMENT
     };
 
     Mode mode = NONE;
     std::vector<std::string> image_paths;
     std::string output_path = "panorama_output.jpg";
+    std::string tiled_output_dir;
     std::string detector_type = "orb";
     std::string blend_mode = "feather";
+    std::string multi_mode = "sequential";
+    std::string estimator_backend = "opencv";
+    std::string diagnostics_level = "off";
+    std::string cache_dir;
+    std::string batch_manifest;
+    std::string profile_path;
+    std::string projection = "plane";
     double ransac_threshold = 3.0;
-    int max_features = 20000;
+    double focal_length = 0.0;
+    double keyframe_overlap = 0.6;
+    int max_features = 4000;
+    int blend_memory_mb = 1024;
+    int ann_checks = 0;
+    int batch_workers = 0;
     bool visualize = false;
+    bool coarse_to_fine = false;
+    bool gain_compensation = false;
+    bool quick_reject = false;
+    bool opencl = false;
+    bool experiment_images = true;
+    bool guided_matching = false;
+    bool uniform_keypoints = true;
     bool show_help = false;
 };
 
 class ArgumentParser {
 public:
     static ProgramArguments parse(int argc, char** argv);
+    static ProgramArguments parse(const std::vector<std::string>& tokens, const ProgramArguments& defaults);
+
+    // One --stitch or --stitch-multiple job per line, e.g.
+    //   --stitch a.jpg b.jpg --output ab.jpg --detector sift
+    // Blank lines and lines starting with '#' are skipped, paths may be
+    // double-quoted, and options missing from a line come from defaults.
+    static bool loadManifest(const std::string& path, const ProgramArguments& defaults,
+                             std::vector<ProgramArguments>& jobs);
     static void printUsage(const char* program_name);
     static bool isValidOutputPath(const std::string& path);
 
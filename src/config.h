@@ -3,7 +3,9 @@
 
 namespace PanoramaConfig {
 
-    constexpr int DEFAULT_MAX_FEATURES = 50000;
+    // Default keypoint budget; uniform selection spreads it over cells of
+    // UNIFORM_KEYPOINTS_PER_CELL keypoints (500 cells).
+    constexpr int DEFAULT_MAX_FEATURES = 4000;
     constexpr int MIN_FEATURES = 10;
     constexpr int MAX_FEATURES = 50000;
 
@@ -15,10 +17,36 @@ namespace PanoramaConfig {
     constexpr int DEFAULT_RANSAC_MAX_ITERATIONS = 2000;
     constexpr int MIN_INLIERS_REQUIRED = 5;
 
+    constexpr int RANSAC_HYPOTHESIS_BATCH = 64;
+    constexpr double SPRT_INITIAL_INLIER_RATIO = 0.1;
+    constexpr double SPRT_INITIAL_DELTA = 0.01;
+    constexpr double SPRT_MODEL_COST = 200.0;
+
     constexpr int MAX_PANORAMA_DIMENSION = 15000;
     constexpr int MIN_IMAGE_DIMENSION = 50;
     constexpr int PANORAMA_PADDING = 10;
     constexpr size_t MAX_PANORAMA_MEMORY = 2147483648;
+    constexpr int DEFAULT_BLEND_MEMORY_MB = 1024;
+    constexpr int MIN_BLEND_MEMORY_MB = 16;
+    constexpr int MAX_BLEND_MEMORY_MB = 65536;
+
+    // Seam search runs on the overlap downsampled to at most this many
+    // pixels; pixels outside the overlap are effectively forbidden.
+    constexpr double SEAM_MAX_PIXELS = 262144.0;
+    constexpr float SEAM_OUTSIDE_COST = 1e6f;
+    constexpr int SEAM_BAND_WIDTH = 16;
+
+    // Gain compensation statistics come from warps of at most this many
+    // pixels; sigmas weight intensity error against deviation from 1.
+    constexpr double GAIN_MAX_PIXELS = 250000.0;
+    constexpr double GAIN_SIGMA_N = 10.0;
+    constexpr double GAIN_SIGMA_G = 0.1;
+    constexpr int GAIN_MIN_OVERLAP_PIXELS = 64;
+
+    constexpr int CANVAS_TILE_SIZE = 1024;
+    constexpr int CANVAS_CACHE_MB = 512;
+    constexpr int MAX_TILED_PANORAMA_DIMENSION = 1048576;
+    constexpr int TILE_JPEG_QUALITY = 90;
 
     constexpr double MIN_HOMOGRAPHY_DETERMINANT = 0.001;
     constexpr double MAX_HOMOGRAPHY_DETERMINANT = 1000.0;
@@ -30,6 +58,55 @@ namespace PanoramaConfig {
     constexpr int REFERENCE_IMAGE_HEIGHT = 1536;
     constexpr double PANORAMA_SCALE_THRESHOLD = 1.5;
 
+    constexpr double PROXY_MAX_PIXELS = 2000000.0;
+
+    // Cylindrical/spherical projection: the focal length is estimated from
+    // homographies between proxies of the first images.
+    constexpr double FOCAL_PROXY_PIXELS = 500000.0;
+    constexpr size_t FOCAL_ESTIMATION_IMAGES = 9;
+    constexpr double MIN_FOCAL_LENGTH = 1.0;
+    constexpr double MAX_FOCAL_LENGTH = 1000000.0;
+    constexpr int PROJECTION_MAP_CACHE_ENTRIES = 16;
+    constexpr double REFINE_PATCH_RADIUS = 8.0;
+    constexpr int REFINE_MAX_ANCHORS = 300;
+    constexpr int REFINE_FEATURES_PER_ANCHOR = 8;
+
+    constexpr double GUIDED_SEARCH_RADIUS_FRACTION = 0.1;
+    constexpr int MIN_GUIDED_MATCHES = 50;
+
+    constexpr int ANN_KDTREE_TREES = 4;
+    constexpr int MAX_ANN_CHECKS = 4096;
+
+    constexpr int UNIFORM_KEYPOINTS_PER_CELL = 8;
+    constexpr int UNIFORM_CANDIDATE_FACTOR = 4;
+    constexpr int MAX_UNIFORM_CANDIDATES = 200000;
+
+    constexpr size_t STREAM_QUEUE_DEPTH = 2;
+
+    // Thumbnail pre-check run before full pair registration.
+    constexpr double QUICK_VERIFY_PIXELS = 160000.0;
+    constexpr int QUICK_VERIFY_FEATURES = 500;
+    constexpr double QUICK_VERIFY_RATIO = 0.8;
+    constexpr int QUICK_VERIFY_MIN_INLIERS = 15;
+    constexpr int QUICK_VERIFY_ITERATIONS = 500;
+    constexpr double QUICK_VERIFY_THRESHOLD = 3.0;
+
+    // Video input: a frame becomes a keyframe once its predicted overlap
+    // with the last keyframe drops to the target, or after the gap limit.
+    constexpr double VIDEO_KEYFRAME_OVERLAP = 0.6;
+    constexpr double MIN_KEYFRAME_OVERLAP = 0.1;
+    constexpr double MAX_KEYFRAME_OVERLAP = 0.95;
+    constexpr int VIDEO_MAX_KEYFRAME_GAP = 30;
+    constexpr int VIDEO_MAX_FAILURES = 10;
+
+    constexpr int SESSION_POOL_MAX_MB = 1024;
+
+    constexpr int MAX_BATCH_WORKERS = 256;
+    constexpr int BATCH_THREADS_PER_JOB = 2;
+    // Decoded inputs plus the warped canvases, masks, result and blend
+    // scratch, assuming the canvas is about as large as the inputs combined.
+    constexpr size_t BATCH_BYTES_PER_INPUT_PIXEL = 24;
+
     constexpr size_t MAX_IMAGE_PIXELS = 100000000;
     constexpr size_t WARNING_IMAGE_PIXELS = 50000000;
 }
@@ -1,20 +1,95 @@
 #include "experiment_runner.h"
 #include "visualization.h"
 #include "report_generator.h"
-#include "../feature_detection/detector_factory.h"
-#include "../feature_matching/matcher.h"
+#include "../config.h"
 #include "../homography/homography_estimator.h"
-#include "../stitching/image_warper.h"
-#include "../stitching/blender.h"
-#include "../stitching/blender_factory.h"
+#include "../pipeline/stitching_pipeline.h"
+#include "../pipeline/stage_profiler.h"
+#include "../pipeline/thread_pool.h"
 #include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <filesystem>
 #include <chrono>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
 
 namespace fs = std::filesystem;
 
+namespace {
+
+enum class SweepStage {
+    DECODE,
+    DETECT,
+    MATCH,
+    ESTIMATE,
+    COMPOSE
+};
+
+// One stage of one or more experiment jobs. A node runs once its parent
+// has succeeded and keeps its outputs until every compose node below it
+// has finished.
+struct SweepNode {
+    SweepStage stage = SweepStage::DECODE;
+    int parent = -1;
+    std::vector<int> children;
+    // First job reaching the node; it supplies the stage parameters.
+    size_t job = 0;
+    int pending_leaves = 0;
+    int subtree_size = 1;
+    int stitch_id = 0;
+
+    StageProfiler profiler;
+    bool ok = false;
+
+    cv::Mat img1, img2;
+    std::vector<DetectionResult> features;
+    MatchingResult matches;
+    cv::Mat homography;
+    std::vector<cv::DMatch> inliers;
+    cv::Mat panorama;
+
+    void releaseIntermediates() {
+        img1.release();
+        img2.release();
+        features.clear();
+        matches = MatchingResult();
+        inliers.clear();
+    }
+};
+
+const char* const SWEEP_STAGES[] = {"decode", "detect", "describe", "match", "ratio_test",
+                                    "ransac", "warp", "blend"};
+const char* const SWEEP_METRICS[] = {"keypoints1", "keypoints2", "initial_matches", "good_matches",
+                                     "inliers", "inlier_ratio", "reprojection_error", "ransac_iterations"};
+
+ExperimentConfig makeConfig(const std::string& name, const std::string& detector,
+                            double ransac_threshold, const std::string& blend_mode) {
+    ExperimentConfig config;
+    config.name = name;
+    config.detector_type = detector;
+    config.ransac_threshold = ransac_threshold;
+    config.blend_mode = blend_mode;
+    config.max_features = PanoramaConfig::DEFAULT_MAX_FEATURES;
+    config.ratio_test_threshold = 0.75;
+    return config;
+}
+
+std::string pairName(const std::string& img1_path, const std::string& img2_path) {
+    return fs::path(img1_path).parent_path().filename().string() + "_" +
+           fs::path(img1_path).stem().string() + "_" +
+           fs::path(img2_path).stem().string();
+}
+
+}
+
 ExperimentRunner::ExperimentRunner() {
     results_.clear();
 }
@@ -27,10 +102,28 @@ void ExperimentRunner::runAllExperiments() {
         std::cerr << "Dataset directory not found. Please add images to " << dataset_dir << "\n";
         return;
     }
-    
-    runFeatureDetectorComparison(dataset_dir);
-    runRANSACThresholdExperiment(dataset_dir);
-    runBlendingComparison(dataset_dir);
+
+    std::vector<std::pair<std::string, std::string>> image_pairs;
+    loadDatasets(dataset_dir, image_pairs);
+
+    if (image_pairs.empty()) {
+        std::cout << "No image pairs found in dataset.\n";
+        return;
+    }
+
+    // One sweep for all comparisons, so the configs they have in common
+    // (ORB, threshold 3, feathering) run once.
+    std::vector<ExperimentJob> jobs = detectorComparisonJobs(image_pairs);
+    for (auto& job : ransacThresholdJobs(image_pairs)) {
+        jobs.push_back(std::move(job));
+    }
+    for (auto& job : blendingComparisonJobs(image_pairs)) {
+        jobs.push_back(std::move(job));
+    }
+
+    for (auto& result : runSweep(jobs)) {
+        results_.push_back(std::move(result));
+    }
     
     std::cout << "Experiments completed. " << results_.size() << " results collected.\n";
     
@@ -49,23 +142,9 @@ void ExperimentRunner::runFeatureDetectorComparison(const std::string& dataset_p
         std::cout << "No image pairs found in dataset.\n";
         return;
     }
-    
-    std::vector<std::string> detectors = {"orb", "akaze", "sift"};
-    
-    for (const auto& [img1_path, img2_path] : image_pairs) {
-        for (const auto& detector : detectors) {
-            ExperimentConfig config;
-            config.name = "detector_comparison";
-            config.detector_type = detector;
-            config.ransac_threshold = 3.0;
-            config.blend_mode = "feather";
-            config.max_features = 20000;
-            config.ratio_test_threshold = 0.75;
-            
-            std::cout << "Testing " << detector << " on " << img1_path << "\n";
-            auto result = runSingleExperiment(img1_path, img2_path, config);
-            results_.push_back(result);
-        }
+
+    for (auto& result : runSweep(detectorComparisonJobs(image_pairs))) {
+        results_.push_back(std::move(result));
     }
 }
 
@@ -76,23 +155,9 @@ void ExperimentRunner::runRANSACThresholdExperiment(const std::string& dataset_p
     loadDatasets(dataset_path, image_pairs);
     
     if (image_pairs.empty()) return;
-    
-    std::vector<double> thresholds = {1.0, 2.0, 3.0, 4.0, 5.0};
-    
-    for (const auto& [img1_path, img2_path] : image_pairs) {
-        for (double threshold : thresholds) {
-            ExperimentConfig config;
-            config.name = "ransac_threshold";
-            config.detector_type = "orb";
-            config.ransac_threshold = threshold;
-            config.blend_mode = "feather";
-            config.max_features = 20000;
-            config.ratio_test_threshold = 0.75;
-            
-            std::cout << "Testing RANSAC threshold " << threshold << "\n";
-            auto result = runSingleExperiment(img1_path, img2_path, config);
-            results_.push_back(result);
-        }
+
+    for (auto& result : runSweep(ransacThresholdJobs(image_pairs))) {
+        results_.push_back(std::move(result));
     }
 }
 
@@ -103,168 +168,376 @@ void ExperimentRunner::runBlendingComparison(const std::string& dataset_path) {
     loadDatasets(dataset_path, image_pairs);
     
     if (image_pairs.empty()) return;
-    
-    std::vector<std::string> blend_modes = {"simple", "feather", "multiband"};
-    
+
+    for (auto& result : runSweep(blendingComparisonJobs(image_pairs))) {
+        results_.push_back(std::move(result));
+    }
+}
+
+std::vector<ExperimentJob> ExperimentRunner::detectorComparisonJobs(
+    const std::vector<std::pair<std::string, std::string>>& image_pairs) {
+    std::vector<std::string> detectors = {"orb", "akaze", "sift"};
+
+    std::vector<ExperimentJob> jobs;
+    for (const auto& [img1_path, img2_path] : image_pairs) {
+        for (const auto& detector : detectors) {
+            jobs.push_back({img1_path, img2_path, makeConfig("detector_comparison", detector, 3.0, "feather")});
+        }
+    }
+    return jobs;
+}
+
+std::vector<ExperimentJob> ExperimentRunner::ransacThresholdJobs(
+    const std::vector<std::pair<std::string, std::string>>& image_pairs) {
+    std::vector<double> thresholds = {1.0, 2.0, 3.0, 4.0, 5.0};
+
+    std::vector<ExperimentJob> jobs;
+    for (const auto& [img1_path, img2_path] : image_pairs) {
+        for (double threshold : thresholds) {
+            jobs.push_back({img1_path, img2_path, makeConfig("ransac_threshold", "orb", threshold, "feather")});
+        }
+    }
+    return jobs;
+}
+
+std::vector<ExperimentJob> ExperimentRunner::blendingComparisonJobs(
+    const std::vector<std::pair<std::string, std::string>>& image_pairs) {
+    std::vector<std::string> blend_modes = {"simple", "feather", "multiband", "seam"};
+
+    std::vector<ExperimentJob> jobs;
     for (const auto& [img1_path, img2_path] : image_pairs) {
         for (const auto& mode : blend_modes) {
-            ExperimentConfig config;
-            config.name = "blending_comparison";
-            config.detector_type = "orb";
-            config.ransac_threshold = 3.0;
-            config.blend_mode = mode;
-            config.max_features = 20000;
-            config.ratio_test_threshold = 0.75;
-            
-            std::cout << "Testing blend mode: " << mode << "\n";
-            auto result = runSingleExperiment(img1_path, img2_path, config);
-            results_.push_back(result);
+            jobs.push_back({img1_path, img2_path, makeConfig("blending_comparison", "orb", 3.0, mode)});
         }
     }
+    return jobs;
 }
 
 ExperimentResult ExperimentRunner::runSingleExperiment(
     const std::string& img1_path,
     const std::string& img2_path,
     const ExperimentConfig& config) {
-    
-    ExperimentResult result;
-    result.config = config;
-    
-    auto total_start = std::chrono::high_resolution_clock::now();
-    
-    cv::Mat img1 = cv::imread(img1_path);
-    cv::Mat img2 = cv::imread(img2_path);
-    
-    if (img1.empty() || img2.empty()) {
-        std::cerr << "Failed to load images\n";
-        return result;
+    return runSweep({{img1_path, img2_path, config}}).front();
+}
+
+std::vector<ExperimentResult> ExperimentRunner::runSweep(const std::vector<ExperimentJob>& jobs) {
+    if (jobs.empty()) {
+        return {};
     }
-    
-    std::string exp_name = fs::path(img1_path).parent_path().filename().string() + "_" + 
-                          fs::path(img1_path).stem().string() + "_" + 
-                          fs::path(img2_path).stem().string() + "_" + 
-                          config.detector_type;
-    
+
+    // Each stage's key extends its parent's with the parameters it adds.
+    std::vector<std::unique_ptr<SweepNode>> nodes;
+    std::map<std::string, int> node_index;
+    std::vector<int> job_leaf(jobs.size());
+
+    auto nodeFor = [&](SweepStage stage, const std::string& key, int parent, size_t job) {
+        auto it = node_index.find(key);
+        if (it != node_index.end()) {
+            return it->second;
+        }
+        int id = static_cast<int>(nodes.size());
+        nodes.push_back(std::make_unique<SweepNode>());
+        nodes[id]->stage = stage;
+        nodes[id]->parent = parent;
+        nodes[id]->job = job;
+        if (parent >= 0) {
+            nodes[parent]->children.push_back(id);
+        }
+        node_index.emplace(key, id);
+        return id;
+    };
+
+    for (size_t j = 0; j < jobs.size(); j++) {
+        const ExperimentConfig& config = jobs[j].config;
+        std::string key = jobs[j].img1_path + "\n" + jobs[j].img2_path;
+        int id = nodeFor(SweepStage::DECODE, key, -1, j);
+        key += "\n" + config.detector_type + "\n" + std::to_string(config.max_features);
+        id = nodeFor(SweepStage::DETECT, key, id, j);
+        key += "\n" + std::to_string(config.ratio_test_threshold);
+        id = nodeFor(SweepStage::MATCH, key, id, j);
+        key += "\n" + std::to_string(config.ransac_threshold);
+        id = nodeFor(SweepStage::ESTIMATE, key, id, j);
+        key += "\n" + config.blend_mode;
+        job_leaf[j] = nodeFor(SweepStage::COMPOSE, key, id, j);
+    }
+
+    // Children always come after their parent, so one backward pass
+    // accumulates subtree sizes and leaf counts.
+    for (int id = static_cast<int>(nodes.size()) - 1; id >= 0; id--) {
+        SweepNode& node = *nodes[id];
+        if (node.stage == SweepStage::COMPOSE) {
+            node.pending_leaves = 1;
+        }
+        if (node.parent >= 0) {
+            nodes[node.parent]->subtree_size += node.subtree_size;
+            nodes[node.parent]->pending_leaves += node.pending_leaves;
+        }
+    }
+
+    size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    size_t workers = workers_ > 0
+        ? static_cast<size_t>(workers_)
+        : std::max<size_t>(1, cores / PanoramaConfig::BATCH_THREADS_PER_JOB);
+    workers = std::min(workers, nodes.size());
+
+    std::cout << "Running " << jobs.size() << " experiment configs as " << nodes.size()
+              << " sweep stages on " << workers << " workers\n";
+
     std::string viz_dir = "results/visualizations";
-    if (!fs::exists(viz_dir)) {
+    std::unique_ptr<DiagnosticsSink> diagnostics;
+    if (write_visualizations_) {
         fs::create_directories(viz_dir);
+        diagnostics = std::make_unique<DiagnosticsSink>(DiagnosticsLevel::FULL, viz_dir);
     }
-    
-    cv::imwrite(viz_dir + "/" + exp_name + "_img1.jpg", img1);
-    cv::imwrite(viz_dir + "/" + exp_name + "_img2.jpg", img2);
-    
-    std::unique_ptr<FeatureDetector> detector;
-    try {
-        detector = DetectorFactory::createDetector(config.detector_type);
-    } catch (const std::exception& e) {
-        std::cerr << "Error creating detector: " << e.what() << "\n";
-        return ExperimentResult{};
-    }
-    detector->setMaxFeatures(config.max_features);
-    
-    auto det_result1 = detector->detect(img1);
-    auto det_result2 = detector->detect(img2);
-    
-    result.num_keypoints_img1 = det_result1.getKeypointCount();
-    result.num_keypoints_img2 = det_result2.getKeypointCount();
-    result.detection_time_ms = det_result1.detection_time_ms + det_result2.detection_time_ms;
-    result.description_time_ms = det_result1.description_time_ms + det_result2.description_time_ms;
-    
-    cv::Mat kp_vis1, kp_vis2;
-    cv::drawKeypoints(img1, det_result1.keypoints, kp_vis1, cv::Scalar(0, 255, 0), 
-                     cv::DrawMatchesFlags::DRAW_RICH_KEYPOINTS);
-    cv::drawKeypoints(img2, det_result2.keypoints, kp_vis2, cv::Scalar(0, 255, 0),
-                     cv::DrawMatchesFlags::DRAW_RICH_KEYPOINTS);
-    cv::imwrite(viz_dir + "/" + exp_name + "_keypoints1.jpg", kp_vis1);
-    cv::imwrite(viz_dir + "/" + exp_name + "_keypoints2.jpg", kp_vis2);
-    
-    FeatureMatcher matcher;
-    if (config.detector_type == "sift") {
-        matcher.setMatcherType("BruteForce-L2");
-    } else {
-        matcher.setMatcherType("BruteForce-Hamming");
+
+    auto ancestor = [&](int id, SweepStage stage) -> SweepNode& {
+        while (nodes[id]->stage != stage) {
+            id = nodes[id]->parent;
+        }
+        return *nodes[id];
+    };
+
+    auto runNode = [&](int id) {
+        SweepNode& node = *nodes[id];
+        const ExperimentJob& job = jobs[node.job];
+        const ExperimentConfig& config = job.config;
+
+        StitchingOptions options;
+        options.detector_type = config.detector_type;
+        options.blend_mode = config.blend_mode;
+        options.ransac_threshold = config.ransac_threshold;
+        options.max_features = config.max_features;
+        options.cache_dir = cache_dir_;
+        options.cache_registrations = false;
+        options.profiler = &node.profiler;
+
+        std::string tag = pairName(job.img1_path, job.img2_path) + "_" + config.detector_type;
+
+        switch (node.stage) {
+            case SweepStage::DECODE: {
+                {
+                    StageProfiler::Scope timer(&node.profiler, "decode");
+                    node.img1 = cv::imread(job.img1_path);
+                    node.img2 = cv::imread(job.img2_path);
+                }
+                node.ok = !node.img1.empty() && !node.img2.empty();
+                if (!node.ok) {
+                    std::cerr << "Failed to load images " << job.img1_path << " and " << job.img2_path << "\n";
+                } else if (write_visualizations_) {
+                    std::string base = viz_dir + "/" + pairName(job.img1_path, job.img2_path);
+                    cv::imwrite(base + "_img1.jpg", node.img1);
+                    cv::imwrite(base + "_img2.jpg", node.img2);
+                }
+                break;
+            }
+            case SweepStage::DETECT: {
+                const SweepNode& decoded = ancestor(id, SweepStage::DECODE);
+                node.features = StitchingPipeline::detectAll({decoded.img1, decoded.img2}, options);
+                node.ok = node.features.size() == 2;
+                if (!node.ok) break;
+
+                node.profiler.setMetric("keypoints1", static_cast<double>(node.features[0].keypoints.size()));
+                node.profiler.setMetric("keypoints2", static_cast<double>(node.features[1].keypoints.size()));
+                if (diagnostics) {
+                    node.stitch_id = diagnostics->beginStitch();
+                    diagnostics->recordKeypoints(node.stitch_id, tag, decoded.img1, node.features[0].keypoints,
+                                                 decoded.img2, node.features[1].keypoints);
+                }
+                break;
+            }
+            case SweepStage::MATCH: {
+                const SweepNode& decoded = ancestor(id, SweepStage::DECODE);
+                const SweepNode& detected = *nodes[node.parent];
+                node.stitch_id = detected.stitch_id;
+                node.matches = StitchingPipeline::matchPair(detected.features[0], detected.features[1], options);
+                node.ok = true;
+
+                node.profiler.setMetric("initial_matches", node.matches.num_initial_matches);
+                node.profiler.setMetric("good_matches", node.matches.num_good_matches);
+                node.profiler.setSeries("match_distances", node.matches.match_distances);
+                if (diagnostics) {
+                    diagnostics->recordMatches(node.stitch_id, tag, "before_ransac",
+                                               decoded.img1, detected.features[0].keypoints,
+                                               decoded.img2, detected.features[1].keypoints,
+                                               node.matches.good_matches);
+                }
+                break;
+            }
+            case SweepStage::ESTIMATE: {
+                const SweepNode& decoded = ancestor(id, SweepStage::DECODE);
+                const SweepNode& detected = ancestor(id, SweepStage::DETECT);
+                const SweepNode& matched = *nodes[node.parent];
+                node.stitch_id = matched.stitch_id;
+
+                HomographyEstimator estimator;
+                estimator.setRANSACThreshold(options.ransac_threshold);
+                estimator.setBackend(HomographyEstimator::stringToBackend(options.estimator_backend));
+                {
+                    StageProfiler::Scope timer(&node.profiler, "ransac");
+                    node.homography = estimator.estimateHomography(
+                        detected.features[0].keypoints, detected.features[1].keypoints,
+                        matched.matches.good_matches, matched.matches.match_ratios, node.inliers);
+                }
+
+                RANSACResult ransac = estimator.getLastResult();
+                node.profiler.setMetric("inliers", ransac.num_inliers);
+                node.profiler.setMetric("inlier_ratio", ransac.inlier_ratio);
+                node.profiler.setMetric("reprojection_error", ransac.reprojection_error);
+                node.profiler.setMetric("ransac_iterations", ransac.num_iterations);
+                if (diagnostics) {
+                    std::ostringstream stage;
+                    stage << "after_ransac_t" << config.ransac_threshold;
+                    diagnostics->recordMatches(node.stitch_id, tag, stage.str(),
+                                               decoded.img1, detected.features[0].keypoints,
+                                               decoded.img2, detected.features[1].keypoints,
+                                               node.inliers);
+                }
+                node.ok = StitchingPipeline::validateHomography(node.homography, ransac.num_inliers);
+                break;
+            }
+            case SweepStage::COMPOSE: {
+                const SweepNode& decoded = ancestor(id, SweepStage::DECODE);
+                const SweepNode& estimated = *nodes[node.parent];
+                node.panorama = StitchingPipeline::composePair(decoded.img1, decoded.img2,
+                                                               estimated.homography, options, nullptr);
+                node.ok = !node.panorama.empty();
+                break;
+            }
+        }
+    };
+
+    std::mutex mutex;
+    std::condition_variable finished;
+    int remaining = static_cast<int>(nodes.size());
+
+    {
+        ThreadPool pool(workers);
+        int previous_threads = cv::getNumThreads();
+        cv::setNumThreads(static_cast<int>(std::max<size_t>(1, cores / workers)));
+
+        std::function<void(int)> schedule = [&](int id) {
+            pool.submit([&, id]() {
+                SweepNode& node = *nodes[id];
+                try {
+                    runNode(id);
+                } catch (const std::exception& e) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    std::cerr << "Error: Experiment stage failed: " << e.what() << "\n";
+                    node.ok = false;
+                }
+
+                if (node.ok) {
+                    for (int child : node.children) {
+                        schedule(child);
+                    }
+                }
+
+                std::lock_guard<std::mutex> lock(mutex);
+                // A finished leaf, or a failed node with the leaves it cuts
+                // off, is no longer waited on by its ancestors.
+                if (!node.ok || node.stage == SweepStage::COMPOSE) {
+                    int done_leaves = node.pending_leaves;
+                    for (int up = id; up >= 0; up = nodes[up]->parent) {
+                        SweepNode& ancestor_node = *nodes[up];
+                        ancestor_node.pending_leaves -= done_leaves;
+                        if (ancestor_node.pending_leaves == 0) {
+                            ancestor_node.releaseIntermediates();
+                        }
+                    }
+                }
+                remaining -= node.ok ? 1 : node.subtree_size;
+                finished.notify_all();
+            });
+        };
+
+        for (int id = 0; id < static_cast<int>(nodes.size()); id++) {
+            if (nodes[id]->parent < 0) {
+                schedule(id);
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [&]() { return remaining == 0; });
+        lock.unlock();
+
+        cv::setNumThreads(previous_threads);
     }
-    auto match_result = matcher.matchFeatures(
-        det_result1.descriptors, det_result2.descriptors,
-        det_result1.keypoints, det_result2.keypoints,
-        config.ratio_test_threshold
-    );
-    
-    result.num_initial_matches = match_result.num_initial_matches;
-    result.num_good_matches = match_result.num_good_matches;
-    result.matching_time_ms = match_result.matching_time_ms;
-    result.match_distances = match_result.match_distances;
-    
-    cv::Mat match_vis;
-    cv::drawMatches(img1, det_result1.keypoints, img2, det_result2.keypoints,
-                   match_result.good_matches, match_vis, cv::Scalar(0, 255, 0),
-                   cv::Scalar(255, 0, 0), std::vector<char>(),
-                   cv::DrawMatchesFlags::NOT_DRAW_SINGLE_POINTS);
-    cv::imwrite(viz_dir + "/" + exp_name + "_matches_before_ransac.jpg", match_vis);
-    
-    auto h_start = std::chrono::high_resolution_clock::now();
-    HomographyEstimator h_estimator;
-    h_estimator.setRANSACThreshold(config.ransac_threshold);
-    
-    std::vector<cv::DMatch> inlier_matches;
-    cv::Mat homography = h_estimator.estimateHomography(
-        det_result1.keypoints, det_result2.keypoints,
-        match_result.good_matches, inlier_matches
-    );
-    auto h_end = std::chrono::high_resolution_clock::now();
-    
-    auto ransac_result = h_estimator.getLastResult();
-    result.num_inliers = ransac_result.num_inliers;
-    result.inlier_ratio = ransac_result.inlier_ratio;
-    result.reprojection_error = ransac_result.reprojection_error;
-    result.ransac_iterations = ransac_result.num_iterations;
-    result.homography_time_ms = std::chrono::duration<double, std::milli>(h_end - h_start).count();
-    
-    if (!inlier_matches.empty()) {
-        cv::Mat inlier_vis;
-        cv::drawMatches(img1, det_result1.keypoints, img2, det_result2.keypoints,
-                       inlier_matches, inlier_vis, cv::Scalar(0, 255, 0),
-                       cv::Scalar(255, 0, 0), std::vector<char>(),
-                       cv::DrawMatchesFlags::NOT_DRAW_SINGLE_POINTS);
-        cv::imwrite(viz_dir + "/" + exp_name + "_matches_after_ransac.jpg", inlier_vis);
+
+    if (diagnostics) {
+        diagnostics->flush();
     }
-    
-    if (!homography.empty()) {
-        auto warp_start = std::chrono::high_resolution_clock::now();
-        ImageWarper warper;
-        auto bounds = HomographyEstimator::calculateOutputBounds(img1, img2, homography);
-        cv::Mat panorama = cv::Mat::zeros(bounds.height, bounds.width, img1.type());
-        img1.copyTo(panorama(cv::Rect(0, 0, img1.cols, img1.rows)));
-        
-        cv::Mat warped2 = warper.warpPerspective(img2, homography, panorama.size());
-        auto warp_end = std::chrono::high_resolution_clock::now();
-        result.warping_time_ms = std::chrono::duration<double, std::milli>(warp_end - warp_start).count();
-        
-        auto blend_start = std::chrono::high_resolution_clock::now();
-        std::unique_ptr<Blender> blender;
-        try {
-            blender = BlenderFactory::createBlender(config.blend_mode);
-        } catch (const std::exception& e) {
-            std::cerr << "Error creating blender: " << e.what() << "\n";
-            return ExperimentResult{};
+
+    std::vector<ExperimentResult> results;
+    results.reserve(jobs.size());
+
+    for (size_t j = 0; j < jobs.size(); j++) {
+        const ExperimentJob& job = jobs[j];
+        std::string exp_name = pairName(job.img1_path, job.img2_path) + "_" + job.config.detector_type;
+
+        // The job's profile merges the nodes on its path, root first.
+        std::vector<const SweepNode*> path;
+        for (int id = job_leaf[j]; id >= 0; id = nodes[id]->parent) {
+            path.insert(path.begin(), nodes[id].get());
+        }
+
+        StageProfiler profiler(job.config.name + "/" + exp_name);
+        double total_ms = 0.0;
+        for (const SweepNode* node : path) {
+            for (const char* name : SWEEP_STAGES) {
+                StageStats stats = node->profiler.stage(name);
+                if (stats.calls > 0) {
+                    profiler.record(name, stats.time_ms, stats.peak_bytes);
+                    if (std::string(name) != "describe" && std::string(name) != "ratio_test") {
+                        total_ms += stats.time_ms;
+                    }
+                }
+            }
+            for (const char* name : SWEEP_METRICS) {
+                double value = node->profiler.metric(name, std::numeric_limits<double>::quiet_NaN());
+                if (!std::isnan(value)) {
+                    profiler.setMetric(name, value);
+                }
+            }
+            std::vector<double> distances = node->profiler.series("match_distances");
+            if (!distances.empty()) {
+                profiler.setSeries("match_distances", std::move(distances));
+            }
         }
-        
-        cv::Mat mask1 = cv::Mat::zeros(panorama.size(), CV_8UC1);
-        mask1(cv::Rect(0, 0, img1.cols, img1.rows)) = 255;
-        cv::Mat mask2;
-        cv::warpPerspective(cv::Mat::ones(img2.size(), CV_8UC1) * 255, 
-                           mask2, homography, panorama.size());
-        
-        result.panorama = blender->blend(panorama, warped2, mask1, mask2);
-        auto blend_end = std::chrono::high_resolution_clock::now();
-        result.blending_time_ms = std::chrono::duration<double, std::milli>(blend_end - blend_start).count();
+
+        ExperimentResult result{};
+        result.config = job.config;
+        result.panorama = nodes[job_leaf[j]]->panorama;
+
+        result.num_keypoints_img1 = static_cast<int>(profiler.metric("keypoints1"));
+        result.num_keypoints_img2 = static_cast<int>(profiler.metric("keypoints2"));
+        result.detection_time_ms = profiler.stage("detect").time_ms;
+        result.description_time_ms = profiler.stage("describe").time_ms;
+
+        result.num_initial_matches = static_cast<int>(profiler.metric("initial_matches"));
+        result.num_good_matches = static_cast<int>(profiler.metric("good_matches"));
+        result.num_inliers = static_cast<int>(profiler.metric("inliers"));
+        result.inlier_ratio = profiler.metric("inlier_ratio");
+        result.matching_time_ms = profiler.stage("match").time_ms;
+        result.match_distances = profiler.series("match_distances");
+
+        result.homography_time_ms = profiler.stage("ransac").time_ms;
+        result.reprojection_error = profiler.metric("reprojection_error");
+        result.ransac_iterations = static_cast<int>(profiler.metric("ransac_iterations"));
+
+        result.warping_time_ms = profiler.stage("warp").time_ms;
+        result.blending_time_ms = profiler.stage("blend").time_ms;
+        result.total_time_ms = total_ms;
+
+        if (!profile_path_.empty()) {
+            profiler.setMetric("total_ms", total_ms);
+            profiler.setMetric("success", result.panorama.empty() ? 0.0 : 1.0);
+            profiler.appendJsonLine(profile_path_);
+        }
+
+        results.push_back(std::move(result));
     }
-    
-    auto total_end = std::chrono::high_resolution_clock::now();
-    result.total_time_ms = std::chrono::duration<double, std::milli>(total_end - total_start).count();
-    
-    return result;
+
+    return results;
 }
 
 void ExperimentRunner::loadDatasets(const std::string& dataset_dir,
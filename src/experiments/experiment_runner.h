@@ -15,6 +15,12 @@ struct ExperimentConfig {
     double ratio_test_threshold;
 };
 
+struct ExperimentJob {
+    std::string img1_path;
+    std::string img2_path;
+    ExperimentConfig config;
+};
+
 struct ExperimentResult {
     ExperimentConfig config;
     
@@ -55,6 +61,13 @@ public:
         const std::string& img2_path,
         const ExperimentConfig& config
     );
+
+    // Runs the jobs as a DAG of decode, detect, match, RANSAC and compose
+    // nodes. Jobs that agree on everything feeding a stage share its node,
+    // so e.g. a RANSAC threshold sweep detects and matches each pair once,
+    // and independent nodes run in parallel. A shared node's timings are
+    // reported for every job that uses it. Results follow the job order.
+    std::vector<ExperimentResult> runSweep(const std::vector<ExperimentJob>& jobs);
     
     void saveResults(const std::string& output_dir);
     void generateReport(const std::string& output_path);
@@ -63,9 +76,34 @@ public:
     void exportMatchDistances(const std::string& output_dir);
 
     const std::vector<ExperimentResult>& getResults() const { return results_; }
+
+    // Detection cache shared by all configs; an empty path disables it.
+    void setCacheDir(const std::string& cache_dir) { cache_dir_ = cache_dir; }
+
+    // Every run appends its stage profile here as a JSON line; an empty
+    // path disables it.
+    void setProfilePath(const std::string& profile_path) { profile_path_ = profile_path; }
+
+    // Sweep nodes run concurrently; 0 picks a count from the cores. Use 1
+    // for timings free of contention.
+    void setWorkers(int workers) { workers_ = workers; }
+
+    // Input, keypoint and match images under results/visualizations.
+    void setWriteVisualizations(bool write) { write_visualizations_ = write; }
     
 private:
     std::vector<ExperimentResult> results_;
+    std::string cache_dir_ = "results/cache";
+    std::string profile_path_ = "results/stage_profiles.jsonl";
+    int workers_ = 0;
+    bool write_visualizations_ = true;
+
+    static std::vector<ExperimentJob> detectorComparisonJobs(
+        const std::vector<std::pair<std::string, std::string>>& image_pairs);
+    static std::vector<ExperimentJob> ransacThresholdJobs(
+        const std::vector<std::pair<std::string, std::string>>& image_pairs);
+    static std::vector<ExperimentJob> blendingComparisonJobs(
+        const std::vector<std::pair<std::string, std::string>>& image_pairs);
     
     void loadDatasets(const std::string& dataset_dir,
                      std::vector<std::pair<std::string, std::string>>& image_pairs);
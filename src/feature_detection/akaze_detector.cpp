@@ -2,7 +2,6 @@
 #include <opencv2/imgproc.hpp>
 #include <algorithm>
 #include <utility>
-#include <cstddef>
 #include <iostream>
 
 AKAZEDetector::AKAZEDetector() {
@@ -26,7 +25,7 @@ void AKAZEDetector::setMaxFeatures(int max_features) {
     }
 }
 
-DetectionResult AKAZEDetector::detect(const cv::Mat& image) {
+DetectionResult AKAZEDetector::detectInRegion(const cv::Mat& image, const cv::Mat& mask) {
     DetectionResult result;
     result.detector_name = "AKAZE";
     
@@ -36,6 +35,10 @@ DetectionResult AKAZEDetector::detect(const cv::Mat& image) {
     } else {
         gray = image;
     }
+
+    if (threshold_mode_ == ThresholdMode::SINGLE_PASS) {
+        return detectSinglePass(gray, mask);
+    }
     
     resetDetector();
 
@@ -43,12 +46,12 @@ DetectionResult AKAZEDetector::detect(const cv::Mat& image) {
     double total_detection_time_ms = 0.0;
     bool threshold_adjusted = false;
     float used_threshold = current_threshold_;
-    const size_t target_features = max_features_ > 0 ? static_cast<size_t>(max_features_) : 0;
+    const size_t target_features = max_features_ > 0 ? static_cast<size_t>(candidateBudget()) : 0;
 
     for (int iter = 0; iter <= MAX_ADAPTIVE_STEPS; ++iter) {
         std::vector<cv::KeyPoint> iteration_keypoints;
         total_detection_time_ms += measureTime([&]() {
-            detector_->detect(gray, iteration_keypoints);
+            detector_->detect(gray, iteration_keypoints, mask);
         });
 
         best_keypoints = std::move(iteration_keypoints);
@@ -70,20 +73,11 @@ DetectionResult AKAZEDetector::detect(const cv::Mat& image) {
 
     if (threshold_adjusted && used_threshold != base_threshold_) {
         std::cout << "AKAZE adjusted threshold to " << used_threshold
-                  << " (target " << max_features_
+                  << " (target " << target_features
                   << ", found " << best_keypoints.size() << ")" << std::endl;
     }
 
-    if (target_features > 0 && best_keypoints.size() > target_features) {
-        auto cutoff = best_keypoints.begin() + static_cast<std::ptrdiff_t>(max_features_);
-        std::partial_sort(best_keypoints.begin(),
-                         cutoff,
-                         best_keypoints.end(),
-                         [](const cv::KeyPoint& a, const cv::KeyPoint& b) {
-                             return a.response > b.response;
-                         });
-        best_keypoints.resize(max_features_);
-    }
+    selectKeypoints(best_keypoints, gray.size());
 
     result.description_time_ms = measureTime([&]() {
         detector_->compute(gray, best_keypoints, result.descriptors);
@@ -95,3 +89,77 @@ DetectionResult AKAZEDetector::detect(const cv::Mat& image) {
     
     return result;
 }
+
+DetectionResult AKAZEDetector::detectSinglePass(const cv::Mat& gray, const cv::Mat& mask) {
+    DetectionResult result;
+    result.detector_name = "AKAZE";
+
+    const size_t target_features = max_features_ > 0 ? static_cast<size_t>(candidateBudget()) : 0;
+
+    float start_threshold = scene_threshold_;
+    float floor_threshold = start_threshold;
+    if (target_features > 0) {
+        for (int step = 0; step < MAX_ADAPTIVE_STEPS; ++step) {
+            floor_threshold = std::max(floor_threshold * THRESHOLD_DECAY, MIN_THRESHOLD);
+        }
+    }
+
+    if (current_threshold_ != floor_threshold) {
+        current_threshold_ = floor_threshold;
+        createDetector();
+    }
+
+    std::vector<cv::KeyPoint> candidates;
+    cv::Mat candidate_descriptors;
+    result.detection_time_ms = measureTime([&]() {
+        detector_->detectAndCompute(gray, mask, candidates, candidate_descriptors);
+    });
+
+    auto countAbove = [&](float threshold) {
+        return static_cast<size_t>(std::count_if(candidates.begin(), candidates.end(),
+            [threshold](const cv::KeyPoint& kp) { return kp.response >= threshold; }));
+    };
+
+    // Every candidate passed the floor threshold, so detection at any higher
+    // threshold is reproduced by filtering on the response.
+    float used_threshold = start_threshold;
+    if (target_features > 0) {
+        while (used_threshold > floor_threshold && countAbove(used_threshold) < target_features) {
+            used_threshold = std::max(used_threshold * THRESHOLD_DECAY, floor_threshold);
+        }
+        while (used_threshold < base_threshold_ &&
+               countAbove(std::min(used_threshold / THRESHOLD_DECAY, base_threshold_)) >= target_features) {
+            used_threshold = std::min(used_threshold / THRESHOLD_DECAY, base_threshold_);
+        }
+    }
+
+    if (used_threshold != scene_threshold_) {
+        std::cout << "AKAZE adjusted threshold to " << used_threshold
+                  << " (target " << target_features
+                  << ", found " << countAbove(used_threshold) << ")" << std::endl;
+    }
+    scene_threshold_ = used_threshold;
+
+    result.description_time_ms = measureTime([&]() {
+        std::vector<int> passing;
+        std::vector<cv::KeyPoint> filtered;
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            if (candidates[i].response >= used_threshold) {
+                passing.push_back(static_cast<int>(i));
+                filtered.push_back(candidates[i]);
+            }
+        }
+
+        std::vector<int> selected;
+        selectKeypoints(filtered, gray.size(), &selected);
+
+        result.descriptors.create(static_cast<int>(selected.size()), candidate_descriptors.cols,
+                                  candidate_descriptors.type());
+        for (size_t i = 0; i < selected.size(); ++i) {
+            candidate_descriptors.row(passing[selected[i]]).copyTo(result.descriptors.row(static_cast<int>(i)));
+        }
+        result.keypoints = std::move(filtered);
+    });
+
+    return result;
+}
@@ -6,11 +6,27 @@
 
 class AKAZEDetector : public FeatureDetector {
 public:
+    // SINGLE_PASS builds the nonlinear scale space once at the lowest
+    // threshold the adaptive schedule can reach and replays the schedule on
+    // the candidate responses. ADAPTIVE re-runs detection for every step.
+    enum class ThresholdMode {
+        ADAPTIVE,
+        SINGLE_PASS
+    };
+
     AKAZEDetector();
-    DetectionResult detect(const cv::Mat& image) override;
+    DetectionResult detectInRegion(const cv::Mat& image, const cv::Mat& mask) override;
     std::string getName() const override { return "AKAZE"; }
     void setMaxFeatures(int max_features) override;
 
+    void setThresholdMode(ThresholdMode mode) { threshold_mode_ = mode; }
+    ThresholdMode getThresholdMode() const { return threshold_mode_; }
+
+    // In SINGLE_PASS mode the threshold that met the target on one image is
+    // where the schedule starts on the next one.
+    float getSceneThreshold() const { return scene_threshold_; }
+    void setSceneThreshold(float threshold) { scene_threshold_ = threshold; }
+
 private:
     cv::Ptr<cv::AKAZE> detector_;
     float base_threshold_ = 0.001f;
@@ -18,8 +34,11 @@ private:
     static constexpr float MIN_THRESHOLD = 2.5e-4f;
     static constexpr float THRESHOLD_DECAY = 0.6f;
     static constexpr int MAX_ADAPTIVE_STEPS = 3;
+    ThresholdMode threshold_mode_ = ThresholdMode::SINGLE_PASS;
+    float scene_threshold_ = base_threshold_;
     void createDetector();
     void resetDetector();
+    DetectionResult detectSinglePass(const cv::Mat& gray, const cv::Mat& mask);
 };
 
 #endif
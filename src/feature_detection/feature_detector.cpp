@@ -0,0 +1,93 @@
+#include "feature_detector.h"
+#include "../config.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <numeric>
+
+int FeatureDetector::candidateBudget() const {
+    if (!uniform_selection_ || max_features_ <= 0) {
+        return max_features_;
+    }
+    long long candidates = static_cast<long long>(max_features_) * PanoramaConfig::UNIFORM_CANDIDATE_FACTOR;
+    return static_cast<int>(std::min<long long>(candidates, PanoramaConfig::MAX_UNIFORM_CANDIDATES));
+}
+
+void FeatureDetector::selectKeypoints(std::vector<cv::KeyPoint>& keypoints, const cv::Size& image_size,
+                                      std::vector<int>* selected) const {
+    const size_t n = keypoints.size();
+    std::vector<int> order(n);
+    std::iota(order.begin(), order.end(), 0);
+
+    if (max_features_ <= 0 || n <= static_cast<size_t>(max_features_)) {
+        if (selected) {
+            *selected = std::move(order);
+        }
+        return;
+    }
+
+    const size_t budget = static_cast<size_t>(max_features_);
+    auto cutoff = order.begin() + static_cast<std::ptrdiff_t>(budget);
+
+    if (!uniform_selection_ || image_size.width <= 0 || image_size.height <= 0) {
+        std::partial_sort(order.begin(), cutoff, order.end(), [&](int a, int b) {
+            return keypoints[a].response > keypoints[b].response;
+        });
+        gatherKeypoints(keypoints, order, budget, selected);
+        return;
+    }
+
+    // Cells are sized so that an even spread gives each of them about
+    // UNIFORM_KEYPOINTS_PER_CELL keypoints.
+    double cells = std::max(1.0, static_cast<double>(budget) / PanoramaConfig::UNIFORM_KEYPOINTS_PER_CELL);
+    double cell_size = std::max(1.0, std::sqrt(static_cast<double>(image_size.area()) / cells));
+    int grid_w = std::max(1, static_cast<int>(std::ceil(image_size.width / cell_size)));
+    int grid_h = std::max(1, static_cast<int>(std::ceil(image_size.height / cell_size)));
+
+    std::vector<int> cell_of(n);
+    for (size_t i = 0; i < n; i++) {
+        int cx = std::min(grid_w - 1, std::max(0, static_cast<int>(keypoints[i].pt.x / cell_size)));
+        int cy = std::min(grid_h - 1, std::max(0, static_cast<int>(keypoints[i].pt.y / cell_size)));
+        cell_of[i] = cy * grid_w + cx;
+    }
+
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        if (cell_of[a] != cell_of[b]) {
+            return cell_of[a] < cell_of[b];
+        }
+        return keypoints[a].response > keypoints[b].response;
+    });
+
+    std::vector<int> rank(n);
+    for (size_t i = 0; i < n; i++) {
+        int idx = order[i];
+        rank[idx] = (i > 0 && cell_of[order[i - 1]] == cell_of[idx]) ? rank[order[i - 1]] + 1 : 0;
+    }
+
+    // The best keypoint of every cell goes before the second best of any
+    // cell, so sparse cells keep everything and dense cells share the rest.
+    std::nth_element(order.begin(), cutoff, order.end(), [&](int a, int b) {
+        if (rank[a] != rank[b]) {
+            return rank[a] < rank[b];
+        }
+        return keypoints[a].response > keypoints[b].response;
+    });
+
+    gatherKeypoints(keypoints, order, budget, selected);
+}
+
+void FeatureDetector::gatherKeypoints(std::vector<cv::KeyPoint>& keypoints, std::vector<int>& order,
+                                      size_t count, std::vector<int>* selected) {
+    order.resize(count);
+
+    std::vector<cv::KeyPoint> kept;
+    kept.reserve(count);
+    for (int idx : order) {
+        kept.push_back(keypoints[idx]);
+    }
+    keypoints = std::move(kept);
+
+    if (selected) {
+        *selected = std::move(order);
+    }
+}
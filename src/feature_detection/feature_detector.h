@@ -22,15 +22,32 @@ public:
     FeatureDetector() = default;
     virtual ~FeatureDetector() = default;
     
-    virtual DetectionResult detect(const cv::Mat& image) = 0;
+    virtual DetectionResult detect(const cv::Mat& image) { return detectInRegion(image, cv::Mat()); }
+
+    // Only searches where mask is non-zero; an empty mask means the whole image.
+    virtual DetectionResult detectInRegion(const cv::Mat& image, const cv::Mat& mask) = 0;
     virtual std::string getName() const = 0;
     
     virtual void setMaxFeatures(int max_features) { max_features_ = max_features; }
     int getMaxFeatures() const { return max_features_; }
-    
+
+    // Spreads the feature budget over a grid instead of keeping the global
+    // top responses, so textured areas cannot starve the rest of the image.
+    virtual void setUniformSelection(bool enabled) { uniform_selection_ = enabled; }
+    bool getUniformSelection() const { return uniform_selection_; }
     
 protected:
     int max_features_ = 50000;
+    bool uniform_selection_ = true;
+
+    // How many keypoints to ask the underlying detector for before
+    // selectKeypoints trims them to max_features_.
+    int candidateBudget() const;
+
+    // When `selected` is given it receives the original index of every kept
+    // keypoint, e.g. to pick the matching descriptor rows.
+    void selectKeypoints(std::vector<cv::KeyPoint>& keypoints, const cv::Size& image_size,
+                         std::vector<int>* selected = nullptr) const;
     
     template<typename Func>
     double measureTime(Func func) {
@@ -39,6 +56,10 @@ protected:
         auto end = std::chrono::high_resolution_clock::now();
         return std::chrono::duration<double, std::milli>(end - start).count();
     }
+
+private:
+    static void gatherKeypoints(std::vector<cv::KeyPoint>& keypoints, std::vector<int>& order,
+                                size_t count, std::vector<int>* selected);
 };
 
 #endif
\ No newline at end of file
@@ -6,7 +6,7 @@ ORBDetector::ORBDetector() {
 }
 
 void ORBDetector::createDetector() {
-    detector_ = cv::ORB::create(max_features_, 1.2f, 8, 31, 0, 2,
+    detector_ = cv::ORB::create(candidateBudget(), 1.2f, 8, 31, 0, 2,
                                cv::ORB::HARRIS_SCORE, 31, 20);
 }
 
@@ -17,7 +17,14 @@ void ORBDetector::setMaxFeatures(int max_features) {
     }
 }
 
-DetectionResult ORBDetector::detect(const cv::Mat& image) {
+void ORBDetector::setUniformSelection(bool enabled) {
+    if (enabled != uniform_selection_) {
+        uniform_selection_ = enabled;
+        createDetector();
+    }
+}
+
+DetectionResult ORBDetector::detectInRegion(const cv::Mat& image, const cv::Mat& mask) {
     DetectionResult result;
     result.detector_name = "ORB";
     
@@ -29,7 +36,8 @@ DetectionResult ORBDetector::detect(const cv::Mat& image) {
     }
     
     result.detection_time_ms = measureTime([&]() {
-        detector_->detect(gray, result.keypoints);
+        detector_->detect(gray, result.keypoints, mask);
+        selectKeypoints(result.keypoints, gray.size());
     });
     
     result.description_time_ms = measureTime([&]() {
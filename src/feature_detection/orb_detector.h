@@ -7,9 +7,10 @@
 class ORBDetector : public FeatureDetector {
 public:
     ORBDetector();
-    DetectionResult detect(const cv::Mat& image) override;
+    DetectionResult detectInRegion(const cv::Mat& image, const cv::Mat& mask) override;
     std::string getName() const override { return "ORB"; }
     void setMaxFeatures(int max_features) override;
+    void setUniformSelection(bool enabled) override;
     
 private:
     cv::Ptr<cv::ORB> detector_;
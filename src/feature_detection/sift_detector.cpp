@@ -11,7 +11,7 @@ SIFTDetector::SIFTDetector() {
 
 void SIFTDetector::createDetector() {
     detector_ = cv::SIFT::create(
-        max_features_,
+        candidateBudget(),
         3,
         0.04,
         10,
@@ -26,7 +26,14 @@ void SIFTDetector::setMaxFeatures(int max_features) {
     }
 }
 
-DetectionResult SIFTDetector::detect(const cv::Mat& image) {
+void SIFTDetector::setUniformSelection(bool enabled) {
+    if (enabled != uniform_selection_) {
+        uniform_selection_ = enabled;
+        createDetector();
+    }
+}
+
+DetectionResult SIFTDetector::detectInRegion(const cv::Mat& image, const cv::Mat& mask) {
     DetectionResult result;
     result.detector_name = "SIFT";
 
@@ -38,7 +45,8 @@ DetectionResult SIFTDetector::detect(const cv::Mat& image) {
     }
 
     result.detection_time_ms = measureTime([&]() {
-        detector_->detect(gray, result.keypoints);
+        detector_->detect(gray, result.keypoints, mask);
+        selectKeypoints(result.keypoints, gray.size());
     });
 
     result.description_time_ms = measureTime([&]() {
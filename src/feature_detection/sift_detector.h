@@ -7,9 +7,10 @@
 class SIFTDetector : public FeatureDetector {
 public:
     SIFTDetector();
-    DetectionResult detect(const cv::Mat& image) override;
+    DetectionResult detectInRegion(const cv::Mat& image, const cv::Mat& mask) override;
     std::string getName() const override { return "SIFT"; }
     void setMaxFeatures(int max_features) override;
+    void setUniformSelection(bool enabled) override;
 
 private:
     cv::Ptr<cv::SIFT> detector_;
@@ -0,0 +1,49 @@
+#include "descriptor_index.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+DescriptorIndex::DescriptorIndex(const cv::Mat& descriptors, int trees, int checks)
+    : checks_(checks) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // FLANN keeps a reference to the data, so hold our own float copy.
+    descriptors.convertTo(descriptors_, CV_32F);
+    if (!descriptors_.empty()) {
+        index_.build(descriptors_, cv::flann::KDTreeIndexParams(trees));
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    build_time_ms_ = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void DescriptorIndex::knnMatch(const cv::Mat& query_descriptors,
+                               std::vector<std::vector<cv::DMatch>>& knn_matches, int k) {
+    knn_matches.clear();
+    query_count_++;
+
+    k = std::min(k, descriptors_.rows);
+    if (query_descriptors.empty() || k <= 0) {
+        return;
+    }
+
+    cv::Mat query;
+    query_descriptors.convertTo(query, CV_32F);
+
+    cv::Mat indices(query.rows, k, CV_32S);
+    cv::Mat distances(query.rows, k, CV_32F);
+    index_.knnSearch(query, indices, distances, k, cv::flann::SearchParams(checks_));
+
+    knn_matches.resize(query.rows);
+    for (int q = 0; q < query.rows; q++) {
+        const int* idx = indices.ptr<int>(q);
+        const float* dist = distances.ptr<float>(q);
+        for (int j = 0; j < k; j++) {
+            if (idx[j] < 0) {
+                break;
+            }
+            // FLANN reports squared L2 distances.
+            knn_matches[q].emplace_back(q, idx[j], std::sqrt(dist[j]));
+        }
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef DESCRIPTOR_INDEX_H
+#define DESCRIPTOR_INDEX_H
+
+#include <opencv2/core.hpp>
+#include <opencv2/flann.hpp>
+#include <vector>
+
+// Randomized KD-forest over the float descriptors (SIFT) of one image.
+// Building it is the expensive part, so an image matched against several
+// neighbours should keep its index and query it repeatedly. `checks`
+// bounds the leaves visited per query and trades recall for latency.
+class DescriptorIndex {
+public:
+    DescriptorIndex(const cv::Mat& descriptors, int trees, int checks);
+
+    void knnMatch(const cv::Mat& query_descriptors,
+                  std::vector<std::vector<cv::DMatch>>& knn_matches, int k);
+
+    void setChecks(int checks) { checks_ = checks; }
+    int getChecks() const { return checks_; }
+
+    int size() const { return descriptors_.rows; }
+    int queryCount() const { return query_count_; }
+    double buildTimeMs() const { return build_time_ms_; }
+
+private:
+    cv::Mat descriptors_;
+    cv::flann::Index index_;
+    int checks_;
+    int query_count_ = 0;
+    double build_time_ms_ = 0.0;
+};
+
+#endif
@@ -0,0 +1,103 @@
+#include "hamming_matcher.h"
+#include "../kernels/kernel_dispatch.h"
+#include <opencv2/core/hal/hal.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+#include <opencv2/core/utility.hpp>
+#include <algorithm>
+#include <iostream>
+#include <limits>
+
+namespace {
+    constexpr int QUERY_BLOCK = 64;
+    constexpr int TRAIN_BLOCK = 512;
+
+    // Byte lanes hold at most 8 set bits per 16-byte chunk, so 31 chunks
+    // can be accumulated before the horizontal sum.
+    constexpr int CHUNKS_PER_REDUCE = 31;
+}
+
+int HammingMatcher::distance(const uchar* a, const uchar* b, int length) {
+    int result = 0;
+    int i = 0;
+
+#if CV_SIMD128
+    while (i + 16 <= length) {
+        cv::v_uint8x16 counts = cv::v_setzero_u8();
+        for (int chunk = 0; chunk < CHUNKS_PER_REDUCE && i + 16 <= length; chunk++, i += 16) {
+            counts += cv::v_popcount(cv::v_load(a + i) ^ cv::v_load(b + i));
+        }
+        result += static_cast<int>(cv::v_reduce_sum(counts));
+    }
+#endif
+
+    if (i < length) {
+        result += cv::hal::normHamming(a + i, b + i, length - i);
+    }
+    return result;
+}
+
+int HammingMatcher::matchWithRatioTest(
+    const cv::Mat& query_descriptors,
+    const cv::Mat& train_descriptors,
+    double ratio_threshold,
+    std::vector<cv::DMatch>& matches,
+    std::vector<double>* ratios) {
+
+    matches.clear();
+    if (ratios) {
+        ratios->clear();
+    }
+
+    if (query_descriptors.depth() != CV_8U || train_descriptors.depth() != CV_8U) {
+        std::cerr << "Error: Hamming matcher requires binary descriptors\n";
+        return 0;
+    }
+
+    const int num_queries = query_descriptors.rows;
+    const int num_train = train_descriptors.rows;
+    const int length = query_descriptors.cols * query_descriptors.channels();
+
+    if (num_queries == 0 || num_train < 2) {
+        return 0;
+    }
+
+    const int no_match = std::numeric_limits<int>::max();
+    std::vector<int> best_idx(num_queries, -1);
+    std::vector<int> best(num_queries, no_match);
+    std::vector<int> second(num_queries, no_match);
+
+    const int num_blocks = (num_queries + QUERY_BLOCK - 1) / QUERY_BLOCK;
+    const KernelTable& kernels = KernelDispatch::active();
+
+    cv::parallel_for_(cv::Range(0, num_blocks), [&](const cv::Range& range) {
+        for (int block = range.start; block < range.end; block++) {
+            const int q_begin = block * QUERY_BLOCK;
+            const int q_end = std::min(q_begin + QUERY_BLOCK, num_queries);
+
+            for (int t_begin = 0; t_begin < num_train; t_begin += TRAIN_BLOCK) {
+                const int t_end = std::min(t_begin + TRAIN_BLOCK, num_train);
+                kernels.hamming_scan(query_descriptors.ptr<uchar>(q_begin), query_descriptors.step,
+                                     q_end - q_begin, train_descriptors.data, train_descriptors.step,
+                                     t_begin, t_end, length,
+                                     &best[q_begin], &second[q_begin], &best_idx[q_begin]);
+            }
+        }
+    });
+
+    int num_candidates = 0;
+    for (int q = 0; q < num_queries; q++) {
+        if (second[q] == no_match) {
+            continue;
+        }
+        num_candidates++;
+
+        if (best[q] < ratio_threshold * second[q]) {
+            matches.emplace_back(q, best_idx[q], static_cast<float>(best[q]));
+            if (ratios) {
+                ratios->push_back(second[q] > 0 ? static_cast<double>(best[q]) / second[q] : 0.0);
+            }
+        }
+    }
+
+    return num_candidates;
+}
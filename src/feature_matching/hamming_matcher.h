@@ -0,0 +1,25 @@
+#ifndef HAMMING_MATCHER_H
+#define HAMMING_MATCHER_H
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+// Brute-force matcher for binary descriptors (ORB, AKAZE). Query blocks are
+// matched in parallel against cache-sized train blocks, the two nearest
+// neighbours are tracked while scanning and only matches passing the ratio
+// test are emitted.
+class HammingMatcher {
+public:
+    // Returns the number of queries that had two candidates.
+    static int matchWithRatioTest(
+        const cv::Mat& query_descriptors,
+        const cv::Mat& train_descriptors,
+        double ratio_threshold,
+        std::vector<cv::DMatch>& matches,
+        std::vector<double>* ratios = nullptr
+    );
+
+    static int distance(const uchar* a, const uchar* b, int length);
+};
+
+#endif
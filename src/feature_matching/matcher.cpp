@@ -1,8 +1,13 @@
 #include "matcher.h"
 #include "ransac.h"
+#include "hamming_matcher.h"
 #include <opencv2/imgproc.hpp>
+#include <opencv2/core/utility.hpp>
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <iostream>
+#include <limits>
 
 FeatureMatcher::FeatureMatcher() {
     setMatcherType("BruteForce-Hamming");
@@ -10,7 +15,7 @@ FeatureMatcher::FeatureMatcher() {
 
 void FeatureMatcher::setMatcherType(const std::string& type) {
     matcher_type_ = type;
-    if (type == "BruteForce-Hamming") {
+    if (type == "BruteForce-Hamming" || type == "HammingSIMD") {
         matcher_ = cv::BFMatcher::create(cv::NORM_HAMMING, cross_check_);
     } else if (type == "BruteForce-L2") {
         matcher_ = cv::BFMatcher::create(cv::NORM_L2, cross_check_);
@@ -29,19 +34,25 @@ MatchingResult FeatureMatcher::matchFeatures(
     MatchingResult result;
     result.ratio_test_threshold = ratio_threshold;
 
-    if (descriptors1.empty() || descriptors2.empty()) {
-        std::cerr << "Error: Empty descriptors provided to matcher\n";
-        return result;
-    }
-    
-    if (descriptors1.cols != descriptors2.cols) {
-        std::cerr << "Error: Descriptor dimensions don't match\n";
+    if (!validateInputs(descriptors1, descriptors2, keypoints1, keypoints2)) {
         return result;
     }
-    
-    if (keypoints1.size() != static_cast<size_t>(descriptors1.rows) ||
-        keypoints2.size() != static_cast<size_t>(descriptors2.rows)) {
-        std::cerr << "Error: Keypoint and descriptor counts don't match\n";
+
+    if (matcher_type_ == "HammingSIMD" && descriptors1.depth() == CV_8U) {
+        auto start = std::chrono::high_resolution_clock::now();
+        result.num_initial_matches = HammingMatcher::matchWithRatioTest(
+            descriptors1, descriptors2, ratio_threshold,
+            result.good_matches, &result.match_ratios
+        );
+        auto end = std::chrono::high_resolution_clock::now();
+        result.matching_time_ms = std::chrono::duration<double, std::milli>(end - start).count();
+        result.filtering_time_ms = 0.0;
+
+        result.num_good_matches = result.good_matches.size();
+        result.match_distances.assign(result.good_matches.size(), 0.0);
+        for (size_t i = 0; i < result.good_matches.size(); i++) {
+            result.match_distances[i] = result.good_matches[i].distance;
+        }
         return result;
     }
     
@@ -55,7 +66,7 @@ MatchingResult FeatureMatcher::matchFeatures(
     result.num_initial_matches = knn_matches.size();
     
     start = std::chrono::high_resolution_clock::now();
-    result.good_matches = ratioTest(knn_matches, ratio_threshold);
+    result.good_matches = ratioTest(knn_matches, ratio_threshold, &result.match_ratios);
     end = std::chrono::high_resolution_clock::now();
     result.filtering_time_ms = std::chrono::duration<double, std::milli>(end - start).count();
 
@@ -69,16 +80,281 @@ MatchingResult FeatureMatcher::matchFeatures(
     return result;
 }
 
+MatchingResult FeatureMatcher::matchFeatures(
+    const cv::Mat& descriptors1,
+    DescriptorIndex& index2,
+    const std::vector<cv::KeyPoint>& keypoints1,
+    const std::vector<cv::KeyPoint>& keypoints2,
+    double ratio_threshold) {
+
+    MatchingResult result;
+    result.ratio_test_threshold = ratio_threshold;
+
+    if (descriptors1.empty() || index2.size() == 0) {
+        std::cerr << "Error: Empty descriptors provided to matcher\n";
+        return result;
+    }
+
+    if (keypoints1.size() != static_cast<size_t>(descriptors1.rows) ||
+        keypoints2.size() != static_cast<size_t>(index2.size())) {
+        std::cerr << "Error: Keypoint and descriptor counts don't match\n";
+        return result;
+    }
+
+    if (index2.queryCount() == 0) {
+        result.index_build_time_ms = index2.buildTimeMs();
+    }
+
+    std::vector<std::vector<cv::DMatch>> knn_matches;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    index2.knnMatch(descriptors1, knn_matches, 2);
+    auto end = std::chrono::high_resolution_clock::now();
+    result.index_query_time_ms = std::chrono::duration<double, std::milli>(end - start).count();
+    result.matching_time_ms = result.index_query_time_ms;
+
+    result.num_initial_matches = knn_matches.size();
+
+    start = std::chrono::high_resolution_clock::now();
+    result.good_matches = ratioTest(knn_matches, ratio_threshold, &result.match_ratios);
+    end = std::chrono::high_resolution_clock::now();
+    result.filtering_time_ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+    result.num_good_matches = result.good_matches.size();
+
+    result.match_distances.clear();
+    for (const auto& match : result.good_matches) {
+        result.match_distances.push_back(match.distance);
+    }
+
+    return result;
+}
+
+MatchingResult FeatureMatcher::matchFeaturesGuided(
+    const cv::Mat& descriptors1,
+    const cv::Mat& descriptors2,
+    const std::vector<cv::KeyPoint>& keypoints1,
+    const std::vector<cv::KeyPoint>& keypoints2,
+    const MatchingPrior& prior,
+    double ratio_threshold) {
+
+    MatchingResult result;
+    result.ratio_test_threshold = ratio_threshold;
+
+    if (!validateInputs(descriptors1, descriptors2, keypoints1, keypoints2)) {
+        return result;
+    }
+
+    std::vector<std::vector<cv::DMatch>> knn_matches;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    if (!prior.homography.empty()) {
+        knn_matches = gridKnnMatch(descriptors1, descriptors2, keypoints1, keypoints2,
+                                   prior.homography, prior.search_radius);
+    } else {
+        knn_matches = regionKnnMatch(descriptors1, descriptors2, keypoints1, keypoints2,
+                                     prior.query_region, prior.train_region);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    result.matching_time_ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+    result.num_initial_matches = knn_matches.size();
+
+    start = std::chrono::high_resolution_clock::now();
+    result.good_matches = ratioTest(knn_matches, ratio_threshold, &result.match_ratios);
+    end = std::chrono::high_resolution_clock::now();
+    result.filtering_time_ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+    result.num_good_matches = result.good_matches.size();
+
+    if (result.num_good_matches < prior.min_matches) {
+        std::cout << "Guided matching kept only " << result.num_good_matches
+                  << " matches, falling back to global matching\n";
+        return matchFeatures(descriptors1, descriptors2, keypoints1, keypoints2, ratio_threshold);
+    }
+
+    result.match_distances.clear();
+    for (const auto& match : result.good_matches) {
+        result.match_distances.push_back(match.distance);
+    }
+
+    return result;
+}
+
+bool FeatureMatcher::validateInputs(const cv::Mat& descriptors1, const cv::Mat& descriptors2,
+                                    const std::vector<cv::KeyPoint>& keypoints1,
+                                    const std::vector<cv::KeyPoint>& keypoints2) {
+    if (descriptors1.empty() || descriptors2.empty()) {
+        std::cerr << "Error: Empty descriptors provided to matcher\n";
+        return false;
+    }
+
+    if (descriptors1.cols != descriptors2.cols) {
+        std::cerr << "Error: Descriptor dimensions don't match\n";
+        return false;
+    }
+
+    if (keypoints1.size() != static_cast<size_t>(descriptors1.rows) ||
+        keypoints2.size() != static_cast<size_t>(descriptors2.rows)) {
+        std::cerr << "Error: Keypoint and descriptor counts don't match\n";
+        return false;
+    }
+
+    return true;
+}
+
+std::vector<std::vector<cv::DMatch>> FeatureMatcher::gridKnnMatch(
+    const cv::Mat& descriptors1,
+    const cv::Mat& descriptors2,
+    const std::vector<cv::KeyPoint>& keypoints1,
+    const std::vector<cv::KeyPoint>& keypoints2,
+    const cv::Mat& homography,
+    double search_radius) {
+
+    std::vector<std::vector<cv::DMatch>> knn_matches(keypoints1.size());
+
+    // Bucket the train keypoints into cells of the search radius so that a
+    // query only visits the 3x3 neighbourhood around its prediction.
+    const float cell = static_cast<float>(std::max(search_radius, 1.0));
+    const float radius_sq = cell * cell;
+
+    float min_x = keypoints2[0].pt.x, max_x = min_x;
+    float min_y = keypoints2[0].pt.y, max_y = min_y;
+    for (const auto& kp : keypoints2) {
+        min_x = std::min(min_x, kp.pt.x);
+        max_x = std::max(max_x, kp.pt.x);
+        min_y = std::min(min_y, kp.pt.y);
+        max_y = std::max(max_y, kp.pt.y);
+    }
+
+    const int grid_w = static_cast<int>((max_x - min_x) / cell) + 1;
+    const int grid_h = static_cast<int>((max_y - min_y) / cell) + 1;
+    std::vector<std::vector<int>> buckets(static_cast<size_t>(grid_w) * grid_h);
+    for (size_t i = 0; i < keypoints2.size(); i++) {
+        int cx = static_cast<int>((keypoints2[i].pt.x - min_x) / cell);
+        int cy = static_cast<int>((keypoints2[i].pt.y - min_y) / cell);
+        buckets[cy * grid_w + cx].push_back(static_cast<int>(i));
+    }
+
+    std::vector<cv::Point2f> query_points, predicted;
+    query_points.reserve(keypoints1.size());
+    for (const auto& kp : keypoints1) {
+        query_points.push_back(kp.pt);
+    }
+    cv::Mat prior;
+    homography.convertTo(prior, CV_64F);
+    cv::perspectiveTransform(query_points, predicted, prior);
+
+    const int norm_type = descriptors1.depth() == CV_8U ? cv::NORM_HAMMING : cv::NORM_L2;
+
+    cv::parallel_for_(cv::Range(0, static_cast<int>(keypoints1.size())), [&](const cv::Range& range) {
+        for (int q = range.start; q < range.end; q++) {
+            const cv::Point2f& p = predicted[q];
+            if (!std::isfinite(p.x) || !std::isfinite(p.y)) continue;
+
+            int cx0 = std::max(0, static_cast<int>(std::floor((p.x - cell - min_x) / cell)));
+            int cx1 = std::min(grid_w - 1, static_cast<int>(std::floor((p.x + cell - min_x) / cell)));
+            int cy0 = std::max(0, static_cast<int>(std::floor((p.y - cell - min_y) / cell)));
+            int cy1 = std::min(grid_h - 1, static_cast<int>(std::floor((p.y + cell - min_y) / cell)));
+
+            cv::DMatch best(q, -1, std::numeric_limits<float>::max());
+            cv::DMatch second = best;
+            const cv::Mat query = descriptors1.row(q);
+
+            for (int cy = cy0; cy <= cy1; cy++) {
+                for (int cx = cx0; cx <= cx1; cx++) {
+                    for (int t : buckets[cy * grid_w + cx]) {
+                        cv::Point2f offset = keypoints2[t].pt - p;
+                        if (offset.dot(offset) > radius_sq) continue;
+
+                        float distance = static_cast<float>(cv::norm(query, descriptors2.row(t), norm_type));
+                        if (distance < best.distance) {
+                            second = best;
+                            best = cv::DMatch(q, t, distance);
+                        } else if (distance < second.distance) {
+                            second = cv::DMatch(q, t, distance);
+                        }
+                    }
+                }
+            }
+
+            if (second.trainIdx >= 0) {
+                knn_matches[q] = {best, second};
+            }
+        }
+    });
+
+    return knn_matches;
+}
+
+std::vector<std::vector<cv::DMatch>> FeatureMatcher::regionKnnMatch(
+    const cv::Mat& descriptors1,
+    const cv::Mat& descriptors2,
+    const std::vector<cv::KeyPoint>& keypoints1,
+    const std::vector<cv::KeyPoint>& keypoints2,
+    const cv::Rect& query_region,
+    const cv::Rect& train_region) {
+
+    auto select = [](const std::vector<cv::KeyPoint>& keypoints, const cv::Rect& region) {
+        std::vector<int> indices;
+        indices.reserve(keypoints.size());
+        cv::Rect2f bounds(region);
+        for (size_t i = 0; i < keypoints.size(); i++) {
+            if (region.empty() || bounds.contains(keypoints[i].pt)) {
+                indices.push_back(static_cast<int>(i));
+            }
+        }
+        return indices;
+    };
+
+    std::vector<int> query_indices = select(keypoints1, query_region);
+    std::vector<int> train_indices = select(keypoints2, train_region);
+
+    std::vector<std::vector<cv::DMatch>> knn_matches;
+    if (query_indices.empty() || train_indices.size() < 2) {
+        return knn_matches;
+    }
+
+    cv::Mat query_descriptors(static_cast<int>(query_indices.size()), descriptors1.cols, descriptors1.type());
+    for (size_t i = 0; i < query_indices.size(); i++) {
+        descriptors1.row(query_indices[i]).copyTo(query_descriptors.row(static_cast<int>(i)));
+    }
+    cv::Mat train_descriptors(static_cast<int>(train_indices.size()), descriptors2.cols, descriptors2.type());
+    for (size_t i = 0; i < train_indices.size(); i++) {
+        descriptors2.row(train_indices[i]).copyTo(train_descriptors.row(static_cast<int>(i)));
+    }
+
+    matcher_->knnMatch(query_descriptors, train_descriptors, knn_matches, 2);
+
+    for (auto& match_pair : knn_matches) {
+        for (auto& match : match_pair) {
+            match.queryIdx = query_indices[match.queryIdx];
+            match.trainIdx = train_indices[match.trainIdx];
+        }
+    }
+
+    return knn_matches;
+}
+
 std::vector<cv::DMatch> FeatureMatcher::ratioTest(
     const std::vector<std::vector<cv::DMatch>>& knn_matches,
-    double ratio_threshold) {
+    double ratio_threshold,
+    std::vector<double>* ratios) {
     
     std::vector<cv::DMatch> good_matches;
+    if (ratios) {
+        ratios->clear();
+    }
     
     for (const auto& match_pair : knn_matches) {
         if (match_pair.size() == 2) {
             if (match_pair[0].distance < ratio_threshold * match_pair[1].distance) {
                 good_matches.push_back(match_pair[0]);
+                if (ratios) {
+                    ratios->push_back(match_pair[1].distance > 0
+                                      ? match_pair[0].distance / match_pair[1].distance
+                                      : 0.0);
+                }
             }
         }
     }
@@ -5,15 +5,33 @@
 #include <opencv2/features2d.hpp>
 #include <vector>
 #include <chrono>
+#include "descriptor_index.h"
 
 struct MatchingResult {
     std::vector<cv::DMatch> good_matches;
     std::vector<double> match_distances;
+    std::vector<double> match_ratios;
     double matching_time_ms;
     double filtering_time_ms;
     double ratio_test_threshold;
     int num_initial_matches;
     int num_good_matches;
+    // Only set when matching against a DescriptorIndex; the build time is
+    // reported by the first match that queries the index.
+    double index_build_time_ms = 0.0;
+    double index_query_time_ms = 0.0;
+};
+
+// Spatial prior for guided matching. With a homography (query -> train)
+// each query keypoint is only compared with train keypoints within
+// search_radius of its predicted position; otherwise the regions, when
+// set, restrict the keypoints taking part on either side.
+struct MatchingPrior {
+    cv::Mat homography;
+    cv::Rect query_region;
+    cv::Rect train_region;
+    double search_radius = 50.0;
+    int min_matches = 50;
 };
 
 class FeatureMatcher {
@@ -28,6 +46,24 @@ public:
         double ratio_threshold = 0.7
     );
     
+    MatchingResult matchFeatures(
+        const cv::Mat& descriptors1,
+        DescriptorIndex& index2,
+        const std::vector<cv::KeyPoint>& keypoints1,
+        const std::vector<cv::KeyPoint>& keypoints2,
+        double ratio_threshold = 0.7
+    );
+
+    // Falls back to matchFeatures when fewer than prior.min_matches survive.
+    MatchingResult matchFeaturesGuided(
+        const cv::Mat& descriptors1,
+        const cv::Mat& descriptors2,
+        const std::vector<cv::KeyPoint>& keypoints1,
+        const std::vector<cv::KeyPoint>& keypoints2,
+        const MatchingPrior& prior,
+        double ratio_threshold = 0.7
+    );
+
     void setMatcherType(const std::string& type);
     
     cv::Mat visualizeMatches(
@@ -43,9 +79,32 @@ private:
     bool cross_check_ = false;
     std::string matcher_type_ = "BruteForce-Hamming";
     
+    bool validateInputs(const cv::Mat& descriptors1, const cv::Mat& descriptors2,
+                        const std::vector<cv::KeyPoint>& keypoints1,
+                        const std::vector<cv::KeyPoint>& keypoints2);
+
+    std::vector<std::vector<cv::DMatch>> gridKnnMatch(
+        const cv::Mat& descriptors1,
+        const cv::Mat& descriptors2,
+        const std::vector<cv::KeyPoint>& keypoints1,
+        const std::vector<cv::KeyPoint>& keypoints2,
+        const cv::Mat& homography,
+        double search_radius
+    );
+
+    std::vector<std::vector<cv::DMatch>> regionKnnMatch(
+        const cv::Mat& descriptors1,
+        const cv::Mat& descriptors2,
+        const std::vector<cv::KeyPoint>& keypoints1,
+        const std::vector<cv::KeyPoint>& keypoints2,
+        const cv::Rect& query_region,
+        const cv::Rect& train_region
+    );
+
     std::vector<cv::DMatch> ratioTest(
         const std::vector<std::vector<cv::DMatch>>& knn_matches,
-        double ratio_threshold
+        double ratio_threshold,
+        std::vector<double>* ratios = nullptr
     );
 };
 
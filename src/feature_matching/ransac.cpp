@@ -1,9 +1,25 @@
 #include "ransac.h"
 #include "../config.h"
+#include "../kernels/kernel_dispatch.h"
+#include <opencv2/imgproc.hpp>
+#include <opencv2/core/utility.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <numeric>
 #include <random>
 #include <chrono>
 #include <iostream>
 
+static void squaredErrors(const cv::Matx33d& h,
+                          const float* sx, const float* sy,
+                          const float* tx, const float* ty,
+                          int begin, int end, float* err) {
+    KernelDispatch::active().squared_errors(h.val, sx + begin, sy + begin, tx + begin, ty + begin,
+                                            end - begin, err);
+}
+
 RANSAC::RANSAC() {
     reprojection_threshold_ = PanoramaConfig::DEFAULT_RANSAC_THRESHOLD;
     confidence_ = PanoramaConfig::DEFAULT_RANSAC_CONFIDENCE;
@@ -32,42 +48,48 @@ RANSACResult RANSAC::findHomography(
     int n_points = points1.size();
     int best_inliers = 0;
     cv::Mat best_H;
-    std::vector<bool> best_mask(n_points, false);
+
+    loadPoints(points1, points2);
+    mask_.assign(n_points, 0);
+    best_mask_.assign(n_points, 0);
 
     std::random_device rd;
     std::mt19937 gen(rd());
     std::uniform_int_distribution<> dis(0, n_points - 1);
 
+    std::array<int, 4> sample;
+    std::array<cv::Point2f, 4> pts1_sample, pts2_sample;
+
     int iterations = 0;
     double p = confidence_;
     double w = 0.0;
 
     while (iterations < max_iterations_) {
-        std::vector<int> sample;
-        while (sample.size() < 4) {
+        int filled = 0;
+        while (filled < 4) {
             int idx = dis(gen);
-            if (std::find(sample.begin(), sample.end(), idx) == sample.end()) {
-                sample.push_back(idx);
+            if (std::find(sample.begin(), sample.begin() + filled, idx) == sample.begin() + filled) {
+                sample[filled++] = idx;
             }
         }
 
-        std::vector<cv::Point2f> pts1_sample, pts2_sample;
-        for (int idx : sample) {
-            pts1_sample.push_back(points1[idx]);
-            pts2_sample.push_back(points2[idx]);
+        for (int k = 0; k < 4; k++) {
+            pts1_sample[k] = points1[sample[k]];
+            pts2_sample[k] = points2[sample[k]];
         }
 
-        cv::Mat H = computeHomographyMinimal(pts1_sample, pts2_sample);
+        iterations++;
+
+        cv::Mat H = computeHomographyMinimal(pts1_sample.data(), pts2_sample.data());
 
         if (H.empty()) continue;
 
-        std::vector<bool> inlier_mask = findInliers(H, points1, points2, reprojection_threshold);
-        int n_inliers = std::count(inlier_mask.begin(), inlier_mask.end(), true);
+        int n_inliers = scoreHomography(H, reprojection_threshold, mask_.data());
 
         if (n_inliers > best_inliers) {
             best_inliers = n_inliers;
-            best_H = H.clone();
-            best_mask = inlier_mask;
+            best_H = H;
+            std::swap(mask_, best_mask_);
 
             w = static_cast<double>(best_inliers) / n_points;
             if (w > 0.0 && w < 1.0) {
@@ -75,14 +97,14 @@ RANSACResult RANSAC::findHomography(
                 max_iterations_ = std::min(static_cast<int>(new_iterations) + 1, max_iterations_);
             }
         }
-
-        iterations++;
     }
 
     if (best_inliers >= 4) {
         std::vector<cv::Point2f> inlier_pts1, inlier_pts2;
-        for (size_t i = 0; i < points1.size(); i++) {
-            if (best_mask[i]) {
+        inlier_pts1.reserve(best_inliers);
+        inlier_pts2.reserve(best_inliers);
+        for (int i = 0; i < n_points; i++) {
+            if (best_mask_[i]) {
                 inlier_pts1.push_back(points1[i]);
                 inlier_pts2.push_back(points2[i]);
             }
@@ -91,31 +113,248 @@ RANSACResult RANSAC::findHomography(
         cv::Mat refined_H = cv::findHomography(inlier_pts1, inlier_pts2, 0);
         if (!refined_H.empty()) {
             best_H = refined_H;
-            best_mask = findInliers(best_H, points1, points2, reprojection_threshold);
-            best_inliers = std::count(best_mask.begin(), best_mask.end(), true);
+            best_inliers = scoreHomography(best_H, reprojection_threshold, best_mask_.data());
         }
     }
 
     auto end = std::chrono::high_resolution_clock::now();
 
     result.homography = best_H;
-    result.inlier_mask = best_mask;
+    result.inlier_mask.assign(best_mask_.begin(), best_mask_.end());
     result.num_inliers = best_inliers;
     result.inlier_ratio = static_cast<double>(best_inliers) / n_points;
     result.num_iterations = iterations;
-    result.reprojection_error = computeReprojectionError(best_H, points1, points2, best_mask);
+    result.reprojection_error = computeReprojectionError(best_H, points1, points2, result.inlier_mask);
     result.computation_time_ms = std::chrono::duration<double, std::milli>(end - start).count();
 
     return result;
 }
 
-cv::Mat RANSAC::computeHomographyMinimal(const std::vector<cv::Point2f>& pts1,
-                                         const std::vector<cv::Point2f>& pts2) {
-    if (pts1.size() != 4 || pts2.size() != 4) {
-        return cv::Mat();
+// Sequential probability ratio test threshold (Matas & Chum, "Randomized
+// RANSAC with Sequential Probability Ratio Test"), returned as log(A).
+static double sprtDecisionThreshold(double epsilon, double delta) {
+    double c = (1.0 - delta) * std::log((1.0 - delta) / (1.0 - epsilon)) +
+               delta * std::log(delta / epsilon);
+    double a0 = PanoramaConfig::SPRT_MODEL_COST * c + 1.0;
+    double a = a0;
+    for (int i = 0; i < 10; i++) {
+        a = a0 + std::log(a);
+    }
+    return std::log(a);
+}
+
+RANSACResult RANSAC::findHomographyPROSAC(
+    const std::vector<cv::Point2f>& points1,
+    const std::vector<cv::Point2f>& points2,
+    const std::vector<double>& quality,
+    double reprojection_threshold,
+    double confidence,
+    int max_iterations) {
+
+    if (quality.size() != points1.size()) {
+        return findHomography(points1, points2, reprojection_threshold, confidence, max_iterations);
+    }
+
+    RANSACResult result;
+
+    if (points1.size() < 4 || points1.size() != points2.size()) {
+        return result;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    reprojection_threshold_ = reprojection_threshold;
+    confidence_ = confidence;
+    max_iterations_ = max_iterations;
+
+    const int n_points = points1.size();
+    const int m = 4;
+
+    std::random_device rd;
+    std::mt19937 gen(rd());
+
+    // Samples are drawn by quality rank, while verification walks the points
+    // in a random order as SPRT assumes.
+    std::vector<int> ranked(n_points);
+    std::iota(ranked.begin(), ranked.end(), 0);
+    std::stable_sort(ranked.begin(), ranked.end(),
+                     [&quality](int a, int b) { return quality[a] < quality[b]; });
+
+    std::vector<int> eval_order(n_points);
+    std::iota(eval_order.begin(), eval_order.end(), 0);
+    std::shuffle(eval_order.begin(), eval_order.end(), gen);
+
+    std::vector<cv::Point2f> shuffled1(n_points), shuffled2(n_points);
+    for (int i = 0; i < n_points; i++) {
+        shuffled1[i] = points1[eval_order[i]];
+        shuffled2[i] = points2[eval_order[i]];
+    }
+    loadPoints(shuffled1, shuffled2);
+    mask_.assign(n_points, 0);
+    best_mask_.assign(n_points, 0);
+
+    // PROSAC growth function: T_n is the expected number of samples drawn
+    // from the top n correspondences out of max_iterations uniform ones.
+    int n = m;
+    double t_n = max_iterations;
+    for (int i = 0; i < m; i++) {
+        t_n *= static_cast<double>(m - i) / (n_points - i);
+    }
+    int t_n_prime = 1;
+    int samples_drawn = 0;
+
+    double epsilon = PanoramaConfig::SPRT_INITIAL_INLIER_RATIO;
+    double delta = PanoramaConfig::SPRT_INITIAL_DELTA;
+    double rejected_consistent = 0.0;
+    double rejected_tested = 0.0;
+
+    const float threshold_sq = static_cast<float>(reprojection_threshold * reprojection_threshold);
+    const int batch_size = PanoramaConfig::RANSAC_HYPOTHESIS_BATCH;
+
+    std::vector<std::array<int, 4>> samples(batch_size);
+    std::vector<cv::Matx33d> models(batch_size);
+    std::vector<int> scores(batch_size);
+    std::vector<int> tested(batch_size);
+    std::vector<char> valid(batch_size);
+    std::vector<char> rejected(batch_size);
+
+    int best_inliers = 0;
+    cv::Mat best_H;
+    int iterations = 0;
+
+    while (iterations < max_iterations_) {
+        const int count = std::min(batch_size, max_iterations_ - iterations);
+
+        for (int b = 0; b < count; b++) {
+            samples_drawn++;
+            if (samples_drawn > t_n_prime && n < n_points) {
+                double t_next = t_n * (n + 1) / (n + 1 - m);
+                t_n_prime += static_cast<int>(std::ceil(t_next - t_n));
+                t_n = t_next;
+                n++;
+            }
+
+            std::array<int, 4>& sample = samples[b];
+            int pool = n;
+            int filled = 0;
+            if (t_n_prime >= samples_drawn) {
+                sample[filled++] = n - 1;
+                pool = n - 1;
+            }
+            std::uniform_int_distribution<> dis(0, pool - 1);
+            while (filled < m) {
+                int idx = dis(gen);
+                if (std::find(sample.begin(), sample.begin() + filled, idx) == sample.begin() + filled) {
+                    sample[filled++] = idx;
+                }
+            }
+        }
+
+        double log_consistent = 0.0;
+        double log_inconsistent = 0.0;
+        double log_decision = std::numeric_limits<double>::infinity();
+        if (delta < epsilon) {
+            log_consistent = std::log(delta / epsilon);
+            log_inconsistent = std::log((1.0 - delta) / (1.0 - epsilon));
+            log_decision = sprtDecisionThreshold(epsilon, delta);
+        }
+
+        cv::parallel_for_(cv::Range(0, count), [&](const cv::Range& range) {
+            std::array<cv::Point2f, 4> pts1_sample, pts2_sample;
+            for (int b = range.start; b < range.end; b++) {
+                for (int k = 0; k < m; k++) {
+                    pts1_sample[k] = points1[ranked[samples[b][k]]];
+                    pts2_sample[k] = points2[ranked[samples[b][k]]];
+                }
+
+                cv::Mat H = computeHomographyMinimal(pts1_sample.data(), pts2_sample.data());
+                valid[b] = !H.empty();
+                if (!valid[b]) continue;
+
+                models[b] = H;
+                bool is_rejected = false;
+                scores[b] = scoreHypothesisSPRT(models[b], threshold_sq, log_consistent,
+                                                log_inconsistent, log_decision,
+                                                &tested[b], &is_rejected);
+                rejected[b] = is_rejected;
+            }
+        });
+
+        iterations += count;
+
+        int batch_best = -1;
+        for (int b = 0; b < count; b++) {
+            if (!valid[b]) continue;
+
+            if (rejected[b]) {
+                rejected_consistent += scores[b];
+                rejected_tested += tested[b];
+            } else if (scores[b] > best_inliers &&
+                       (batch_best < 0 || scores[b] > scores[batch_best])) {
+                batch_best = b;
+            }
+        }
+
+        if (rejected_tested > 0) {
+            delta = std::max(rejected_consistent / rejected_tested, 1e-4);
+        }
+
+        if (batch_best < 0) continue;
+
+        best_H = cv::Mat(models[batch_best]);
+        best_inliers = scoreHomography(best_H, reprojection_threshold, best_mask_.data());
+
+        // Local optimization: refit on the inliers of the new best model and
+        // keep the result when it explains more correspondences.
+        if (best_inliers >= 4) {
+            std::vector<cv::Point2f> inlier_pts1, inlier_pts2;
+            inlier_pts1.reserve(best_inliers);
+            inlier_pts2.reserve(best_inliers);
+            for (int i = 0; i < n_points; i++) {
+                if (best_mask_[i]) {
+                    inlier_pts1.push_back(shuffled1[i]);
+                    inlier_pts2.push_back(shuffled2[i]);
+                }
+            }
+
+            cv::Mat refined_H = cv::findHomography(inlier_pts1, inlier_pts2, 0);
+            if (!refined_H.empty()) {
+                int refined_inliers = scoreHomography(refined_H, reprojection_threshold, mask_.data());
+                if (refined_inliers >= best_inliers) {
+                    best_H = refined_H;
+                    best_inliers = refined_inliers;
+                    std::swap(mask_, best_mask_);
+                }
+            }
+        }
+
+        double w = static_cast<double>(best_inliers) / n_points;
+        epsilon = w;
+        if (w > 0.0 && w < 1.0) {
+            double new_iterations = std::log(1 - confidence_) / std::log(1 - std::pow(w, m));
+            max_iterations_ = std::min(static_cast<int>(new_iterations) + 1, max_iterations_);
+        }
     }
 
-    cv::Mat H = cv::findHomography(pts1, pts2, 0);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    result.homography = best_H;
+    result.inlier_mask.assign(n_points, false);
+    for (int i = 0; i < n_points; i++) {
+        result.inlier_mask[eval_order[i]] = best_mask_[i] != 0;
+    }
+    result.num_inliers = best_inliers;
+    result.inlier_ratio = static_cast<double>(best_inliers) / n_points;
+    result.num_iterations = iterations;
+    result.reprojection_error = computeReprojectionError(best_H, points1, points2, result.inlier_mask);
+    result.computation_time_ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+    return result;
+}
+
+cv::Mat RANSAC::computeHomographyMinimal(const cv::Point2f* pts1,
+                                         const cv::Point2f* pts2) {
+    cv::Mat H = cv::getPerspectiveTransform(pts1, pts2);
 
     if (H.empty()) {
         return cv::Mat();
@@ -127,47 +366,105 @@ cv::Mat RANSAC::computeHomographyMinimal(const std::vector<cv::Point2f>& pts1,
         return cv::Mat();
     }
 
-    for (int i = 0; i < H.rows; i++) {
-        for (int j = 0; j < H.cols; j++) {
-            double val = H.at<double>(i, j);
-            if (std::isnan(val) || std::isinf(val)) {
-                return cv::Mat();
-            }
+    const double* h = H.ptr<double>();
+    for (int i = 0; i < 9; i++) {
+        if (std::isnan(h[i]) || std::isinf(h[i])) {
+            return cv::Mat();
         }
     }
 
     return H;
 }
 
-std::vector<bool> RANSAC::findInliers(const cv::Mat& H,
-                                     const std::vector<cv::Point2f>& pts1,
-                                     const std::vector<cv::Point2f>& pts2,
-                                     double threshold) {
-    std::vector<bool> mask(pts1.size(), false);
+void RANSAC::loadPoints(const std::vector<cv::Point2f>& pts1,
+                        const std::vector<cv::Point2f>& pts2) {
+    size_t n = std::min(pts1.size(), pts2.size());
+
+    src_x_.resize(n);
+    src_y_.resize(n);
+    dst_x_.resize(n);
+    dst_y_.resize(n);
+    errors_.resize(n);
+
+    for (size_t i = 0; i < n; i++) {
+        src_x_[i] = pts1[i].x;
+        src_y_[i] = pts1[i].y;
+        dst_x_[i] = pts2[i].x;
+        dst_y_[i] = pts2[i].y;
+    }
+}
 
-    for (size_t i = 0; i < pts1.size(); i++) {
-        cv::Mat pt1 = (cv::Mat_<double>(3, 1) << pts1[i].x, pts1[i].y, 1.0);
-        cv::Mat pt2_est = H * pt1;
+void RANSAC::computeSquaredErrors(const cv::Mat& H) {
+    cv::Matx33d h;
+    H.convertTo(cv::Mat(3, 3, CV_64F, h.val), CV_64F);
 
-        double w = pt2_est.at<double>(2);
-        if (std::abs(w) < 1e-10) {
-            mask[i] = false;
-            continue;
-        }
+    squaredErrors(h, src_x_.data(), src_y_.data(), dst_x_.data(), dst_y_.data(),
+                  0, static_cast<int>(src_x_.size()), errors_.data());
+}
 
-        double x = pt2_est.at<double>(0) / w;
-        double y = pt2_est.at<double>(1) / w;
+int RANSAC::scoreHypothesisSPRT(const cv::Matx33d& H, float threshold_sq,
+                                double log_consistent, double log_inconsistent,
+                                double log_decision, int* tested, bool* rejected) const {
+    constexpr int chunk = 64;
+    float err[chunk];
 
-        double dx = x - pts2[i].x;
-        double dy = y - pts2[i].y;
-        double error = std::sqrt(dx*dx + dy*dy);
+    const int n = static_cast<int>(src_x_.size());
+    double log_lambda = 0.0;
+    int inliers = 0;
+
+    *rejected = false;
+
+    for (int begin = 0; begin < n; begin += chunk) {
+        int end = std::min(begin + chunk, n);
+        squaredErrors(H, src_x_.data(), src_y_.data(), dst_x_.data(), dst_y_.data(),
+                      begin, end, err);
+
+        int consistent = 0;
+        for (int i = 0; i < end - begin; i++) {
+            consistent += err[i] < threshold_sq ? 1 : 0;
+        }
+        inliers += consistent;
 
-        if (error < threshold) {
-            mask[i] = true;
+        log_lambda += consistent * log_consistent + (end - begin - consistent) * log_inconsistent;
+        if (log_lambda > log_decision) {
+            *tested = end;
+            *rejected = true;
+            return inliers;
         }
     }
 
-    return mask;
+    *tested = n;
+    return inliers;
+}
+
+int RANSAC::scoreHomography(const cv::Mat& H, double threshold, uchar* mask) {
+    computeSquaredErrors(H);
+
+    // Points whose projection hits w == 0 end up with an inf/NaN error and
+    // fail the comparison, which matches the explicit guard of the old path.
+    const float threshold_sq = static_cast<float>(threshold * threshold);
+    const int n = static_cast<int>(errors_.size());
+    const float* err = errors_.data();
+
+    int count = 0;
+    for (int i = 0; i < n; i++) {
+        uchar inlier = err[i] < threshold_sq ? 1 : 0;
+        mask[i] = inlier;
+        count += inlier;
+    }
+
+    return count;
+}
+
+std::vector<bool> RANSAC::findInliers(const cv::Mat& H,
+                                     const std::vector<cv::Point2f>& pts1,
+                                     const std::vector<cv::Point2f>& pts2,
+                                     double threshold) {
+    loadPoints(pts1, pts2);
+    mask_.resize(src_x_.size());
+    scoreHomography(H, threshold, mask_.data());
+
+    return std::vector<bool>(mask_.begin(), mask_.end());
 }
 
 double RANSAC::computeReprojectionError(
@@ -178,28 +475,16 @@ double RANSAC::computeReprojectionError(
 
     if (homography.empty()) return -1.0;
 
+    loadPoints(points1, points2);
+    computeSquaredErrors(homography);
+
     double total_error = 0.0;
     int count = 0;
 
-    for (size_t i = 0; i < points1.size(); i++) {
-        if (!inlier_mask[i]) continue;
-
-        cv::Mat pt1 = (cv::Mat_<double>(3, 1) << points1[i].x, points1[i].y, 1.0);
-        cv::Mat pt2_est = homography * pt1;
-
-        double w = pt2_est.at<double>(2);
-        if (std::abs(w) < 1e-10) {
-            continue;
-        }
+    for (size_t i = 0; i < errors_.size() && i < inlier_mask.size(); i++) {
+        if (!inlier_mask[i] || !std::isfinite(errors_[i])) continue;
 
-        double x = pt2_est.at<double>(0) / w;
-        double y = pt2_est.at<double>(1) / w;
-
-        double dx = x - points2[i].x;
-        double dy = y - points2[i].y;
-        double error = std::sqrt(dx*dx + dy*dy);
-
-        total_error += error;
+        total_error += std::sqrt(static_cast<double>(errors_[i]));
         count++;
     }
 
@@ -225,4 +510,4 @@ std::vector<cv::Point2f> RANSAC::extractPoints(
     }
 
     return points;
-}
\ No newline at end of file
+}
@@ -18,7 +18,7 @@ struct RANSACResult {
 class RANSAC {
 public:
     RANSAC();
-    
+
     RANSACResult findHomography(
         const std::vector<cv::Point2f>& points1,
         const std::vector<cv::Point2f>& points2,
@@ -26,34 +26,63 @@ public:
         double confidence = 0.995,
         int max_iterations = 2000
     );
-    
+
+    // PROSAC variant: samples are drawn from correspondences ordered by
+    // quality (lower is better, e.g. the ratio-test ratio), hypotheses are
+    // scored in parallel batches and bad ones are dropped early by SPRT.
+    RANSACResult findHomographyPROSAC(
+        const std::vector<cv::Point2f>& points1,
+        const std::vector<cv::Point2f>& points2,
+        const std::vector<double>& quality,
+        double reprojection_threshold = 3.0,
+        double confidence = 0.995,
+        int max_iterations = 2000
+    );
+
     void setReprojectionThreshold(double threshold) { reprojection_threshold_ = threshold; }
-    
+
     double computeReprojectionError(
         const cv::Mat& homography,
         const std::vector<cv::Point2f>& points1,
         const std::vector<cv::Point2f>& points2,
         const std::vector<bool>& inlier_mask
     );
-    
+
     static std::vector<cv::Point2f> extractPoints(
         const std::vector<cv::KeyPoint>& keypoints,
         const std::vector<cv::DMatch>& matches,
         bool query_points
     );
-    
+
 private:
     double reprojection_threshold_ = 3.0;
     double confidence_ = 0.995;
     int max_iterations_ = 2000;
-    
-    cv::Mat computeHomographyMinimal(const std::vector<cv::Point2f>& pts1, 
-                                     const std::vector<cv::Point2f>& pts2);
-    
+
+    // Structure-of-arrays copy of the correspondences and scratch buffers
+    // reused across hypotheses so that scoring does not allocate.
+    std::vector<float> src_x_, src_y_, dst_x_, dst_y_;
+    std::vector<float> errors_;
+    std::vector<uchar> mask_, best_mask_;
+
+    cv::Mat computeHomographyMinimal(const cv::Point2f* pts1,
+                                     const cv::Point2f* pts2);
+
+    void loadPoints(const std::vector<cv::Point2f>& pts1,
+                    const std::vector<cv::Point2f>& pts2);
+
+    void computeSquaredErrors(const cv::Mat& H);
+
+    int scoreHomography(const cv::Mat& H, double threshold, uchar* mask);
+
+    int scoreHypothesisSPRT(const cv::Matx33d& H, float threshold_sq,
+                            double log_consistent, double log_inconsistent,
+                            double log_decision, int* tested, bool* rejected) const;
+
     std::vector<bool> findInliers(const cv::Mat& H,
                                   const std::vector<cv::Point2f>& pts1,
                                   const std::vector<cv::Point2f>& pts2,
                                   double threshold);
 };
 
-#endif
\ No newline at end of file
+#endif
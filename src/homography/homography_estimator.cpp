@@ -1,10 +1,13 @@
 #include "homography_estimator.h"
 #include "../config.h"
 #include <opencv2/calib3d.hpp>
+#include <algorithm>
+#include <cctype>
 #include <cmath>
 #include <iostream>
 #include <limits>
 #include <chrono>
+#include <stdexcept>
 
 HomographyEstimator::HomographyEstimator() {
     ransac_threshold_ = PanoramaConfig::DEFAULT_RANSAC_THRESHOLD;
@@ -17,6 +20,16 @@ cv::Mat HomographyEstimator::estimateHomography(
     const std::vector<cv::DMatch>& matches,
     std::vector<cv::DMatch>& inlier_matches) {
 
+    return estimateHomography(keypoints1, keypoints2, matches, std::vector<double>(), inlier_matches);
+}
+
+cv::Mat HomographyEstimator::estimateHomography(
+    const std::vector<cv::KeyPoint>& keypoints1,
+    const std::vector<cv::KeyPoint>& keypoints2,
+    const std::vector<cv::DMatch>& matches,
+    const std::vector<double>& match_quality,
+    std::vector<cv::DMatch>& inlier_matches) {
+
     if (matches.size() < 4) {
         return cv::Mat();
     }
@@ -32,15 +45,22 @@ cv::Mat HomographyEstimator::estimateHomography(
 
     auto start_time = std::chrono::high_resolution_clock::now();
 
+    bool has_quality = match_quality.size() == matches.size();
+
     std::vector<cv::Point2f> points1, points2;
+    std::vector<double> quality;
     points1.reserve(matches.size());
     points2.reserve(matches.size());
 
-    for (const auto& match : matches) {
+    for (size_t i = 0; i < matches.size(); ++i) {
+        const cv::DMatch& match = matches[i];
         if (match.queryIdx >= 0 && match.queryIdx < static_cast<int>(keypoints1.size()) &&
             match.trainIdx >= 0 && match.trainIdx < static_cast<int>(keypoints2.size())) {
             points1.push_back(keypoints1[match.queryIdx].pt);
             points2.push_back(keypoints2[match.trainIdx].pt);
+            if (has_quality) {
+                quality.push_back(match_quality[i]);
+            }
         }
     }
 
@@ -50,8 +70,28 @@ cv::Mat HomographyEstimator::estimateHomography(
     }
 
     cv::Mat inlier_mask;
-    cv::Mat homography = cv::findHomography(points1, points2, cv::RANSAC,
-                                           reprojection_threshold, inlier_mask);
+    cv::Mat homography;
+    int iterations = 0;
+
+    if (backend_ == EstimatorBackend::CUSTOM_RANSAC || backend_ == EstimatorBackend::PROSAC) {
+        RANSACResult custom = backend_ == EstimatorBackend::PROSAC
+            ? ransac_.findHomographyPROSAC(points1, points2, quality, reprojection_threshold,
+                                           ransac_confidence_,
+                                           PanoramaConfig::DEFAULT_RANSAC_MAX_ITERATIONS)
+            : ransac_.findHomography(points1, points2, reprojection_threshold,
+                                     ransac_confidence_,
+                                     PanoramaConfig::DEFAULT_RANSAC_MAX_ITERATIONS);
+        homography = custom.homography;
+        iterations = custom.num_iterations;
+
+        inlier_mask.create(static_cast<int>(custom.inlier_mask.size()), 1, CV_8U);
+        for (size_t i = 0; i < custom.inlier_mask.size(); ++i) {
+            inlier_mask.at<uchar>(static_cast<int>(i)) = custom.inlier_mask[i] ? 1 : 0;
+        }
+    } else {
+        homography = cv::findHomography(points1, points2, cv::RANSAC,
+                                        reprojection_threshold, inlier_mask);
+    }
 
     int inlier_count = inlier_mask.empty() ? 0 : cv::countNonZero(inlier_mask);
     if (homography.empty() || inlier_count < PanoramaConfig::MIN_INLIERS_REQUIRED) {
@@ -112,7 +152,7 @@ cv::Mat HomographyEstimator::estimateHomography(
     last_result_.homography = homography;
     last_result_.num_inliers = static_cast<int>(inlier_matches.size());
     last_result_.inlier_ratio = matches.empty() ? 0.0 : static_cast<double>(inlier_matches.size()) / matches.size();
-    last_result_.num_iterations = 0;
+    last_result_.num_iterations = iterations;
     last_result_.computation_time_ms = std::chrono::duration<double, std::milli>(end_time - start_time).count();
 
     return homography;
@@ -160,3 +200,82 @@ cv::Rect HomographyEstimator::calculateOutputBounds(
 
     return cv::Rect(0, 0, width, height);
 }
+
+cv::Rect HomographyEstimator::calculateOutputBounds(
+    const std::vector<cv::Size>& image_sizes,
+    const std::vector<cv::Mat>& transforms) {
+
+    if (image_sizes.empty() || image_sizes.size() != transforms.size()) {
+        return cv::Rect();
+    }
+
+    float min_x = std::numeric_limits<float>::max();
+    float max_x = std::numeric_limits<float>::lowest();
+    float min_y = std::numeric_limits<float>::max();
+    float max_y = std::numeric_limits<float>::lowest();
+
+    for (size_t i = 0; i < image_sizes.size(); ++i) {
+        if (transforms[i].empty()) {
+            continue;
+        }
+
+        std::vector<cv::Point2f> corners(4);
+        corners[0] = cv::Point2f(0, 0);
+        corners[1] = cv::Point2f(static_cast<float>(image_sizes[i].width), 0);
+        corners[2] = cv::Point2f(static_cast<float>(image_sizes[i].width), static_cast<float>(image_sizes[i].height));
+        corners[3] = cv::Point2f(0, static_cast<float>(image_sizes[i].height));
+
+        std::vector<cv::Point2f> corners_transformed;
+        cv::perspectiveTransform(corners, corners_transformed, transforms[i]);
+
+        for (const auto& pt : corners_transformed) {
+            min_x = std::min(min_x, pt.x);
+            max_x = std::max(max_x, pt.x);
+            min_y = std::min(min_y, pt.y);
+            max_y = std::max(max_y, pt.y);
+        }
+    }
+
+    if (min_x > max_x || min_y > max_y) {
+        return cv::Rect();
+    }
+
+    // Unlike the pairwise overload the result is not clamped: the origin
+    // may be negative and callers decide whether the size is acceptable.
+    int padding = PanoramaConfig::PANORAMA_PADDING;
+    int x = static_cast<int>(std::floor(min_x)) - padding;
+    int y = static_cast<int>(std::floor(min_y)) - padding;
+    int width = static_cast<int>(std::ceil(max_x)) - x + padding;
+    int height = static_cast<int>(std::ceil(max_y)) - y + padding;
+
+    return cv::Rect(x, y, width, height);
+}
+
+EstimatorBackend HomographyEstimator::stringToBackend(const std::string& backend) {
+    std::string lower_backend = backend;
+    std::transform(lower_backend.begin(), lower_backend.end(), lower_backend.begin(),
+                  [](unsigned char c) { return std::tolower(c); });
+
+    if (lower_backend == "opencv") {
+        return EstimatorBackend::OPENCV_RANSAC;
+    } else if (lower_backend == "ransac") {
+        return EstimatorBackend::CUSTOM_RANSAC;
+    } else if (lower_backend == "prosac") {
+        return EstimatorBackend::PROSAC;
+    } else {
+        throw std::invalid_argument("Unknown estimator backend: " + backend);
+    }
+}
+
+std::string HomographyEstimator::backendToString(EstimatorBackend backend) {
+    switch (backend) {
+        case EstimatorBackend::OPENCV_RANSAC:
+            return "opencv";
+        case EstimatorBackend::CUSTOM_RANSAC:
+            return "ransac";
+        case EstimatorBackend::PROSAC:
+            return "prosac";
+        default:
+            return "unknown";
+    }
+}
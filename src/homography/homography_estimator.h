@@ -2,9 +2,16 @@
 #define HOMOGRAPHY_ESTIMATOR_H
 
 #include <opencv2/core.hpp>
+#include <string>
 #include <vector>
 #include "../feature_matching/ransac.h"
 
+enum class EstimatorBackend {
+    OPENCV_RANSAC,
+    CUSTOM_RANSAC,
+    PROSAC
+};
+
 class HomographyEstimator {
 public:
     HomographyEstimator();
@@ -16,7 +23,19 @@ public:
         std::vector<cv::DMatch>& inlier_matches
     );
 
+    // match_quality is parallel to matches (lower is better); it is only
+    // used by the PROSAC backend.
+    cv::Mat estimateHomography(
+        const std::vector<cv::KeyPoint>& keypoints1,
+        const std::vector<cv::KeyPoint>& keypoints2,
+        const std::vector<cv::DMatch>& matches,
+        const std::vector<double>& match_quality,
+        std::vector<cv::DMatch>& inlier_matches
+    );
+
     void setRANSACThreshold(double threshold) { ransac_threshold_ = threshold; }
+    void setBackend(EstimatorBackend backend) { backend_ = backend; }
+    EstimatorBackend getBackend() const { return backend_; }
 
     RANSACResult getLastResult() const { return last_result_; }
 
@@ -26,8 +45,17 @@ public:
         const cv::Mat& H
     );
 
+    static cv::Rect calculateOutputBounds(
+        const std::vector<cv::Size>& image_sizes,
+        const std::vector<cv::Mat>& transforms
+    );
+
+    static EstimatorBackend stringToBackend(const std::string& backend);
+    static std::string backendToString(EstimatorBackend backend);
+
 private:
     RANSAC ransac_;
+    EstimatorBackend backend_ = EstimatorBackend::OPENCV_RANSAC;
     double ransac_threshold_ = 3.0;
     double ransac_confidence_ = 0.995;
     RANSACResult last_result_;
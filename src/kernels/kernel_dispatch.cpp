@@ -0,0 +1,69 @@
+#include "kernel_dispatch.h"
+#include <opencv2/core/utility.hpp>
+#include <atomic>
+#include <initializer_list>
+
+namespace kernels_baseline { extern const KernelTable TABLE; }
+#ifdef PANORAMA_X86_DISPATCH
+namespace kernels_sse42 { extern const KernelTable TABLE; }
+namespace kernels_avx2 { extern const KernelTable TABLE; }
+namespace kernels_avx512 { extern const KernelTable TABLE; }
+#endif
+
+namespace {
+
+bool cpuSupports(std::initializer_list<int> features) {
+    for (int feature : features) {
+        if (!cv::checkHardwareSupport(feature)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Levels this CPU can run, widest last.
+std::vector<const KernelTable*> supportedTables() {
+    std::vector<const KernelTable*> tables = {&kernels_baseline::TABLE};
+#ifdef PANORAMA_X86_DISPATCH
+    if (cpuSupports({CV_CPU_SSE4_2, CV_CPU_POPCNT})) {
+        tables.push_back(&kernels_sse42::TABLE);
+    }
+    if (cpuSupports({CV_CPU_AVX2, CV_CPU_FMA3, CV_CPU_FP16, CV_CPU_POPCNT})) {
+        tables.push_back(&kernels_avx2::TABLE);
+    }
+    if (cpuSupports({CV_CPU_AVX_512F, CV_CPU_AVX_512CD, CV_CPU_AVX_512BW, CV_CPU_AVX_512DQ,
+                     CV_CPU_AVX_512VL, CV_CPU_AVX2, CV_CPU_FMA3, CV_CPU_FP16, CV_CPU_POPCNT})) {
+        tables.push_back(&kernels_avx512::TABLE);
+    }
+#endif
+    return tables;
+}
+
+std::atomic<const KernelTable*>& activeTable() {
+    static std::atomic<const KernelTable*> table(supportedTables().back());
+    return table;
+}
+
+}
+
+const KernelTable& KernelDispatch::active() {
+    return *activeTable().load(std::memory_order_relaxed);
+}
+
+std::vector<std::string> KernelDispatch::supportedLevels() {
+    std::vector<std::string> levels;
+    for (const KernelTable* table : supportedTables()) {
+        levels.push_back(table->isa);
+    }
+    return levels;
+}
+
+bool KernelDispatch::select(const std::string& isa) {
+    for (const KernelTable* table : supportedTables()) {
+        if (isa == table->isa) {
+            activeTable().store(table, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,53 @@
+#ifndef KERNEL_DISPATCH_H
+#define KERNEL_DISPATCH_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Inner loops of matching, RANSAC scoring and feathering. They are built
+// once per x86 ISA level (baseline, SSE4.2, AVX2, AVX-512) and the widest
+// level the running CPU supports is picked at startup, so one binary runs
+// on every host. Other architectures only build the baseline.
+struct KernelTable {
+    const char* isa;
+
+    // err[i] is the squared reprojection error of (sx, sy) -> (tx, ty)
+    // under the row-major homography h.
+    void (*squared_errors)(const double* h, const float* sx, const float* sy,
+                           const float* tx, const float* ty, int count, float* err);
+
+    // Folds train rows [train_begin, train_end) into the two smallest
+    // Hamming distances and the best index of each of num_queries rows.
+    void (*hamming_scan)(const unsigned char* query, size_t query_step, int num_queries,
+                         const unsigned char* train, size_t train_step,
+                         int train_begin, int train_end, int length,
+                         int* best, int* second, int* best_idx);
+
+    // One row of feathering on interleaved BGR. A pixel's weight is
+    // min(dist, radius) / radius, or mask / 255 when dist is null; pixels
+    // outside the mask get none.
+    void (*feather_accumulate)(const unsigned char* pixels, const unsigned char* mask,
+                               const float* dist, int width, float radius,
+                               float* sums, float* weights);
+    void (*feather_normalize)(const float* sums, const float* weights, int width,
+                              unsigned char* out);
+    void (*feather_blend)(const unsigned char* pixels1, const unsigned char* pixels2,
+                          const unsigned char* mask1, const unsigned char* mask2,
+                          const float* dist1, const float* dist2, int width, float radius,
+                          unsigned char* out);
+};
+
+class KernelDispatch {
+public:
+    static const KernelTable& active();
+
+    // Levels built into this binary that this CPU can run, widest last.
+    static std::vector<std::string> supportedLevels();
+
+    // Switches every caller to another supported level, e.g. to compare
+    // them in benchmarks; false when the level is unknown or unsupported.
+    static bool select(const std::string& isa);
+};
+
+#endif
@@ -0,0 +1,208 @@
+// Kernel bodies shared by the per-ISA translation units. Each includes this
+// file after defining PANORAMA_KERNEL_NAMESPACE and PANORAMA_KERNEL_ISA and
+// is compiled with that level's flags. Everything here must have internal
+// linkage or live in that namespace: an inline function emitted by several
+// of these units could otherwise be resolved to the AVX-512 copy anywhere.
+// For the same reason no std:: templates are instantiated here, and the
+// universal intrinsics come from OpenCV's per-dispatch-mode HAL namespace
+// (CV_CPU_DISPATCH_MODE, set by the dispatched units), which also sizes
+// CV_SIMD to the level.
+
+#include "kernel_dispatch.h"
+#include <opencv2/core/fast_math.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+#include <cstdint>
+#include <cstring>
+
+#ifndef __POPCNT__
+#include "../feature_matching/hamming_matcher.h"
+#endif
+
+namespace PANORAMA_KERNEL_NAMESPACE {
+
+extern const KernelTable TABLE;
+
+static void squaredErrors(const double* h, const float* __restrict sx, const float* __restrict sy,
+                          const float* __restrict tx, const float* __restrict ty,
+                          int count, float* __restrict err) {
+    const float h0 = static_cast<float>(h[0]), h1 = static_cast<float>(h[1]), h2 = static_cast<float>(h[2]);
+    const float h3 = static_cast<float>(h[3]), h4 = static_cast<float>(h[4]), h5 = static_cast<float>(h[5]);
+    const float h6 = static_cast<float>(h[6]), h7 = static_cast<float>(h[7]), h8 = static_cast<float>(h[8]);
+
+    int i = 0;
+
+#if CV_SIMD
+    const int lanes = cv::v_float32::nlanes;
+    const cv::v_float32 v_h0 = cv::vx_setall_f32(h0), v_h1 = cv::vx_setall_f32(h1), v_h2 = cv::vx_setall_f32(h2);
+    const cv::v_float32 v_h3 = cv::vx_setall_f32(h3), v_h4 = cv::vx_setall_f32(h4), v_h5 = cv::vx_setall_f32(h5);
+    const cv::v_float32 v_h6 = cv::vx_setall_f32(h6), v_h7 = cv::vx_setall_f32(h7), v_h8 = cv::vx_setall_f32(h8);
+    const cv::v_float32 v_one = cv::vx_setall_f32(1.0f);
+
+    for (; i <= count - lanes; i += lanes) {
+        cv::v_float32 x = cv::vx_load(sx + i);
+        cv::v_float32 y = cv::vx_load(sy + i);
+
+        cv::v_float32 px = cv::v_fma(v_h0, x, cv::v_fma(v_h1, y, v_h2));
+        cv::v_float32 py = cv::v_fma(v_h3, x, cv::v_fma(v_h4, y, v_h5));
+        cv::v_float32 pw = cv::v_fma(v_h6, x, cv::v_fma(v_h7, y, v_h8));
+
+        cv::v_float32 inv_w = v_one / pw;
+        cv::v_float32 dx = px * inv_w - cv::vx_load(tx + i);
+        cv::v_float32 dy = py * inv_w - cv::vx_load(ty + i);
+
+        cv::v_store(err + i, cv::v_fma(dx, dx, dy * dy));
+    }
+    cv::vx_cleanup();
+#endif
+
+    for (; i < count; i++) {
+        float inv_w = 1.0f / (h6 * sx[i] + h7 * sy[i] + h8);
+        float dx = (h0 * sx[i] + h1 * sy[i] + h2) * inv_w - tx[i];
+        float dy = (h3 * sx[i] + h4 * sy[i] + h5) * inv_w - ty[i];
+        err[i] = dx * dx + dy * dy;
+    }
+}
+
+// Scalar popcnt on 64-bit words: ORB and AKAZE descriptors are 32 and 61
+// bytes, too short for wide vectors to beat four or eight popcnt
+// instructions without VPOPCNTDQ, which the AVX-512 level does not assume.
+// featherAccumulate is written for the compiler's vectorizer; normalize and
+// blend round through cvRound per channel and stay scalar, but run once per
+// output pixel rather than once per input.
+static inline int hammingDistance(const unsigned char* a, const unsigned char* b, int length) {
+#ifdef __POPCNT__
+    int result = 0;
+    int i = 0;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t x, y;
+        std::memcpy(&x, a + i, 8);
+        std::memcpy(&y, b + i, 8);
+        result += __builtin_popcountll(x ^ y);
+    }
+    for (; i < length; i++) {
+        result += __builtin_popcount(static_cast<unsigned>(a[i] ^ b[i]));
+    }
+    return result;
+#else
+    return HammingMatcher::distance(a, b, length);
+#endif
+}
+
+static void hammingScan(const unsigned char* query, size_t query_step, int num_queries,
+                        const unsigned char* train, size_t train_step,
+                        int train_begin, int train_end, int length,
+                        int* best, int* second, int* best_idx) {
+    for (int q = 0; q < num_queries; q++) {
+        const unsigned char* descriptor = query + q * query_step;
+        int d1 = best[q];
+        int d2 = second[q];
+        int idx = best_idx[q];
+
+        for (int t = train_begin; t < train_end; t++) {
+            int d = hammingDistance(descriptor, train + t * train_step, length);
+            if (d < d2) {
+                if (d < d1) {
+                    d2 = d1;
+                    d1 = d;
+                    idx = t;
+                } else {
+                    d2 = d;
+                }
+            }
+        }
+
+        best[q] = d1;
+        second[q] = d2;
+        best_idx[q] = idx;
+    }
+}
+
+static inline unsigned char saturateToByte(float value) {
+    int rounded = cvRound(value);
+    return static_cast<unsigned char>(rounded < 0 ? 0 : (rounded > 255 ? 255 : rounded));
+}
+
+static void featherAccumulate(const unsigned char* __restrict pixels, const unsigned char* __restrict mask,
+                              const float* __restrict dist, int width, float radius,
+                              float* __restrict sums, float* __restrict weights) {
+    // Adding a zero weight leaves the sums unchanged, so the loops need no
+    // branch on the mask; multiplying by it instead of selecting keeps them
+    // vectorizable below AVX-512.
+    if (dist) {
+        const float inv_radius = 1.0f / radius;
+        for (int x = 0; x < width; x++) {
+            float d = dist[x] < radius ? dist[x] : radius;
+            float w = static_cast<float>(mask[x] != 0) * (d * inv_radius);
+            sums[3 * x] += w * pixels[3 * x];
+            sums[3 * x + 1] += w * pixels[3 * x + 1];
+            sums[3 * x + 2] += w * pixels[3 * x + 2];
+            weights[x] += w;
+        }
+    } else {
+        const float inv_255 = 1.0f / 255.0f;
+        for (int x = 0; x < width; x++) {
+            float w = mask[x] * inv_255;
+            sums[3 * x] += w * pixels[3 * x];
+            sums[3 * x + 1] += w * pixels[3 * x + 1];
+            sums[3 * x + 2] += w * pixels[3 * x + 2];
+            weights[x] += w;
+        }
+    }
+}
+
+static void featherNormalize(const float* __restrict sums, const float* __restrict weights, int width,
+                             unsigned char* __restrict out) {
+    for (int x = 0; x < width; x++) {
+        if (weights[x] <= 0.0f) {
+            out[3 * x] = out[3 * x + 1] = out[3 * x + 2] = 0;
+            continue;
+        }
+        float inv = 1.0f / weights[x];
+        out[3 * x] = saturateToByte(sums[3 * x] * inv);
+        out[3 * x + 1] = saturateToByte(sums[3 * x + 1] * inv);
+        out[3 * x + 2] = saturateToByte(sums[3 * x + 2] * inv);
+    }
+}
+
+static void featherBlend(const unsigned char* __restrict pixels1, const unsigned char* __restrict pixels2,
+                         const unsigned char* __restrict mask1, const unsigned char* __restrict mask2,
+                         const float* __restrict dist1, const float* __restrict dist2,
+                         int width, float radius, unsigned char* __restrict out) {
+    const float inv_radius = dist1 ? 1.0f / radius : 0.0f;
+    const float inv_255 = 1.0f / 255.0f;
+
+    for (int x = 0; x < width; x++) {
+        float w1, w2;
+        if (dist1) {
+            w1 = (dist1[x] < radius ? dist1[x] : radius) * inv_radius;
+            w2 = (dist2[x] < radius ? dist2[x] : radius) * inv_radius;
+        } else {
+            w1 = mask1[x] * inv_255;
+            w2 = mask2[x] * inv_255;
+        }
+
+        float weight_sum = w1 + w2;
+        if (weight_sum <= 0.0f) {
+            out[3 * x] = out[3 * x + 1] = out[3 * x + 2] = 0;
+            continue;
+        }
+
+        float inv_sum = 1.0f / weight_sum;
+        w1 *= inv_sum;
+        w2 *= inv_sum;
+        for (int c = 0; c < 3; c++) {
+            out[3 * x + c] = saturateToByte(pixels1[3 * x + c] * w1 + pixels2[3 * x + c] * w2);
+        }
+    }
+}
+
+const KernelTable TABLE = {
+    PANORAMA_KERNEL_ISA,
+    squaredErrors,
+    hammingScan,
+    featherAccumulate,
+    featherNormalize,
+    featherBlend
+};
+
+}
@@ -0,0 +1,15 @@
+// OpenCV's dispatch macros, as for its own *.simd.hpp units; they must
+// precede every OpenCV include.
+#define CV_CPU_DISPATCH_MODE AVX2
+#define CV_CPU_DISPATCH_COMPILE_SSE3 1
+#define CV_CPU_DISPATCH_COMPILE_SSSE3 1
+#define CV_CPU_DISPATCH_COMPILE_SSE4_1 1
+#define CV_CPU_DISPATCH_COMPILE_SSE4_2 1
+#define CV_CPU_DISPATCH_COMPILE_POPCNT 1
+#define CV_CPU_DISPATCH_COMPILE_AVX 1
+#define CV_CPU_DISPATCH_COMPILE_FP16 1
+#define CV_CPU_DISPATCH_COMPILE_AVX2 1
+#define CV_CPU_DISPATCH_COMPILE_FMA3 1
+#define PANORAMA_KERNEL_NAMESPACE kernels_avx2
+#define PANORAMA_KERNEL_ISA "avx2"
+#include "kernels.simd.h"
@@ -0,0 +1,18 @@
+// OpenCV's dispatch macros, as for its own *.simd.hpp units; they must
+// precede every OpenCV include.
+#define CV_CPU_DISPATCH_MODE AVX512_SKX
+#define CV_CPU_DISPATCH_COMPILE_SSE3 1
+#define CV_CPU_DISPATCH_COMPILE_SSSE3 1
+#define CV_CPU_DISPATCH_COMPILE_SSE4_1 1
+#define CV_CPU_DISPATCH_COMPILE_SSE4_2 1
+#define CV_CPU_DISPATCH_COMPILE_POPCNT 1
+#define CV_CPU_DISPATCH_COMPILE_AVX 1
+#define CV_CPU_DISPATCH_COMPILE_FP16 1
+#define CV_CPU_DISPATCH_COMPILE_AVX2 1
+#define CV_CPU_DISPATCH_COMPILE_FMA3 1
+#define CV_CPU_DISPATCH_COMPILE_AVX_512F 1
+#define CV_CPU_DISPATCH_COMPILE_AVX512_COMMON 1
+#define CV_CPU_DISPATCH_COMPILE_AVX512_SKX 1
+#define PANORAMA_KERNEL_NAMESPACE kernels_avx512
+#define PANORAMA_KERNEL_ISA "avx512"
+#include "kernels.simd.h"
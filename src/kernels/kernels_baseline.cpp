@@ -0,0 +1,3 @@
+#define PANORAMA_KERNEL_NAMESPACE kernels_baseline
+#define PANORAMA_KERNEL_ISA "baseline"
+#include "kernels.simd.h"
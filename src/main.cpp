@@ -1,12 +1,160 @@
 #include <iostream>
+#include <memory>
 #include <vector>
 #include <opencv2/opencv.hpp>
 #include <opencv2/highgui.hpp>
 
 #include "cli/argument_parser.h"
 #include "pipeline/stitching_pipeline.h"
+#include "pipeline/batch_runner.h"
+#include "pipeline/stage_profiler.h"
 #include "experiments/experiment_runner.h"
 
+static StitchingOptions makeStitchingOptions(const ProgramArguments& args, DiagnosticsSink* diagnostics,
+                                             StageProfiler* profiler = nullptr) {
+    StitchingOptions options;
+    options.detector_type = args.detector_type;
+    options.blend_mode = args.blend_mode;
+    options.estimator_backend = args.estimator_backend;
+    options.ransac_threshold = args.ransac_threshold;
+    options.max_features = args.max_features;
+    options.blend_memory_mb = args.blend_memory_mb;
+    options.visualize = args.visualize;
+    options.coarse_to_fine = args.coarse_to_fine;
+    options.gain_compensation = args.gain_compensation;
+    options.quick_reject = args.quick_reject;
+    options.opencl = args.opencl;
+    options.projection = args.projection;
+    options.focal_length = args.focal_length;
+    options.keyframe_overlap = args.keyframe_overlap;
+    options.guided_matching = args.guided_matching;
+    options.ann_checks = args.ann_checks;
+    options.uniform_keypoints = args.uniform_keypoints;
+    options.cache_dir = args.cache_dir;
+    options.diagnostics = diagnostics;
+    options.profiler = profiler;
+    return options;
+}
+
+static bool loadImages(const std::vector<std::string>& paths, std::vector<cv::Mat>& images,
+                       StageProfiler* profiler = nullptr) {
+    StageProfiler::Scope timer(profiler, "decode");
+    for (const auto& path : paths) {
+        cv::Mat img = cv::imread(path);
+        if (img.empty()) {
+            std::cerr << "Error: Could not load image: " << path << "\n";
+            return false;
+        }
+        images.push_back(img);
+    }
+    return true;
+}
+
+static int runTiledStitching(const ProgramArguments& args) {
+    std::vector<cv::Mat> images;
+    if (!loadImages(args.image_paths, images)) {
+        return 1;
+    }
+
+    DiagnosticsSink diagnostics(DiagnosticsSink::stringToLevel(args.diagnostics_level));
+    if (!StitchingPipeline::performTiledStitching(images, args.tiled_output_dir,
+                                                  makeStitchingOptions(args, &diagnostics))) {
+        std::cerr << "Stitching failed!\n";
+        return 1;
+    }
+
+    std::cout << "Tile pyramid saved to: " << args.tiled_output_dir << "\n";
+    return 0;
+}
+
+static cv::Mat stitchImages(const ProgramArguments& args, const StitchingOptions& options) {
+    if (args.mode == ProgramArguments::STITCH_TWO) {
+        return StitchingPipeline::performStitching(args.image_paths[0], args.image_paths[1], options);
+    }
+
+    if (args.mode == ProgramArguments::VIDEO) {
+        return StitchingPipeline::performVideoStitching(args.image_paths[0], options);
+    }
+
+    if (args.multi_mode == "streaming") {
+        return StitchingPipeline::performStreamingStitching(args.image_paths, options);
+    }
+
+    std::vector<cv::Mat> images;
+    if (!loadImages(args.image_paths, images, options.profiler)) {
+        return cv::Mat();
+    }
+
+    if (args.multi_mode == "global") {
+        return StitchingPipeline::performGlobalStitching(images, options);
+    }
+    if (args.multi_mode == "unordered") {
+        return StitchingPipeline::performUnorderedStitching(images, options);
+    }
+    return StitchingPipeline::performSequentialStitching(images, options);
+}
+
+// Shared by the single-job modes and every job of a batch.
+static int runStitchJob(const ProgramArguments& args) {
+    if (!args.tiled_output_dir.empty()) {
+        return runTiledStitching(args);
+    }
+
+    std::unique_ptr<StageProfiler> profiler;
+    if (!args.profile_path.empty()) {
+        profiler = std::make_unique<StageProfiler>(args.output_path);
+    }
+
+    DiagnosticsSink diagnostics(DiagnosticsSink::stringToLevel(args.diagnostics_level));
+    cv::Mat result = stitchImages(args, makeStitchingOptions(args, &diagnostics, profiler.get()));
+
+    bool written = false;
+    if (!result.empty()) {
+        StageProfiler::Scope timer(profiler.get(), "encode");
+        written = cv::imwrite(args.output_path, result);
+    }
+
+    if (profiler) {
+        profiler->setMetric("success", written ? 1.0 : 0.0);
+        profiler->appendJsonLine(args.profile_path);
+    }
+
+    if (result.empty()) {
+        std::cerr << "Stitching failed!\n";
+        return 1;
+    }
+
+    if (!written) {
+        std::cerr << "Error: Could not write panorama to " << args.output_path << "\n";
+        return 1;
+    }
+    std::cout << "Panorama saved to: " << args.output_path << "\n";
+
+    if (args.visualize) {
+        cv::imshow("Panorama", result);
+        std::cout << "Press any key to exit...\n";
+        cv::waitKey(0);
+    }
+
+    return 0;
+}
+
+static int runBatch(const ProgramArguments& args) {
+    std::vector<ProgramArguments> jobs;
+    if (!ArgumentParser::loadManifest(args.batch_manifest, args, jobs)) {
+        return 1;
+    }
+
+    BatchRunner runner(args.batch_workers);
+    BatchSummary summary = runner.run(jobs, [](const ProgramArguments& job) {
+        return runStitchJob(job) == 0;
+    });
+
+    std::cout << "Batch finished: " << summary.succeeded << " succeeded, " << summary.failed
+              << " failed in " << static_cast<int>(summary.total_time_ms) << " ms\n";
+    return summary.failed == 0 ? 0 : 1;
+}
+
 int main(int argc, char** argv) {
     ProgramArguments args = ArgumentParser::parse(argc, argv);
 
@@ -19,6 +167,8 @@ int main(int argc, char** argv) {
         case ProgramArguments::EXPERIMENT: {
             std::cout << "\n=== Running experiments ===\n";
             ExperimentRunner runner;
+            runner.setWorkers(args.batch_workers);
+            runner.setWriteVisualizations(args.experiment_images);
             runner.runAllExperiments();
             runner.generateReport("results/report.md");
             runner.exportMetricsToCSV("results/experiment_metrics.csv");
@@ -28,77 +178,29 @@ int main(int argc, char** argv) {
             return 0;
         }
 
-        case ProgramArguments::STITCH_TWO: {
+        case ProgramArguments::STITCH_TWO:
             std::cout << "\n=== Stitching two images ===\n";
-            cv::Mat result = StitchingPipeline::performStitching(
-                args.image_paths[0],
-                args.image_paths[1],
-                args.detector_type,
-                args.blend_mode,
-                args.ransac_threshold,
-                args.max_features,
-                args.visualize
-            );
-
-            if (result.empty()) {
-                std::cerr << "Stitching failed!\n";
-                return 1;
-            }
-
-            cv::imwrite(args.output_path, result);
-            std::cout << "Panorama saved to: " << args.output_path << "\n";
-
-            if (args.visualize) {
-                cv::imshow("Panorama", result);
-                std::cout << "Press any key to exit...\n";
-                cv::waitKey(0);
-            }
-
-            return 0;
-        }
+            return runStitchJob(args);
 
-        case ProgramArguments::STITCH_MULTIPLE: {
+        case ProgramArguments::STITCH_MULTIPLE:
             std::cout << "\n=== Stitching multiple images ===\n";
-            std::vector<cv::Mat> images;
-
-            for (const auto& path : args.image_paths) {
-                cv::Mat img = cv::imread(path);
-                if (img.empty()) {
-                    std::cerr << "Error: Could not load image: " << path << "\n";
-                    return 1;
-                }
-                images.push_back(img);
-            }
+            return runStitchJob(args);
 
-            cv::Mat result = StitchingPipeline::performSequentialStitching(
-                images,
-                args.detector_type,
-                args.blend_mode,
-                args.ransac_threshold,
-                args.max_features,
-                args.visualize
-            );
-
-            if (result.empty()) {
-                std::cerr << "Stitching failed!\n";
+        case ProgramArguments::VIDEO:
+            std::cout << "\n=== Stitching video " << args.image_paths[0] << " ===\n";
+            if (!args.tiled_output_dir.empty()) {
+                std::cerr << "Error: --tiled-output is not supported for video input\n";
                 return 1;
             }
+            return runStitchJob(args);
 
-            cv::imwrite(args.output_path, result);
-            std::cout << "Panorama saved to: " << args.output_path << "\n";
-
-            if (args.visualize) {
-                cv::imshow("Panorama", result);
-                std::cout << "Press any key to exit...\n";
-                cv::waitKey(0);
-            }
-
-            return 0;
-        }
+        case ProgramArguments::BATCH:
+            std::cout << "\n=== Stitching batch " << args.batch_manifest << " ===\n";
+            return runBatch(args);
 
         default:
             std::cerr << "Error: No valid mode specified\n";
             ArgumentParser::printUsage(argv[0]);
             return 1;
     }
-}
\ No newline at end of file
+}
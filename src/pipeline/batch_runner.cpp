@@ -0,0 +1,111 @@
+#include "batch_runner.h"
+#include "image_loader.h"
+#include "thread_pool.h"
+#include <opencv2/core/utility.hpp>
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <thread>
+
+BatchRunner::BatchRunner(int workers, size_t memory_budget)
+    : memory_budget_(memory_budget) {
+    size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    workers_ = workers > 0
+        ? static_cast<size_t>(workers)
+        : std::max<size_t>(1, cores / PanoramaConfig::BATCH_THREADS_PER_JOB);
+}
+
+BatchSummary BatchRunner::run(const std::vector<ProgramArguments>& jobs, const JobFunction& execute) {
+    BatchSummary summary;
+    if (jobs.empty()) {
+        return summary;
+    }
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    size_t workers = std::min(workers_, jobs.size());
+    size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    int previous_threads = cv::getNumThreads();
+    int threads_per_job = static_cast<int>(std::max<size_t>(1, cores / workers));
+    cv::setNumThreads(threads_per_job);
+
+    std::cout << "Running " << jobs.size() << " jobs on " << workers << " workers ("
+              << threads_per_job << " OpenCV threads each, "
+              << (memory_budget_ / 1048576) << " MB budget)\n";
+
+    // The jobs get their own pool: they submit detection work to the
+    // pipeline's shared pool and must not wait on it from its own workers.
+    std::vector<std::future<bool>> pending;
+    pending.reserve(jobs.size());
+    {
+        ThreadPool pool(workers);
+        std::mutex log_mutex;
+
+        for (size_t i = 0; i < jobs.size(); i++) {
+            pending.push_back(pool.submit([this, &jobs, &execute, &log_mutex, i]() {
+                const ProgramArguments& job = jobs[i];
+                size_t bytes = std::min(estimateJobBytes(job), memory_budget_);
+                reserve(bytes);
+
+                auto job_start = std::chrono::high_resolution_clock::now();
+                bool ok = false;
+                try {
+                    ok = execute(job);
+                } catch (const std::exception& e) {
+                    std::lock_guard<std::mutex> lock(log_mutex);
+                    std::cerr << "Error: Job " << (i + 1) << " failed: " << e.what() << "\n";
+                }
+                release(bytes);
+
+                auto job_end = std::chrono::high_resolution_clock::now();
+                double ms = std::chrono::duration<double, std::milli>(job_end - job_start).count();
+
+                std::lock_guard<std::mutex> lock(log_mutex);
+                std::cout << "[job " << (i + 1) << "/" << jobs.size() << "] "
+                          << (ok ? "done" : "FAILED") << " in " << static_cast<int>(ms) << " ms: "
+                          << (job.tiled_output_dir.empty() ? job.output_path : job.tiled_output_dir) << "\n";
+                return ok;
+            }));
+        }
+
+        for (auto& result : pending) {
+            if (result.get()) {
+                summary.succeeded++;
+            } else {
+                summary.failed++;
+            }
+        }
+    }
+
+    cv::setNumThreads(previous_threads);
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    summary.total_time_ms = std::chrono::duration<double, std::milli>(end_time - start_time).count();
+    return summary;
+}
+
+size_t BatchRunner::estimateJobBytes(const ProgramArguments& job) {
+    size_t pixels = 0;
+    for (const auto& path : job.image_paths) {
+        cv::Size size = ImageLoader::readImageSize(path);
+        pixels += static_cast<size_t>(size.width) * size.height;
+    }
+    return pixels * PanoramaConfig::BATCH_BYTES_PER_INPUT_PIXEL;
+}
+
+void BatchRunner::reserve(size_t bytes) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    memory_released_.wait(lock, [this, bytes]() {
+        return reserved_bytes_ == 0 || reserved_bytes_ + bytes <= memory_budget_;
+    });
+    reserved_bytes_ += bytes;
+}
+
+void BatchRunner::release(size_t bytes) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        reserved_bytes_ -= bytes;
+    }
+    memory_released_.notify_all();
+}
@@ -0,0 +1,45 @@
+#ifndef BATCH_RUNNER_H
+#define BATCH_RUNNER_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
+#include "../config.h"
+#include "../cli/argument_parser.h"
+
+struct BatchSummary {
+    int succeeded = 0;
+    int failed = 0;
+    double total_time_ms = 0.0;
+};
+
+// Runs independent stitch jobs on a fixed set of workers. A job only starts
+// once its estimated footprint fits in the memory budget next to the jobs
+// already running (a job larger than the budget runs alone), and OpenCV's
+// own threads are divided among the workers while the batch runs.
+class BatchRunner {
+public:
+    using JobFunction = std::function<bool(const ProgramArguments&)>;
+
+    // workers == 0 picks one worker per BATCH_THREADS_PER_JOB cores.
+    explicit BatchRunner(int workers = 0, size_t memory_budget = PanoramaConfig::MAX_PANORAMA_MEMORY);
+
+    BatchSummary run(const std::vector<ProgramArguments>& jobs, const JobFunction& execute);
+
+    // Upper estimate of the peak memory of a job, from the image headers.
+    static size_t estimateJobBytes(const ProgramArguments& job);
+
+private:
+    size_t workers_;
+    size_t memory_budget_;
+
+    std::mutex mutex_;
+    std::condition_variable memory_released_;
+    size_t reserved_bytes_ = 0;
+
+    void reserve(size_t bytes);
+    void release(size_t bytes);
+};
+
+#endif
@@ -0,0 +1,162 @@
+#include "diagnostics.h"
+#include <opencv2/imgcodecs.hpp>
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+DiagnosticsSink::DiagnosticsSink(DiagnosticsLevel level, const std::string& output_dir)
+    : level_(level), output_dir_(output_dir), async_(level == DiagnosticsLevel::FULL) {
+    if (async_) {
+        writer_ = std::thread([this]() { writerLoop(); });
+    }
+}
+
+DiagnosticsSink::~DiagnosticsSink() {
+    if (async_) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        queue_changed_.notify_all();
+        if (writer_.joinable()) {
+            writer_.join();
+        }
+    }
+}
+
+int DiagnosticsSink::beginStitch() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ++stitch_counter_;
+}
+
+void DiagnosticsSink::recordKeypoints(int stitch_id, const std::string& tag,
+                                      const cv::Mat& img1, const std::vector<cv::KeyPoint>& keypoints1,
+                                      const cv::Mat& img2, const std::vector<cv::KeyPoint>& keypoints2) {
+    if (!enabled(DiagnosticsLevel::FULL)) {
+        return;
+    }
+
+    cv::Mat kp_vis1, kp_vis2;
+    cv::drawKeypoints(img1, keypoints1, kp_vis1, cv::Scalar(0, 255, 0),
+                     cv::DrawMatchesFlags::DRAW_RICH_KEYPOINTS);
+    cv::drawKeypoints(img2, keypoints2, kp_vis2, cv::Scalar(0, 255, 0),
+                     cv::DrawMatchesFlags::DRAW_RICH_KEYPOINTS);
+
+    std::string base = basePath(stitch_id, tag);
+    writeImage(base + "_keypoints1.jpg", kp_vis1);
+    writeImage(base + "_keypoints2.jpg", kp_vis2);
+}
+
+void DiagnosticsSink::recordMatches(int stitch_id, const std::string& tag, const std::string& stage,
+                                    const cv::Mat& img1, const std::vector<cv::KeyPoint>& keypoints1,
+                                    const cv::Mat& img2, const std::vector<cv::KeyPoint>& keypoints2,
+                                    const std::vector<cv::DMatch>& matches) {
+    DiagnosticsLevel required = stage == "after_ransac" ? DiagnosticsLevel::SUMMARY : DiagnosticsLevel::FULL;
+    if (!enabled(required) || matches.empty()) {
+        return;
+    }
+
+    cv::Mat match_vis;
+    cv::drawMatches(img1, keypoints1, img2, keypoints2, matches, match_vis,
+                   cv::Scalar(0, 255, 0), cv::Scalar(255, 0, 0),
+                   std::vector<char>(),
+                   cv::DrawMatchesFlags::NOT_DRAW_SINGLE_POINTS);
+
+    writeImage(basePath(stitch_id, tag) + "_matches_" + stage + ".jpg", match_vis);
+}
+
+void DiagnosticsSink::flush() {
+    if (!async_) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    queue_changed_.wait(lock, [this]() { return pending_.empty() && in_flight_ == 0; });
+}
+
+DiagnosticsLevel DiagnosticsSink::stringToLevel(const std::string& level) {
+    std::string lower_level = level;
+    std::transform(lower_level.begin(), lower_level.end(), lower_level.begin(),
+                  [](unsigned char c) { return std::tolower(c); });
+
+    if (lower_level == "off") {
+        return DiagnosticsLevel::OFF;
+    } else if (lower_level == "summary") {
+        return DiagnosticsLevel::SUMMARY;
+    } else if (lower_level == "full") {
+        return DiagnosticsLevel::FULL;
+    } else {
+        throw std::invalid_argument("Unknown diagnostics level: " + level);
+    }
+}
+
+std::string DiagnosticsSink::levelToString(DiagnosticsLevel level) {
+    switch (level) {
+        case DiagnosticsLevel::OFF:
+            return "off";
+        case DiagnosticsLevel::SUMMARY:
+            return "summary";
+        case DiagnosticsLevel::FULL:
+            return "full";
+        default:
+            return "unknown";
+    }
+}
+
+std::string DiagnosticsSink::basePath(int stitch_id, const std::string& tag) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!directory_ready_) {
+            fs::create_directories(output_dir_);
+            directory_ready_ = true;
+        }
+    }
+
+    return output_dir_ + "/stitch_" + std::to_string(stitch_id) + "_" + tag;
+}
+
+void DiagnosticsSink::writeImage(const std::string& path, const cv::Mat& image) {
+    if (!async_) {
+        cv::imwrite(path, image);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.emplace(path, image);
+    }
+    queue_changed_.notify_all();
+}
+
+void DiagnosticsSink::writerLoop() {
+    while (true) {
+        std::pair<std::string, cv::Mat> job;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            queue_changed_.wait(lock, [this]() { return stopping_ || !pending_.empty(); });
+
+            if (pending_.empty()) {
+                return;
+            }
+
+            job = std::move(pending_.front());
+            pending_.pop();
+            in_flight_++;
+        }
+
+        if (!cv::imwrite(job.first, job.second)) {
+            std::cerr << "Warning: Could not write diagnostics image " << job.first << "\n";
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            in_flight_--;
+        }
+        queue_changed_.notify_all();
+    }
+}
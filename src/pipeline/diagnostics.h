@@ -0,0 +1,74 @@
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+
+#include <opencv2/core.hpp>
+#include <opencv2/features2d.hpp>
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+enum class DiagnosticsLevel {
+    OFF,
+    SUMMARY,
+    FULL
+};
+
+// Collects the debug visualizations of the stitching pipeline. SUMMARY
+// writes the inlier matches of every stitch, FULL additionally writes the
+// keypoint and pre-RANSAC match images. With FULL the JPEG encoding runs
+// on a background thread. Callers should check enabled() before drawing so
+// that the OFF level costs nothing.
+class DiagnosticsSink {
+public:
+    explicit DiagnosticsSink(DiagnosticsLevel level = DiagnosticsLevel::OFF,
+                             const std::string& output_dir = "results/visualizations");
+    ~DiagnosticsSink();
+
+    DiagnosticsSink(const DiagnosticsSink&) = delete;
+    DiagnosticsSink& operator=(const DiagnosticsSink&) = delete;
+
+    DiagnosticsLevel getLevel() const { return level_; }
+    bool enabled(DiagnosticsLevel required) const {
+        return level_ != DiagnosticsLevel::OFF && level_ >= required;
+    }
+
+    int beginStitch();
+
+    void recordKeypoints(int stitch_id, const std::string& tag,
+                         const cv::Mat& img1, const std::vector<cv::KeyPoint>& keypoints1,
+                         const cv::Mat& img2, const std::vector<cv::KeyPoint>& keypoints2);
+
+    void recordMatches(int stitch_id, const std::string& tag, const std::string& stage,
+                       const cv::Mat& img1, const std::vector<cv::KeyPoint>& keypoints1,
+                       const cv::Mat& img2, const std::vector<cv::KeyPoint>& keypoints2,
+                       const std::vector<cv::DMatch>& matches);
+
+    void flush();
+
+    static DiagnosticsLevel stringToLevel(const std::string& level);
+    static std::string levelToString(DiagnosticsLevel level);
+
+private:
+    DiagnosticsLevel level_;
+    std::string output_dir_;
+    bool directory_ready_ = false;
+    int stitch_counter_ = 0;
+
+    bool async_;
+    std::thread writer_;
+    std::queue<std::pair<std::string, cv::Mat>> pending_;
+    std::mutex mutex_;
+    std::condition_variable queue_changed_;
+    bool stopping_ = false;
+    int in_flight_ = 0;
+
+    std::string basePath(int stitch_id, const std::string& tag);
+    void writeImage(const std::string& path, const cv::Mat& image);
+    void writerLoop();
+};
+
+#endif
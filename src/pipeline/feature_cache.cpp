@@ -0,0 +1,134 @@
+#include "feature_cache.h"
+#include <opencv2/imgproc.hpp>
+#include <numeric>
+
+void FeatureCache::addImage(int image_index, const DetectionResult& features,
+                            const cv::Mat& to_panorama, const cv::Size& image_size) {
+    std::vector<cv::Point2f> corners = {
+        cv::Point2f(0, 0),
+        cv::Point2f(static_cast<float>(image_size.width), 0),
+        cv::Point2f(static_cast<float>(image_size.width), static_cast<float>(image_size.height)),
+        cv::Point2f(0, static_cast<float>(image_size.height))
+    };
+
+    cv::Mat transform;
+    to_panorama.convertTo(transform, CV_64F);
+
+    std::vector<cv::Point2f> footprint;
+    cv::perspectiveTransform(corners, footprint, transform);
+
+    // The new image covers this part of the panorama, so older keypoints in
+    // that area would only duplicate its own and break the ratio test.
+    suppressCovered(footprint);
+
+    Entry entry;
+    entry.image_index = image_index;
+    entry.features = features;
+    entry.to_panorama = transform;
+    entry.active.resize(features.keypoints.size());
+    std::iota(entry.active.begin(), entry.active.end(), 0);
+
+    entries_.push_back(std::move(entry));
+    dirty_ = true;
+}
+
+void FeatureCache::applyTransform(const cv::Mat& panorama_transform) {
+    cv::Mat transform;
+    panorama_transform.convertTo(transform, CV_64F);
+
+    for (auto& entry : entries_) {
+        entry.to_panorama = transform * entry.to_panorama;
+    }
+    dirty_ = true;
+}
+
+const DetectionResult& FeatureCache::panoramaFeatures() {
+    if (!dirty_) {
+        return merged_;
+    }
+
+    merged_ = DetectionResult{};
+    merged_.detection_time_ms = 0.0;
+    merged_.description_time_ms = 0.0;
+
+    std::vector<cv::Mat> descriptor_blocks;
+
+    for (const auto& entry : entries_) {
+        if (entry.active.empty()) {
+            continue;
+        }
+
+        merged_.detector_name = entry.features.detector_name;
+
+        std::vector<cv::Point2f> source_points;
+        source_points.reserve(entry.active.size());
+        for (int idx : entry.active) {
+            source_points.push_back(entry.features.keypoints[idx].pt);
+        }
+
+        std::vector<cv::Point2f> panorama_points;
+        cv::perspectiveTransform(source_points, panorama_points, entry.to_panorama);
+
+        cv::Mat descriptors(static_cast<int>(entry.active.size()),
+                            entry.features.descriptors.cols,
+                            entry.features.descriptors.type());
+
+        for (size_t i = 0; i < entry.active.size(); ++i) {
+            int idx = entry.active[i];
+            cv::KeyPoint kp = entry.features.keypoints[idx];
+            kp.pt = panorama_points[i];
+            merged_.keypoints.push_back(kp);
+            entry.features.descriptors.row(idx).copyTo(descriptors.row(static_cast<int>(i)));
+        }
+
+        descriptor_blocks.push_back(descriptors);
+    }
+
+    if (!descriptor_blocks.empty()) {
+        cv::vconcat(descriptor_blocks, merged_.descriptors);
+    }
+
+    dirty_ = false;
+    return merged_;
+}
+
+cv::Mat FeatureCache::transformOf(int image_index) const {
+    for (const auto& entry : entries_) {
+        if (entry.image_index == image_index) {
+            return entry.to_panorama;
+        }
+    }
+    return cv::Mat();
+}
+
+void FeatureCache::clear() {
+    entries_.clear();
+    merged_ = DetectionResult{};
+    dirty_ = true;
+}
+
+void FeatureCache::suppressCovered(const std::vector<cv::Point2f>& footprint) {
+    for (auto& entry : entries_) {
+        if (entry.active.empty()) {
+            continue;
+        }
+
+        std::vector<cv::Point2f> source_points;
+        source_points.reserve(entry.active.size());
+        for (int idx : entry.active) {
+            source_points.push_back(entry.features.keypoints[idx].pt);
+        }
+
+        std::vector<cv::Point2f> panorama_points;
+        cv::perspectiveTransform(source_points, panorama_points, entry.to_panorama);
+
+        std::vector<int> kept;
+        kept.reserve(entry.active.size());
+        for (size_t i = 0; i < entry.active.size(); ++i) {
+            if (cv::pointPolygonTest(footprint, panorama_points[i], false) < 0) {
+                kept.push_back(entry.active[i]);
+            }
+        }
+        entry.active.swap(kept);
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef FEATURE_CACHE_H
+#define FEATURE_CACHE_H
+
+#include <opencv2/core.hpp>
+#include <vector>
+#include "../feature_detection/feature_detector.h"
+
+// Keeps the features of every image already placed in a panorama so that
+// sequential stitching never has to re-detect on the accumulated canvas.
+// Keypoints stay in their source image coordinates; each entry carries the
+// chained homography that maps them into the current panorama frame.
+class FeatureCache {
+public:
+    FeatureCache() = default;
+
+    void addImage(int image_index, const DetectionResult& features,
+                  const cv::Mat& to_panorama, const cv::Size& image_size);
+
+    // Re-anchors every cached image after the panorama itself was warped
+    // by `panorama_transform` into a new canvas.
+    void applyTransform(const cv::Mat& panorama_transform);
+
+    // Keypoints (in panorama coordinates) and descriptors of all cached
+    // images, concatenated in insertion order.
+    const DetectionResult& panoramaFeatures();
+
+    // Current image -> panorama homography of a cached image, or an empty
+    // Mat when the image is not in the cache.
+    cv::Mat transformOf(int image_index) const;
+
+    void clear();
+    bool empty() const { return entries_.empty(); }
+    size_t size() const { return entries_.size(); }
+
+private:
+    struct Entry {
+        int image_index;
+        DetectionResult features;
+        cv::Mat to_panorama;
+        std::vector<int> active;
+    };
+
+    std::vector<Entry> entries_;
+    DetectionResult merged_;
+    bool dirty_ = true;
+
+    void suppressCovered(const std::vector<cv::Point2f>& footprint);
+};
+
+#endif
@@ -0,0 +1,147 @@
+#include "image_loader.h"
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <initializer_list>
+#include <iostream>
+#include <utility>
+
+static int readBigEndian16(std::istream& in) {
+    int hi = in.get();
+    int lo = in.get();
+    if (hi == EOF || lo == EOF) {
+        return -1;
+    }
+    return (hi << 8) | lo;
+}
+
+static cv::Size readJpegSize(std::istream& in) {
+    while (in) {
+        if (in.get() != 0xFF) {
+            return cv::Size();
+        }
+
+        int marker = in.get();
+        while (marker == 0xFF) {
+            marker = in.get();
+        }
+        if (marker == EOF) {
+            return cv::Size();
+        }
+
+        // Markers without a length field.
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8)) {
+            continue;
+        }
+
+        int length = readBigEndian16(in);
+        if (length < 2) {
+            return cv::Size();
+        }
+
+        // SOF0-SOF15 except DHT (C4), JPG (C8) and DAC (CC).
+        bool start_of_frame = marker >= 0xC0 && marker <= 0xCF &&
+                              marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+        if (start_of_frame) {
+            in.get();
+            int height = readBigEndian16(in);
+            int width = readBigEndian16(in);
+            if (width <= 0 || height <= 0) {
+                return cv::Size();
+            }
+            return cv::Size(width, height);
+        }
+
+        in.seekg(length - 2, std::ios::cur);
+    }
+    return cv::Size();
+}
+
+static cv::Size readPngSize(std::istream& in) {
+    // Signature is followed by the IHDR chunk: length, type, width, height.
+    unsigned char header[24];
+    in.seekg(0);
+    if (!in.read(reinterpret_cast<char*>(header), sizeof(header))) {
+        return cv::Size();
+    }
+    if (header[12] != 'I' || header[13] != 'H' || header[14] != 'D' || header[15] != 'R') {
+        return cv::Size();
+    }
+
+    auto read32 = [&](int offset) {
+        return (static_cast<unsigned>(header[offset]) << 24) | (static_cast<unsigned>(header[offset + 1]) << 16) |
+               (static_cast<unsigned>(header[offset + 2]) << 8) | static_cast<unsigned>(header[offset + 3]);
+    };
+
+    unsigned width = read32(16);
+    unsigned height = read32(20);
+    if (width == 0 || height == 0 || width > 0x7FFFFFFF || height > 0x7FFFFFFF) {
+        return cv::Size();
+    }
+    return cv::Size(static_cast<int>(width), static_cast<int>(height));
+}
+
+cv::Size ImageLoader::readImageSize(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return cv::Size();
+    }
+
+    unsigned char magic[2] = {0, 0};
+    in.read(reinterpret_cast<char*>(magic), 2);
+
+    if (magic[0] == 0xFF && magic[1] == 0xD8) {
+        return readJpegSize(in);
+    }
+    if (magic[0] == 0x89 && magic[1] == 'P') {
+        return readPngSize(in);
+    }
+
+    cv::Mat image = cv::imread(path, cv::IMREAD_GRAYSCALE);
+    return image.size();
+}
+
+int ImageLoader::reductionFactor(double scale) {
+    for (int factor : {8, 4, 2}) {
+        if (scale * factor <= 1.0) {
+            return factor;
+        }
+    }
+    return 1;
+}
+
+cv::Mat ImageLoader::loadProxy(const std::string& path, double scale, cv::Size& full_size) {
+    int flags = cv::IMREAD_GRAYSCALE;
+    switch (reductionFactor(scale)) {
+        case 8: flags = cv::IMREAD_REDUCED_GRAYSCALE_8; break;
+        case 4: flags = cv::IMREAD_REDUCED_GRAYSCALE_4; break;
+        case 2: flags = cv::IMREAD_REDUCED_GRAYSCALE_2; break;
+        default: break;
+    }
+
+    cv::Mat reduced = cv::imread(path, flags);
+    if (reduced.empty()) {
+        std::cerr << "Error: Could not load image: " << path << "\n";
+        return cv::Mat();
+    }
+
+    if ((full_size.width > full_size.height) != (reduced.cols > reduced.rows) &&
+        full_size.width != full_size.height) {
+        std::swap(full_size.width, full_size.height);
+    }
+
+    cv::Size proxy_size(static_cast<int>(std::round(full_size.width * scale)),
+                        static_cast<int>(std::round(full_size.height * scale)));
+    proxy_size.width = std::max(proxy_size.width, 1);
+    proxy_size.height = std::max(proxy_size.height, 1);
+
+    if (reduced.size() == proxy_size) {
+        return reduced;
+    }
+
+    cv::Mat proxy;
+    cv::resize(reduced, proxy, proxy_size, 0, 0, cv::INTER_AREA);
+    return proxy;
+}
@@ -0,0 +1,24 @@
+#ifndef IMAGE_LOADER_H
+#define IMAGE_LOADER_H
+
+#include <opencv2/core.hpp>
+#include <string>
+
+// Decoding helpers for registration proxies. JPEG proxies are decoded with
+// libjpeg DCT scaling (IMREAD_REDUCED_GRAYSCALE_*), so the full-resolution
+// colour image only has to be decoded for warping.
+class ImageLoader {
+public:
+    // Dimensions from the JPEG/PNG header without decoding pixels; other
+    // formats fall back to a grayscale decode. Empty on failure.
+    static cv::Size readImageSize(const std::string& path);
+
+    // Grayscale proxy of the image at `path` sized like a cv::resize of the
+    // full image by `scale`. `full_size` may have width and height swapped
+    // when the decoder applies EXIF orientation; it is corrected in place.
+    static cv::Mat loadProxy(const std::string& path, double scale, cv::Size& full_size);
+
+    static int reductionFactor(double scale);
+};
+
+#endif
@@ -0,0 +1,112 @@
+#include "pair_verifier.h"
+#include "../feature_detection/detector_factory.h"
+#include "../feature_matching/hamming_matcher.h"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <cmath>
+
+PairVerifier::PairVerifier()
+    : detector_(DetectorFactory::createDetector("orb")) {
+    detector_->setMaxFeatures(PanoramaConfig::QUICK_VERIFY_FEATURES);
+    detector_->setUniformSelection(true);
+}
+
+size_t PairVerifier::addImage(const cv::Mat& image) {
+    Thumbnail thumbnail;
+
+    if (!image.empty()) {
+        double pixels = static_cast<double>(image.cols) * image.rows;
+        double scale = std::min(1.0, std::sqrt(max_pixels_ / pixels));
+
+        cv::Mat small = image;
+        if (scale < 1.0) {
+            cv::resize(image, small, cv::Size(), scale, scale, cv::INTER_AREA);
+        }
+
+        DetectionResult features = detector_->detect(small);
+        thumbnail.descriptors = features.descriptors;
+        for (const auto& keypoint : features.keypoints) {
+            thumbnail.points.push_back(keypoint.pt);
+        }
+    }
+
+    thumbnails_.push_back(std::move(thumbnail));
+    return thumbnails_.size() - 1;
+}
+
+PairVerdict PairVerifier::verify(size_t i, size_t j) const {
+    PairVerdict verdict;
+    const Thumbnail& a = thumbnails_[i];
+    const Thumbnail& b = thumbnails_[j];
+    if (a.descriptors.empty() || b.descriptors.empty()) {
+        return verdict;
+    }
+
+    std::vector<cv::DMatch> matches;
+    HammingMatcher::matchWithRatioTest(a.descriptors, b.descriptors,
+                                       PanoramaConfig::QUICK_VERIFY_RATIO, matches);
+    verdict.matches = static_cast<int>(matches.size());
+    if (verdict.matches < min_inliers_) {
+        return verdict;
+    }
+
+    std::vector<cv::Point2f> src, dst;
+    src.reserve(matches.size());
+    dst.reserve(matches.size());
+    for (const auto& match : matches) {
+        src.push_back(a.points[match.queryIdx]);
+        dst.push_back(b.points[match.trainIdx]);
+    }
+
+    const int n = static_cast<int>(src.size());
+    const double threshold_sq = PanoramaConfig::QUICK_VERIFY_THRESHOLD * PanoramaConfig::QUICK_VERIFY_THRESHOLD;
+    cv::RNG rng(static_cast<uint64>(n) * 2654435761u + 1);
+
+    for (int iteration = 0; iteration < PanoramaConfig::QUICK_VERIFY_ITERATIONS; iteration++) {
+        int sample[4];
+        for (int k = 0; k < 4; k++) {
+            bool repeated;
+            do {
+                sample[k] = rng.uniform(0, n);
+                repeated = std::find(sample, sample + k, sample[k]) != sample + k;
+            } while (repeated);
+        }
+
+        cv::Point2f from[4], to[4];
+        for (int k = 0; k < 4; k++) {
+            from[k] = src[sample[k]];
+            to[k] = dst[sample[k]];
+        }
+
+        cv::Mat H = cv::getPerspectiveTransform(from, to);
+        if (H.empty() || std::abs(cv::determinant(H)) < PanoramaConfig::HOMOGRAPHY_EPSILON) {
+            continue;
+        }
+        cv::Matx33d h(H.ptr<double>());
+
+        int inliers = 0;
+        for (int m = 0; m < n && inliers < min_inliers_; m++) {
+            // Give up on the hypothesis once the remaining matches cannot
+            // lift it to the required count.
+            if (inliers + (n - m) < min_inliers_) {
+                break;
+            }
+            double x = src[m].x, y = src[m].y;
+            double w = h(2, 0) * x + h(2, 1) * y + h(2, 2);
+            if (std::abs(w) < 1e-12) continue;
+            double dx = (h(0, 0) * x + h(0, 1) * y + h(0, 2)) / w - dst[m].x;
+            double dy = (h(1, 0) * x + h(1, 1) * y + h(1, 2)) / w - dst[m].y;
+            if (dx * dx + dy * dy <= threshold_sq) {
+                inliers++;
+            }
+        }
+
+        verdict.inliers = std::max(verdict.inliers, inliers);
+        if (inliers >= min_inliers_) {
+            verdict.overlapping = true;
+            return verdict;
+        }
+    }
+
+    return verdict;
+}
@@ -0,0 +1,48 @@
+#ifndef PAIR_VERIFIER_H
+#define PAIR_VERIFIER_H
+
+#include <opencv2/core.hpp>
+#include <memory>
+#include <vector>
+#include "../config.h"
+#include "../feature_detection/feature_detector.h"
+
+struct PairVerdict {
+    bool overlapping = false;
+    int matches = 0;
+    int inliers = 0;
+};
+
+// Cheap overlap test run before full registration. Every image is reduced
+// to a thumbnail with a small ORB budget; a pair passes when a homography
+// between the thumbnails gathers enough inliers. Pairs with too few ratio
+// test matches are rejected without any sampling, and sampling stops at the
+// first hypothesis that reaches the inlier count. addImage() is not
+// thread-safe; verify() is.
+class PairVerifier {
+public:
+    PairVerifier();
+
+    // Returns the id of the image for verify().
+    size_t addImage(const cv::Mat& image);
+
+    PairVerdict verify(size_t i, size_t j) const;
+
+    size_t size() const { return thumbnails_.size(); }
+    void clear() { thumbnails_.clear(); }
+
+    void setMinInliers(int min_inliers) { min_inliers_ = min_inliers; }
+
+private:
+    struct Thumbnail {
+        std::vector<cv::Point2f> points;
+        cv::Mat descriptors;
+    };
+
+    std::unique_ptr<FeatureDetector> detector_;
+    std::vector<Thumbnail> thumbnails_;
+    double max_pixels_ = PanoramaConfig::QUICK_VERIFY_PIXELS;
+    int min_inliers_ = PanoramaConfig::QUICK_VERIFY_MIN_INLIERS;
+};
+
+#endif
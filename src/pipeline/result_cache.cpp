@@ -0,0 +1,321 @@
+#include "result_cache.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+    constexpr uint32_t FEATURES_MAGIC = 0x31464350;  // "PCF1"
+    constexpr uint32_t PAIR_MAGIC = 0x31504350;      // "PCP1"
+
+    constexpr uint64_t FNV_OFFSET = 1469598103934665603ULL;
+    constexpr uint64_t FNV_PRIME = 1099511628211ULL;
+
+    uint64_t hashBytes(const void* data, size_t size, uint64_t hash = FNV_OFFSET) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * FNV_PRIME;
+        }
+        return hash;
+    }
+
+    uint64_t hashMat(const cv::Mat& mat, uint64_t hash) {
+        int header[3] = {mat.rows, mat.cols, mat.type()};
+        hash = hashBytes(header, sizeof(header), hash);
+        const size_t row_bytes = mat.cols * mat.elemSize();
+        for (int y = 0; y < mat.rows; y++) {
+            hash = hashBytes(mat.ptr(y), row_bytes, hash);
+        }
+        return hash;
+    }
+
+    uint64_t hashFeatures(const DetectionResult& features, uint64_t hash) {
+        for (const auto& kp : features.keypoints) {
+            float values[5] = {kp.pt.x, kp.pt.y, kp.size, kp.angle, kp.response};
+            int levels[2] = {kp.octave, kp.class_id};
+            hash = hashBytes(values, sizeof(values), hash);
+            hash = hashBytes(levels, sizeof(levels), hash);
+        }
+        return hashMat(features.descriptors, hash);
+    }
+
+    std::string toHex(uint64_t value) {
+        std::ostringstream out;
+        out << std::hex;
+        out.width(16);
+        out.fill('0');
+        out << value;
+        return out.str();
+    }
+
+    template<typename T>
+    void put(std::string& out, const T& value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template<typename T>
+    bool get(std::istream& in, T& value) {
+        return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+    }
+
+    // Whether `count` records of `record_size` bytes are still left in the
+    // stream, so a corrupt count never reaches resize().
+    bool fits(std::istream& in, uint64_t count, size_t record_size) {
+        std::streampos pos = in.tellg();
+        if (pos < 0 || !in.seekg(0, std::ios::end)) {
+            return false;
+        }
+        std::streampos end = in.tellg();
+        if (!in.seekg(pos) || end < pos) {
+            return false;
+        }
+        return count <= static_cast<uint64_t>(end - pos) / record_size;
+    }
+
+    void putMatches(std::string& out, const std::vector<cv::DMatch>& matches) {
+        put(out, static_cast<uint32_t>(matches.size()));
+        for (const auto& match : matches) {
+            put(out, static_cast<int32_t>(match.queryIdx));
+            put(out, static_cast<int32_t>(match.trainIdx));
+            put(out, match.distance);
+        }
+    }
+
+    bool getMatches(std::istream& in, std::vector<cv::DMatch>& matches) {
+        uint32_t count = 0;
+        constexpr size_t MATCH_BYTES = 2 * sizeof(int32_t) + sizeof(float);
+        if (!get(in, count) || !fits(in, count, MATCH_BYTES)) {
+            return false;
+        }
+        matches.resize(count);
+        for (auto& match : matches) {
+            int32_t query = 0, train = 0;
+            float distance = 0.0f;
+            if (!get(in, query) || !get(in, train) || !get(in, distance)) {
+                return false;
+            }
+            match = cv::DMatch(query, train, distance);
+        }
+        return true;
+    }
+}
+
+ResultCache::ResultCache(const std::string& directory) : directory_(directory) {}
+
+std::string ResultCache::featureKey(const cv::Mat& image, const std::string& detector_type,
+                                    int max_features, bool uniform_selection) {
+    uint64_t hash = hashMat(image, FNV_OFFSET);
+    hash = hashBytes(detector_type.data(), detector_type.size(), hash);
+    hash = hashBytes(&max_features, sizeof(max_features), hash);
+    hash = hashBytes(&uniform_selection, sizeof(uniform_selection), hash);
+    return toHex(hash);
+}
+
+std::string ResultCache::pairKey(const DetectionResult& features1, const DetectionResult& features2,
+                                 const std::string& settings) {
+    uint64_t hash = hashFeatures(features1, FNV_OFFSET);
+    hash = hashFeatures(features2, hash);
+    hash = hashBytes(settings.data(), settings.size(), hash);
+    return toHex(hash);
+}
+
+bool ResultCache::loadFeatures(const std::string& key, DetectionResult& result) const {
+    if (!enabled()) {
+        return false;
+    }
+
+    std::ifstream in(entryPath("features", key), std::ios::binary);
+    if (!in) {
+        return false;
+    }
+
+    constexpr size_t KEYPOINT_BYTES = 5 * sizeof(float) + 2 * sizeof(int32_t);
+    DetectionResult loaded;
+    try {
+        uint32_t magic = 0, num_keypoints = 0;
+        uint32_t name_length = 0;
+        if (!get(in, magic) || magic != FEATURES_MAGIC || !get(in, name_length) ||
+            !fits(in, name_length, 1)) {
+            return false;
+        }
+
+        loaded.detector_name.resize(name_length);
+        if (!in.read(&loaded.detector_name[0], name_length) ||
+            !get(in, loaded.detection_time_ms) || !get(in, loaded.description_time_ms) ||
+            !get(in, num_keypoints) || !fits(in, num_keypoints, KEYPOINT_BYTES)) {
+            return false;
+        }
+
+        loaded.keypoints.resize(num_keypoints);
+        for (auto& kp : loaded.keypoints) {
+            int32_t octave = 0, class_id = 0;
+            if (!get(in, kp.pt.x) || !get(in, kp.pt.y) || !get(in, kp.size) ||
+                !get(in, kp.angle) || !get(in, kp.response) || !get(in, octave) || !get(in, class_id)) {
+                return false;
+            }
+            kp.octave = octave;
+            kp.class_id = class_id;
+        }
+
+        int32_t rows = 0, cols = 0, type = 0;
+        if (!get(in, rows) || !get(in, cols) || !get(in, type) || rows < 0 || cols < 0) {
+            return false;
+        }
+        if (rows > 0) {
+            if (cols == 0 || (type != CV_8U && type != CV_32F)) {
+                return false;
+            }
+            const size_t elem_size = type == CV_8U ? sizeof(uint8_t) : sizeof(float);
+            if (!fits(in, static_cast<uint64_t>(rows) * static_cast<uint64_t>(cols), elem_size)) {
+                return false;
+            }
+            loaded.descriptors.create(rows, cols, type);
+            if (!in.read(reinterpret_cast<char*>(loaded.descriptors.data),
+                         static_cast<std::streamsize>(loaded.descriptors.total() * loaded.descriptors.elemSize()))) {
+                return false;
+            }
+        }
+
+        if (loaded.descriptors.rows != static_cast<int>(loaded.keypoints.size())) {
+            return false;
+        }
+    } catch (const std::exception&) {
+        return false;
+    }
+
+    result = std::move(loaded);
+    return true;
+}
+
+void ResultCache::storeFeatures(const std::string& key, const DetectionResult& result) const {
+    if (!enabled()) {
+        return;
+    }
+
+    std::string data;
+    put(data, FEATURES_MAGIC);
+    put(data, static_cast<uint32_t>(result.detector_name.size()));
+    data.append(result.detector_name);
+    put(data, result.detection_time_ms);
+    put(data, result.description_time_ms);
+
+    put(data, static_cast<uint32_t>(result.keypoints.size()));
+    for (const auto& kp : result.keypoints) {
+        put(data, kp.pt.x);
+        put(data, kp.pt.y);
+        put(data, kp.size);
+        put(data, kp.angle);
+        put(data, kp.response);
+        put(data, static_cast<int32_t>(kp.octave));
+        put(data, static_cast<int32_t>(kp.class_id));
+    }
+
+    cv::Mat descriptors = result.descriptors.isContinuous() ? result.descriptors : result.descriptors.clone();
+    put(data, static_cast<int32_t>(descriptors.rows));
+    put(data, static_cast<int32_t>(descriptors.cols));
+    put(data, static_cast<int32_t>(descriptors.type()));
+    data.append(reinterpret_cast<const char*>(descriptors.data), descriptors.total() * descriptors.elemSize());
+
+    commit(entryPath("features", key), data);
+}
+
+bool ResultCache::loadPair(const std::string& key, PairRegistration& registration) const {
+    if (!enabled()) {
+        return false;
+    }
+
+    std::ifstream in(entryPath("pairs", key), std::ios::binary);
+    if (!in) {
+        return false;
+    }
+
+    uint32_t magic = 0;
+    if (!get(in, magic) || magic != PAIR_MAGIC) {
+        return false;
+    }
+
+    PairRegistration loaded;
+    try {
+        loaded.homography.create(3, 3, CV_64F);
+        for (int i = 0; i < 9; i++) {
+            if (!get(in, loaded.homography.at<double>(i / 3, i % 3))) {
+                return false;
+            }
+        }
+
+        uint32_t num_ratios = 0;
+        if (!getMatches(in, loaded.good_matches) || !get(in, num_ratios) ||
+            !fits(in, num_ratios, sizeof(double))) {
+            return false;
+        }
+        loaded.match_ratios.resize(num_ratios);
+        for (auto& ratio : loaded.match_ratios) {
+            if (!get(in, ratio)) {
+                return false;
+            }
+        }
+        if (!getMatches(in, loaded.inliers)) {
+            return false;
+        }
+    } catch (const std::exception&) {
+        return false;
+    }
+
+    registration = std::move(loaded);
+    return true;
+}
+
+void ResultCache::storePair(const std::string& key, const PairRegistration& registration) const {
+    if (!enabled() || registration.homography.empty()) {
+        return;
+    }
+
+    cv::Mat homography;
+    registration.homography.convertTo(homography, CV_64F);
+
+    std::string data;
+    put(data, PAIR_MAGIC);
+    for (int i = 0; i < 9; i++) {
+        put(data, homography.at<double>(i / 3, i % 3));
+    }
+    putMatches(data, registration.good_matches);
+    put(data, static_cast<uint32_t>(registration.match_ratios.size()));
+    for (double ratio : registration.match_ratios) {
+        put(data, ratio);
+    }
+    putMatches(data, registration.inliers);
+
+    commit(entryPath("pairs", key), data);
+}
+
+std::string ResultCache::entryPath(const std::string& kind, const std::string& key) const {
+    return directory_ + "/" + kind + "/" + key + ".bin";
+}
+
+bool ResultCache::commit(const std::string& path, const std::string& data) const {
+    std::error_code error;
+    fs::create_directories(fs::path(path).parent_path(), error);
+
+    std::random_device random;
+    std::string temp_path = path + ".tmp" + std::to_string(random());
+
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        if (!out || !out.write(data.data(), static_cast<std::streamsize>(data.size()))) {
+            std::cerr << "Warning: Could not write cache entry " << path << "\n";
+            fs::remove(temp_path, error);
+            return false;
+        }
+    }
+
+    fs::rename(temp_path, path, error);
+    if (error) {
+        std::cerr << "Warning: Could not write cache entry " << path << "\n";
+        fs::remove(temp_path, error);
+        return false;
+    }
+    return true;
+}
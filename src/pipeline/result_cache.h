@@ -0,0 +1,47 @@
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <opencv2/core.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../feature_detection/feature_detector.h"
+
+// Registration of an image pair as stored in the cache.
+struct PairRegistration {
+    cv::Mat homography;
+    std::vector<cv::DMatch> good_matches;
+    std::vector<double> match_ratios;
+    std::vector<cv::DMatch> inliers;
+};
+
+// Content-addressed on-disk cache. Detection results are keyed by a hash
+// of the image pixels and the detector settings, pair registrations by a
+// hash of both feature sets and the matching/estimation settings. Entries
+// are written to a temporary file and renamed, so concurrent runs sharing
+// a directory never see partial files. An empty directory disables it.
+class ResultCache {
+public:
+    explicit ResultCache(const std::string& directory);
+
+    bool enabled() const { return !directory_.empty(); }
+
+    static std::string featureKey(const cv::Mat& image, const std::string& detector_type,
+                                  int max_features, bool uniform_selection);
+    static std::string pairKey(const DetectionResult& features1, const DetectionResult& features2,
+                               const std::string& settings);
+
+    bool loadFeatures(const std::string& key, DetectionResult& result) const;
+    void storeFeatures(const std::string& key, const DetectionResult& result) const;
+
+    bool loadPair(const std::string& key, PairRegistration& registration) const;
+    void storePair(const std::string& key, const PairRegistration& registration) const;
+
+private:
+    std::string directory_;
+
+    std::string entryPath(const std::string& kind, const std::string& key) const;
+    bool commit(const std::string& path, const std::string& data) const;
+};
+
+#endif
@@ -0,0 +1,212 @@
+#include "stage_profiler.h"
+#include <opencv2/core.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+std::atomic<size_t> live_bytes{0};
+std::atomic<size_t> peak_live_bytes{0};
+std::atomic<bool> tracker_installed{false};
+
+void updatePeak(size_t value) {
+    size_t peak = peak_live_bytes.load(std::memory_order_relaxed);
+    while (value > peak && !peak_live_bytes.compare_exchange_weak(peak, value, std::memory_order_relaxed)) {
+    }
+}
+
+// Forwards to the previous default allocator and takes ownership of the
+// UMatData so that deallocation comes back through here.
+class TrackingAllocator : public cv::MatAllocator {
+public:
+    explicit TrackingAllocator(cv::MatAllocator* inner) : inner_(inner) {}
+
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                           cv::AccessFlag flags, cv::UMatUsageFlags usage) const override {
+        cv::UMatData* u = inner_->allocate(dims, sizes, type, data, step, flags, usage);
+        if (u) {
+            u->currAllocator = this;
+            if (!(u->flags & cv::UMatData::USER_ALLOCATED)) {
+                updatePeak(live_bytes.fetch_add(u->size, std::memory_order_relaxed) + u->size);
+            }
+        }
+        return u;
+    }
+
+    bool allocate(cv::UMatData* u, cv::AccessFlag flags, cv::UMatUsageFlags usage) const override {
+        return inner_->allocate(u, flags, usage);
+    }
+
+    void deallocate(cv::UMatData* u) const override {
+        if (u && !(u->flags & cv::UMatData::USER_ALLOCATED)) {
+            live_bytes.fetch_sub(u->size, std::memory_order_relaxed);
+        }
+        inner_->deallocate(u);
+    }
+
+private:
+    cv::MatAllocator* inner_;
+};
+
+std::string escapeJson(const std::string& text) {
+    std::ostringstream out;
+    for (char c : text) {
+        switch (c) {
+            case '"': out << "\\\""; break;
+            case '\\': out << "\\\\"; break;
+            case '\n': out << "\\n"; break;
+            case '\t': out << "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    out << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+                        << static_cast<int>(c) << std::dec;
+                } else {
+                    out << c;
+                }
+        }
+    }
+    return out.str();
+}
+
+std::mutex append_mutex;
+
+}
+
+void AllocationTracker::install() {
+    static std::once_flag once;
+    std::call_once(once, []() {
+        static TrackingAllocator tracker(cv::Mat::getDefaultAllocator());
+        cv::Mat::setDefaultAllocator(&tracker);
+        tracker_installed = true;
+    });
+}
+
+bool AllocationTracker::installed() {
+    return tracker_installed;
+}
+
+size_t AllocationTracker::currentBytes() {
+    return live_bytes.load(std::memory_order_relaxed);
+}
+
+size_t AllocationTracker::peakBytes() {
+    return peak_live_bytes.load(std::memory_order_relaxed);
+}
+
+size_t AllocationTracker::resetPeak() {
+    size_t current = live_bytes.load(std::memory_order_relaxed);
+    peak_live_bytes.store(current, std::memory_order_relaxed);
+    return current;
+}
+
+StageProfiler::Scope::Scope(StageProfiler* profiler, const char* stage)
+    : profiler_(profiler), stage_(stage) {
+    if (profiler_) {
+        base_bytes_ = AllocationTracker::resetPeak();
+        start_ = std::chrono::high_resolution_clock::now();
+    }
+}
+
+StageProfiler::Scope::~Scope() {
+    if (profiler_) {
+        auto end = std::chrono::high_resolution_clock::now();
+        size_t peak = AllocationTracker::peakBytes();
+        profiler_->record(stage_, std::chrono::duration<double, std::milli>(end - start_).count(),
+                          peak > base_bytes_ ? peak - base_bytes_ : 0);
+    }
+}
+
+StageProfiler::StageProfiler(const std::string& label)
+    : label_(label), start_(std::chrono::high_resolution_clock::now()) {
+    AllocationTracker::install();
+}
+
+void StageProfiler::record(const std::string& stage, double time_ms, size_t peak_bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = stages_.find(stage);
+    if (it == stages_.end()) {
+        stage_order_.push_back(stage);
+        it = stages_.emplace(stage, StageStats()).first;
+    }
+    it->second.time_ms += time_ms;
+    it->second.peak_bytes = std::max(it->second.peak_bytes, peak_bytes);
+    it->second.calls++;
+}
+
+void StageProfiler::setMetric(const std::string& name, double value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    metrics_[name] = value;
+}
+
+void StageProfiler::setSeries(const std::string& name, std::vector<double> values) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    series_[name] = std::move(values);
+}
+
+StageStats StageProfiler::stage(const std::string& name) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = stages_.find(name);
+    return it == stages_.end() ? StageStats() : it->second;
+}
+
+double StageProfiler::metric(const std::string& name, double fallback) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = metrics_.find(name);
+    return it == metrics_.end() ? fallback : it->second;
+}
+
+std::vector<double> StageProfiler::series(const std::string& name) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = series_.find(name);
+    return it == series_.end() ? std::vector<double>() : it->second;
+}
+
+double StageProfiler::elapsedMs() const {
+    auto now = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(now - start_).count();
+}
+
+std::string StageProfiler::toJson() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::ostringstream json;
+    json << std::fixed << std::setprecision(3);
+    json << "{\"label\":\"" << escapeJson(label_) << "\",\"elapsed_ms\":" << elapsedMs()
+         << ",\"stages\":{";
+    for (size_t i = 0; i < stage_order_.size(); i++) {
+        const StageStats& stats = stages_.at(stage_order_[i]);
+        json << (i ? "," : "") << "\"" << escapeJson(stage_order_[i]) << "\":{\"ms\":" << stats.time_ms
+             << ",\"peak_bytes\":" << stats.peak_bytes << ",\"calls\":" << stats.calls << "}";
+    }
+    json << "},\"metrics\":{";
+    bool first = true;
+    for (const auto& [name, value] : metrics_) {
+        json << (first ? "" : ",") << "\"" << escapeJson(name) << "\":";
+        if (std::isfinite(value)) {
+            json << value;
+        } else {
+            json << "null";
+        }
+        first = false;
+    }
+    json << "}}";
+    return json.str();
+}
+
+bool StageProfiler::appendJsonLine(const std::string& path) const {
+    std::string line = toJson();
+
+    // Concurrent batch jobs append to the same file.
+    std::lock_guard<std::mutex> lock(append_mutex);
+    std::ofstream file(path, std::ios::app);
+    if (!file) {
+        std::cerr << "Error: Could not open profile output " << path << "\n";
+        return false;
+    }
+    file << line << "\n";
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,81 @@
+#ifndef STAGE_PROFILER_H
+#define STAGE_PROFILER_H
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct StageStats {
+    double time_ms = 0.0;
+    // Largest growth of live cv::Mat memory over any one call of the stage.
+    size_t peak_bytes = 0;
+    int calls = 0;
+};
+
+// Process-wide accounting of cv::Mat heap memory. install() wraps OpenCV's
+// default allocator; Mats allocated before that are not counted.
+class AllocationTracker {
+public:
+    static void install();
+    static bool installed();
+
+    static size_t currentBytes();
+    static size_t peakBytes();
+
+    // Restarts the peak from the current level and returns that level.
+    static size_t resetPeak();
+};
+
+// Timings and allocation peaks of the named pipeline stages of one job,
+// plus scalar metrics (match counts, inliers, ...) and raw series such as
+// match distances. Stages called repeatedly accumulate. Peaks are measured
+// process-wide, so they include whatever runs concurrently.
+class StageProfiler {
+public:
+    // Times the enclosing block as one call of `stage`; a null profiler
+    // makes it a no-op. Scopes should not be nested.
+    class Scope {
+    public:
+        Scope(StageProfiler* profiler, const char* stage);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        StageProfiler* profiler_;
+        const char* stage_;
+        std::chrono::high_resolution_clock::time_point start_;
+        size_t base_bytes_ = 0;
+    };
+
+    explicit StageProfiler(const std::string& label = "");
+
+    void record(const std::string& stage, double time_ms, size_t peak_bytes = 0);
+    void setMetric(const std::string& name, double value);
+    void setSeries(const std::string& name, std::vector<double> values);
+
+    StageStats stage(const std::string& name) const;
+    double metric(const std::string& name, double fallback = 0.0) const;
+    std::vector<double> series(const std::string& name) const;
+    double elapsedMs() const;
+
+    // One line of JSON with the label, elapsed time, stages in first-seen
+    // order and metrics. Series are not included.
+    std::string toJson() const;
+    bool appendJsonLine(const std::string& path) const;
+
+private:
+    std::string label_;
+    std::chrono::high_resolution_clock::time_point start_;
+
+    mutable std::mutex mutex_;
+    std::vector<std::string> stage_order_;
+    std::map<std::string, StageStats> stages_;
+    std::map<std::string, double> metrics_;
+    std::map<std::string, std::vector<double>> series_;
+};
+
+#endif
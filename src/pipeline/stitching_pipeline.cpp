@@ -2,18 +2,36 @@
 #include "../config.h"
 #include "../feature_detection/feature_detector.h"
 #include "../feature_detection/detector_factory.h"
+#include "../feature_detection/akaze_detector.h"
 #include "../feature_matching/matcher.h"
 #include "../homography/homography_estimator.h"
 #include "../stitching/image_warper.h"
 #include "../stitching/blender.h"
 #include "../stitching/blender_factory.h"
+#include "../stitching/gain_compensator.h"
 #include "../experiments/visualization.h"
+#include "../stitching/tiled_canvas.h"
+#include "../stitching/tile_pyramid_writer.h"
+#include "feature_cache.h"
+#include "bounded_queue.h"
+#include "image_loader.h"
+#include "pair_verifier.h"
+#include "result_cache.h"
+#include "stage_profiler.h"
 #include <opencv2/opencv.hpp>
 #include <opencv2/highgui.hpp>
+#include <opencv2/videoio.hpp>
+#include <opencv2/core/ocl.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <iostream>
+#include <iterator>
 #include <memory>
+#include <sstream>
+#include <thread>
 #include <chrono>
-#include <filesystem>
+#include <stdexcept>
 
 int StitchingPipeline::calculateAdaptiveFeatures(int image_pixels, int max_features) {
     int base_pixels = PanoramaConfig::REFERENCE_IMAGE_HEIGHT * PanoramaConfig::REFERENCE_IMAGE_WIDTH;
@@ -38,16 +56,43 @@ cv::Mat StitchingPipeline::performStitching(
     int max_features,
     bool visualize
 ) {
-    cv::Mat img1 = cv::imread(img1_path);
-    cv::Mat img2 = cv::imread(img2_path);
+    StitchingOptions options;
+    options.detector_type = detector_type;
+    options.blend_mode = blend_mode;
+    options.ransac_threshold = ransac_threshold;
+    options.max_features = max_features;
+    options.visualize = visualize;
+
+    return performStitching(img1_path, img2_path, options);
+}
+
+cv::Mat StitchingPipeline::performStitching(
+    const std::string& img1_path,
+    const std::string& img2_path,
+    const StitchingOptions& options
+) {
+    if (options.coarse_to_fine) {
+        cv::Size size1 = ImageLoader::readImageSize(img1_path);
+        cv::Size size2 = ImageLoader::readImageSize(img2_path);
+        if (!size1.empty() && !size2.empty() &&
+            (proxyScale(size1, options) < 1.0 || proxyScale(size2, options) < 1.0)) {
+            return stitchFromProxyFiles(img1_path, size1, img2_path, size2, options);
+        }
+    }
+
+    cv::Mat img1, img2;
+    {
+        StageProfiler::Scope timer(options.profiler, "decode");
+        img1 = cv::imread(img1_path);
+        img2 = cv::imread(img2_path);
+    }
 
     if (img1.empty() || img2.empty()) {
         std::cerr << "Error: Could not load images: " << img1_path << " or " << img2_path << "\n";
         return cv::Mat();
     }
 
-    return performStitchingDirect(img1, img2, detector_type, blend_mode,
-                                 ransac_threshold, max_features, visualize, PanoramaConfig::MAX_PANORAMA_DIMENSION);
+    return performStitchingDirect(img1, img2, options);
 }
 
 cv::Mat StitchingPipeline::performStitchingDirect(
@@ -59,6 +104,22 @@ cv::Mat StitchingPipeline::performStitchingDirect(
     int max_features,
     bool visualize,
     int max_panorama_dimension
+) {
+    StitchingOptions options;
+    options.detector_type = detector_type;
+    options.blend_mode = blend_mode;
+    options.ransac_threshold = ransac_threshold;
+    options.max_features = max_features;
+    options.visualize = visualize;
+    options.max_panorama_dimension = max_panorama_dimension;
+
+    return performStitchingDirect(img1, img2, options);
+}
+
+cv::Mat StitchingPipeline::performStitchingDirect(
+    const cv::Mat& img1,
+    const cv::Mat& img2,
+    const StitchingOptions& requested_options
 ) {
     auto start_time = std::chrono::high_resolution_clock::now();
 
@@ -67,26 +128,11 @@ cv::Mat StitchingPipeline::performStitchingDirect(
         return cv::Mat();
     }
 
-    if (img1.type() != CV_8UC3 || img2.type() != CV_8UC3) {
-        std::cerr << "Error: Input images must be 8-bit 3-channel (BGR)\n";
-        return cv::Mat();
-    }
-
-    if (img1.cols < PanoramaConfig::MIN_IMAGE_DIMENSION || img1.rows < PanoramaConfig::MIN_IMAGE_DIMENSION ||
-        img2.cols < PanoramaConfig::MIN_IMAGE_DIMENSION || img2.rows < PanoramaConfig::MIN_IMAGE_DIMENSION) {
-        std::cerr << "Error: Images too small (minimum " << PanoramaConfig::MIN_IMAGE_DIMENSION << "x" << PanoramaConfig::MIN_IMAGE_DIMENSION << " pixels)\n";
+    if (!validateImages({img1, img2})) {
         return cv::Mat();
     }
 
-    if (ransac_threshold <= 0 || ransac_threshold > PanoramaConfig::MAX_RANSAC_THRESHOLD) {
-        std::cerr << "Warning: Invalid RANSAC threshold, using default " << PanoramaConfig::DEFAULT_RANSAC_THRESHOLD << "\n";
-        ransac_threshold = PanoramaConfig::DEFAULT_RANSAC_THRESHOLD;
-    }
-
-    if (max_features < PanoramaConfig::MIN_FEATURES || max_features > PanoramaConfig::MAX_FEATURES) {
-        std::cerr << "Warning: Invalid max_features, using default " << PanoramaConfig::DEFAULT_MAX_FEATURES << "\n";
-        max_features = PanoramaConfig::DEFAULT_MAX_FEATURES;
-    }
+    StitchingOptions options = sanitizeOptions(requested_options);
 
     std::cout << "Loaded images: " << img1.size() << " and " << img2.size() << "\n";
 
@@ -101,183 +147,236 @@ cv::Mat StitchingPipeline::performStitchingDirect(
         std::cerr << "Warning: Large image size detected. Processing may be slow.\n";
     }
 
-    int img1_pixels = img1.rows * img1.cols;
-    int img2_pixels = img2.rows * img2.cols;
-
-    int adaptive_features1 = calculateAdaptiveFeatures(img1_pixels, max_features);
-    int adaptive_features2 = calculateAdaptiveFeatures(img2_pixels, max_features);
+    std::vector<double> scales;
+    std::vector<cv::Mat> proxies = makeProxies({img1, img2}, options, scales);
+    bool use_proxies = scales[0] < 1.0 || scales[1] < 1.0;
+    if (use_proxies) {
+        std::cout << "Registering on proxies: " << proxies[0].size() << " and " << proxies[1].size() << "\n";
+    }
 
-    std::unique_ptr<FeatureDetector> detector1;
-    std::unique_ptr<FeatureDetector> detector2;
+    std::unique_ptr<PairVerifier> verifier = makeVerifier(proxies, options);
+    if (verifier && !quickVerify(*verifier, 0, 1, options)) {
+        std::cerr << "Error: Images do not overlap\n";
+        return cv::Mat();
+    }
 
+    std::vector<DetectionResult> results;
     try {
-        detector1 = DetectorFactory::createDetector(detector_type);
-        detector2 = DetectorFactory::createDetector(detector_type);
+        results = detectAll(proxies, options);
     } catch (const std::exception& e) {
         std::cerr << "Error creating detector: " << e.what() << "\n";
         return cv::Mat();
     }
 
-    detector1->setMaxFeatures(adaptive_features1);
-    detector2->setMaxFeatures(adaptive_features2);
+    cv::Mat panorama;
+    if (use_proxies) {
+        cv::Mat homography = registerCoarseToFine(img1, results[0], scales[0],
+                                                  img2, results[1], scales[1], options);
+        if (homography.empty()) {
+            return cv::Mat();
+        }
+        panorama = composePair(img1, img2, homography, options, nullptr);
+    } else {
+        panorama = stitchWithFeatures(img1, results[0], img2, results[1], options, nullptr);
+    }
+    if (panorama.empty()) {
+        return panorama;
+    }
 
-    std::cout << "Detecting features...\n";
-    auto result1 = detector1->detect(img1);
-    auto result2 = detector2->detect(img2);
+    auto end_time = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+    std::cout << "Total time: " << duration.count() << " ms\n";
 
-    std::cout << "Detected " << result1.getKeypointCount() << " keypoints (img1) and "
-              << result2.getKeypointCount() << " keypoints (img2)\n";
+    return panorama;
+}
 
-    {
-        namespace fs = std::filesystem;
-        std::string viz_dir = "results/visualizations";
-        if (!fs::exists(viz_dir)) {
-            fs::create_directories(viz_dir);
-        }
+cv::Mat StitchingPipeline::stitchFromProxyFiles(
+    const std::string& img1_path,
+    cv::Size size1,
+    const std::string& img2_path,
+    cv::Size size2,
+    const StitchingOptions& requested_options
+) {
+    auto start_time = std::chrono::high_resolution_clock::now();
 
-        static int viz_counter = 0;
-        viz_counter++;
-        std::string base_name = "stitch_" + std::to_string(viz_counter) + "_" + detector_type;
+    StitchingOptions options = sanitizeOptions(requested_options);
 
-        cv::Mat kp_vis1, kp_vis2;
-        cv::drawKeypoints(img1, result1.keypoints, kp_vis1, cv::Scalar(0, 255, 0),
-                         cv::DrawMatchesFlags::DRAW_RICH_KEYPOINTS);
-        cv::drawKeypoints(img2, result2.keypoints, kp_vis2, cv::Scalar(0, 255, 0),
-                         cv::DrawMatchesFlags::DRAW_RICH_KEYPOINTS);
+    size_t total_pixels = static_cast<size_t>(size1.area()) + static_cast<size_t>(size2.area());
+    if (total_pixels > PanoramaConfig::MAX_IMAGE_PIXELS) {
+        std::cerr << "Error: Combined image size exceeds maximum allowed ("
+                  << PanoramaConfig::MAX_IMAGE_PIXELS / 1000000 << " megapixels)\n";
+        return cv::Mat();
+    }
 
-        std::string kp1_path = viz_dir + "/" + base_name + "_keypoints1.jpg";
-        std::string kp2_path = viz_dir + "/" + base_name + "_keypoints2.jpg";
+    double scale1 = proxyScale(size1, options);
+    double scale2 = proxyScale(size2, options);
 
-        cv::imwrite(kp1_path, kp_vis1);
-        cv::imwrite(kp2_path, kp_vis2);
-        std::cout << "Saved keypoint visualizations to " << viz_dir << "/\n";
+    std::vector<cv::Mat> proxies;
+    {
+        StageProfiler::Scope timer(options.profiler, "decode");
+        proxies.push_back(ImageLoader::loadProxy(img1_path, scale1, size1));
+        proxies.push_back(ImageLoader::loadProxy(img2_path, scale2, size2));
     }
-
-    std::cout << "Matching features...\n";
-    FeatureMatcher matcher;
-    if (detector_type == "sift") {
-        matcher.setMatcherType("BruteForce-L2");
-    } else {
-        matcher.setMatcherType("BruteForce-Hamming");
+    if (proxies[0].empty() || proxies[1].empty()) {
+        return cv::Mat();
     }
-    auto match_result = matcher.matchFeatures(
-        result1.descriptors, result2.descriptors,
-        result1.keypoints, result2.keypoints,
-        0.75
-    );
 
-    std::cout << "Found " << match_result.num_good_matches << " good matches\n";
+    std::cout << "Registering on reduced-resolution proxies: " << proxies[0].size()
+              << " and " << proxies[1].size() << "\n";
 
-    {
-        namespace fs = std::filesystem;
-        std::string viz_dir = "results/visualizations";
-        if (!fs::exists(viz_dir)) {
-            fs::create_directories(viz_dir);
-        }
+    std::vector<DetectionResult> results;
+    try {
+        results = detectAll(proxies, options);
+    } catch (const std::exception& e) {
+        std::cerr << "Error creating detector: " << e.what() << "\n";
+        return cv::Mat();
+    }
+    proxies.clear();
 
-            static int match_counter = 0;
-        match_counter++;
-        std::string base_name = "stitch_" + std::to_string(match_counter) + "_" + detector_type;
+    // Full-resolution colour is only needed for refinement and warping.
+    cv::Mat img1, img2;
+    {
+        StageProfiler::Scope timer(options.profiler, "decode");
+        img1 = cv::imread(img1_path);
+        img2 = cv::imread(img2_path);
+    }
 
-        cv::Mat match_vis_before;
-        cv::drawMatches(img1, result1.keypoints, img2, result2.keypoints,
-                       match_result.good_matches, match_vis_before,
-                       cv::Scalar(0, 255, 0), cv::Scalar(255, 0, 0),
-                       std::vector<char>(),
-                       cv::DrawMatchesFlags::NOT_DRAW_SINGLE_POINTS);
+    if (img1.empty() || img2.empty()) {
+        std::cerr << "Error: Could not load images: " << img1_path << " or " << img2_path << "\n";
+        return cv::Mat();
+    }
 
-        std::string matches_before_path = viz_dir + "/" + base_name + "_matches_before_ransac.jpg";
-        cv::imwrite(matches_before_path, match_vis_before);
-        std::cout << "Saved matches visualization (before RANSAC)\n";
+    if (img1.size() != size1 || img2.size() != size2) {
+        std::cerr << "Error: Decoded image size does not match the image header\n";
+        return cv::Mat();
     }
 
-    std::cout << "Estimating homography...\n";
-    HomographyEstimator h_estimator;
-    h_estimator.setRANSACThreshold(ransac_threshold);
+    if (!validateImages({img1, img2})) {
+        return cv::Mat();
+    }
 
-    std::vector<cv::DMatch> inlier_matches;
-    cv::Mat homography = h_estimator.estimateHomography(
-        result1.keypoints, result2.keypoints,
-        match_result.good_matches, inlier_matches
-    );
+    cv::Mat homography = registerCoarseToFine(img1, results[0], scale1,
+                                              img2, results[1], scale2, options);
+    if (homography.empty()) {
+        return cv::Mat();
+    }
 
-    auto ransac_result = h_estimator.getLastResult();
+    cv::Mat panorama = composePair(img1, img2, homography, options, nullptr);
+    if (panorama.empty()) {
+        return panorama;
+    }
 
-    if (!inlier_matches.empty()) {
-        namespace fs = std::filesystem;
-        std::string viz_dir = "results/visualizations";
-        if (!fs::exists(viz_dir)) {
-            fs::create_directories(viz_dir);
-        }
+    auto end_time = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+    std::cout << "Total time: " << duration.count() << " ms\n";
 
-            static int inlier_counter = 0;
-        inlier_counter++;
-        std::string base_name = "stitch_" + std::to_string(inlier_counter) + "_" + detector_type;
+    return panorama;
+}
 
-        cv::Mat match_vis_after;
-        cv::drawMatches(img1, result1.keypoints, img2, result2.keypoints,
-                       inlier_matches, match_vis_after,
-                       cv::Scalar(0, 255, 0), cv::Scalar(255, 0, 0),
-                       std::vector<char>(),
-                       cv::DrawMatchesFlags::NOT_DRAW_SINGLE_POINTS);
+cv::Mat StitchingPipeline::stitchWithFeatures(
+    const cv::Mat& img1,
+    const DetectionResult& result1,
+    const cv::Mat& img2,
+    const DetectionResult& result2,
+    const StitchingOptions& options,
+    PanoramaPlacement* placement,
+    const MatchingPrior* prior
+) {
+    DiagnosticsSink* diagnostics = options.diagnostics;
+    int stitch_id = 0;
 
-        std::string matches_after_path = viz_dir + "/" + base_name + "_matches_after_ransac.jpg";
-        cv::imwrite(matches_after_path, match_vis_after);
-        std::cout << "Saved inlier matches visualization (after RANSAC)\n";
+    if (diagnostics && diagnostics->enabled(DiagnosticsLevel::SUMMARY)) {
+        stitch_id = diagnostics->beginStitch();
+        diagnostics->recordKeypoints(stitch_id, options.detector_type,
+                                     img1, result1.keypoints, img2, result2.keypoints);
     }
 
-    if (homography.empty()) {
-        std::cerr << "Failed to compute homography\n";
-        return cv::Mat();
+    // Guided matches depend on the prior, so only global matching is cached.
+    ResultCache cache(prior ? std::string() : pairCacheDir(options));
+    std::string cache_key;
+    PairRegistration cached;
+    bool from_cache = false;
+    if (cache.enabled()) {
+        cache_key = ResultCache::pairKey(result1, result2, registrationSettings(options));
+        from_cache = cache.loadPair(cache_key, cached);
     }
 
-    for (int i = 0; i < homography.rows; i++) {
-        for (int j = 0; j < homography.cols; j++) {
-            double val = homography.at<double>(i, j);
-            if (std::isnan(val) || std::isinf(val)) {
-                std::cerr << "Error: Invalid homography matrix (contains NaN or Inf)\n";
-                return cv::Mat();
-            }
+    MatchingResult match_result;
+    std::vector<cv::DMatch> inlier_matches;
+    cv::Mat homography;
+    int num_inliers = 0;
+
+    if (from_cache) {
+        std::cout << "Using cached registration (" << cached.inliers.size() << " inliers)\n";
+        match_result.good_matches = std::move(cached.good_matches);
+        match_result.match_ratios = std::move(cached.match_ratios);
+        match_result.num_good_matches = static_cast<int>(match_result.good_matches.size());
+        for (const auto& match : match_result.good_matches) {
+            match_result.match_distances.push_back(match.distance);
         }
-    }
+        homography = cached.homography;
+        inlier_matches = std::move(cached.inliers);
+        num_inliers = static_cast<int>(inlier_matches.size());
+    } else {
+        std::cout << "Matching features...\n";
+        match_result = matchPair(result1, result2, options, prior);
 
-    double det = cv::determinant(homography);
-    if (std::abs(det) < PanoramaConfig::MIN_HOMOGRAPHY_DETERMINANT || std::abs(det) > PanoramaConfig::MAX_HOMOGRAPHY_DETERMINANT) {
-        std::cerr << "Error: Homography determinant out of reasonable range: " << det << std::endl;
-        std::cerr << "This indicates poor feature matches or incompatible images\n";
-        std::cerr << "Try: 1) Using ORB detector instead of AKAZE\n";
-        std::cerr << "     2) Ensuring images have sufficient overlap (30-40%)\n";
-        std::cerr << "     3) Increasing max_features for better matching\n";
-        return cv::Mat();
+        std::cout << "Found " << match_result.num_good_matches << " good matches\n";
+
+        if (diagnostics && diagnostics->enabled(DiagnosticsLevel::FULL)) {
+            diagnostics->recordMatches(stitch_id, options.detector_type, "before_ransac",
+                                       img1, result1.keypoints, img2, result2.keypoints,
+                                       match_result.good_matches);
+        }
+
+        std::cout << "Estimating homography...\n";
+        HomographyEstimator h_estimator;
+        h_estimator.setRANSACThreshold(options.ransac_threshold);
+        h_estimator.setBackend(HomographyEstimator::stringToBackend(options.estimator_backend));
+
+        {
+            StageProfiler::Scope timer(options.profiler, "ransac");
+            homography = h_estimator.estimateHomography(
+                result1.keypoints, result2.keypoints,
+                match_result.good_matches, match_result.match_ratios, inlier_matches
+            );
+        }
+        num_inliers = h_estimator.getLastResult().num_inliers;
+
+        if (options.profiler) {
+            RANSACResult ransac = h_estimator.getLastResult();
+            options.profiler->setMetric("initial_matches", match_result.num_initial_matches);
+            options.profiler->setMetric("good_matches", match_result.num_good_matches);
+            options.profiler->setMetric("inlier_ratio", ransac.inlier_ratio);
+            options.profiler->setMetric("reprojection_error", ransac.reprojection_error);
+            options.profiler->setMetric("ransac_iterations", ransac.num_iterations);
+            options.profiler->setSeries("match_distances", match_result.match_distances);
+        }
     }
 
-    cv::Mat H_normalized = homography.clone();
-    double h22 = H_normalized.at<double>(2, 2);
-    if (std::abs(h22) < 1e-10) {
-        std::cerr << "Error: Homography matrix is singular (H[2,2] = " << h22 << ")\n";
-        return cv::Mat();
+    if (options.profiler) {
+        options.profiler->setMetric("keypoints1", static_cast<double>(result1.keypoints.size()));
+        options.profiler->setMetric("keypoints2", static_cast<double>(result2.keypoints.size()));
+        options.profiler->setMetric("inliers", num_inliers);
     }
-    H_normalized /= h22;
 
-    double scale_x = std::sqrt(H_normalized.at<double>(0,0) * H_normalized.at<double>(0,0) +
-                               H_normalized.at<double>(1,0) * H_normalized.at<double>(1,0));
-    double scale_y = std::sqrt(H_normalized.at<double>(0,1) * H_normalized.at<double>(0,1) +
-                               H_normalized.at<double>(1,1) * H_normalized.at<double>(1,1));
+    if (diagnostics && diagnostics->enabled(DiagnosticsLevel::SUMMARY)) {
+        diagnostics->recordMatches(stitch_id, options.detector_type, "after_ransac",
+                                   img1, result1.keypoints, img2, result2.keypoints,
+                                   inlier_matches);
+    }
 
-    if (scale_x < PanoramaConfig::MIN_HOMOGRAPHY_SCALE || scale_x > PanoramaConfig::MAX_HOMOGRAPHY_SCALE ||
-        scale_y < PanoramaConfig::MIN_HOMOGRAPHY_SCALE || scale_y > PanoramaConfig::MAX_HOMOGRAPHY_SCALE) {
-        std::cerr << "Error: Homography implies extreme scaling (x=" << scale_x << ", y=" << scale_y << ")\n";
-        std::cerr << "Images may not be from the same scene or have insufficient overlap\n";
+    if (!validateHomography(homography, num_inliers)) {
         return cv::Mat();
     }
 
-    if (ransac_result.num_inliers < PanoramaConfig::MIN_INLIERS_REQUIRED) {
-        std::cerr << "Error: Too few inliers (" << ransac_result.num_inliers << ") for reliable stitching\n";
-        std::cerr << "Minimum " << PanoramaConfig::MIN_INLIERS_REQUIRED << " inliers required for stable homography\n";
-        return cv::Mat();
+    if (cache.enabled() && !from_cache) {
+        cache.storePair(cache_key, {homography, match_result.good_matches,
+                                    match_result.match_ratios, inlier_matches});
     }
 
-    if (visualize) {
+    if (options.visualize) {
+        FeatureMatcher matcher;
         cv::Mat match_img = matcher.visualizeMatches(
             img1, img2, result1.keypoints, result2.keypoints, inlier_matches
         );
@@ -300,6 +399,18 @@ cv::Mat StitchingPipeline::performStitchingDirect(
         }
     }
 
+    return composePair(img1, img2, homography, options, placement);
+}
+
+cv::Mat StitchingPipeline::composePair(
+    const cv::Mat& img1,
+    const cv::Mat& img2,
+    const cv::Mat& homography,
+    const StitchingOptions& options,
+    PanoramaPlacement* placement,
+    Blender* blender,
+    BufferPool* pool
+) {
     std::cout << "Warping images...\n";
     ImageWarper warper;
 
@@ -330,6 +441,10 @@ cv::Mat StitchingPipeline::performStitchingDirect(
         max_y = std::max(max_y, pt.y);
     }
 
+    // Whole-pixel offset so that img1 is placed by a plain copy.
+    min_x = std::floor(min_x);
+    min_y = std::floor(min_y);
+
     cv::Mat translation = (cv::Mat_<double>(3, 3) <<
         1, 0, -min_x,
         0, 1, -min_y,
@@ -345,6 +460,7 @@ cv::Mat StitchingPipeline::performStitchingDirect(
         return cv::Mat();
     }
 
+    int max_panorama_dimension = options.max_panorama_dimension;
     if (panorama_size.width > max_panorama_dimension || panorama_size.height > max_panorama_dimension) {
         std::cerr << "Error: Panorama size would be " << panorama_size.width
                   << "x" << panorama_size.height << " pixels (max: " << max_panorama_dimension << ")\n";
@@ -368,43 +484,74 @@ cv::Mat StitchingPipeline::performStitchingDirect(
         return cv::Mat();
     }
 
-    cv::Mat panorama = cv::Mat::zeros(panorama_size, img1.type());
-    cv::Mat mask1 = cv::Mat::zeros(panorama_size, CV_8UC1);
-    cv::Mat mask2 = cv::Mat::zeros(panorama_size, CV_8UC1);
-
-    cv::Mat warped1;
-    cv::warpPerspective(img1, warped1, translation, panorama_size);
-    cv::warpPerspective(cv::Mat::ones(img1.size(), CV_8UC1) * 255,
-                       mask1, translation, panorama_size);
+    cv::Mat transform2 = translation * H_inv;
+    std::vector<double> gains = compensationGains({img1, img2}, {translation, transform2},
+                                                  panorama_size, options);
 
-    cv::Mat warped2;
-    cv::Mat warped_mask2;
-    cv::warpPerspective(img2, warped2, translation * H_inv, panorama_size);
-    cv::warpPerspective(cv::Mat::ones(img2.size(), CV_8UC1) * 255,
-                       warped_mask2, translation * H_inv, panorama_size);
+    cv::Mat panorama, panorama_mask;
+    WarpedImage warped2;
+    {
+        StageProfiler::Scope timer(options.profiler, "warp");
+        warper.setGain(gains[0]);
+        ImageWarper::placeOnCanvas(warper.warpToFootprint(img1, translation, panorama_size),
+                                   panorama_size, panorama, panorama_mask, pool);
+        warper.setGain(gains[1]);
+        warped2 = warper.warpToFootprint(img2, transform2, panorama_size);
+    }
 
     std::cout << "Blending images...\n";
 
-    std::unique_ptr<Blender> blender;
-    try {
-        blender = BlenderFactory::createBlender(blend_mode);
-    } catch (const std::exception& e) {
-        std::cerr << "Error creating blender: " << e.what() << "\n";
-        std::cerr << "Falling back to feathering blend mode\n";
-        blender = BlenderFactory::createBlender(BlendMode::FEATHERING);
+    std::unique_ptr<Blender> owned_blender;
+    if (!blender) {
+        owned_blender = createBlender(options);
+        blender = owned_blender.get();
+    }
+
+    {
+        StageProfiler::Scope timer(options.profiler, "blend");
+        if (!blendIntoCanvas(*blender, warped2, panorama, panorama_mask)) {
+            std::cerr << "Error: Blending failed\n";
+            return cv::Mat();
+        }
     }
 
-    panorama = blender->blend(warped1, warped2, mask1, warped_mask2);
+    if (placement) {
+        placement->transform1 = translation.clone();
+        placement->transform2 = transform2;
+    }
 
     std::cout << "Panorama created successfully!\n";
 
-    auto end_time = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
-    std::cout << "Total time: " << duration.count() << " ms\n";
-
     return panorama;
 }
 
+bool StitchingPipeline::blendIntoCanvas(
+    Blender& blender,
+    const WarpedImage& warped,
+    cv::Mat& canvas,
+    cv::Mat& coverage
+) {
+    if (warped.empty()) {
+        return true;
+    }
+
+    cv::Mat existing = canvas(warped.roi);
+    cv::Mat existing_mask = coverage(warped.roi);
+    if (cv::countNonZero(existing_mask) == 0) {
+        warped.image.copyTo(existing);
+        warped.mask.copyTo(existing_mask);
+        return true;
+    }
+
+    cv::Mat blended = blender.blend(existing, warped.image, existing_mask, warped.mask);
+    if (blended.empty()) {
+        return false;
+    }
+    blended.copyTo(existing);
+    cv::bitwise_or(existing_mask, warped.mask, existing_mask);
+    return true;
+}
+
 cv::Mat StitchingPipeline::performSequentialStitching(
     const std::vector<cv::Mat>& images,
     const std::string& detector_type,
@@ -412,6 +559,20 @@ cv::Mat StitchingPipeline::performSequentialStitching(
     double ransac_threshold,
     int max_features,
     bool visualize
+) {
+    StitchingOptions options;
+    options.detector_type = detector_type;
+    options.blend_mode = blend_mode;
+    options.ransac_threshold = ransac_threshold;
+    options.max_features = max_features;
+    options.visualize = visualize;
+
+    return performSequentialStitching(images, options);
+}
+
+cv::Mat StitchingPipeline::performSequentialStitching(
+    const std::vector<cv::Mat>& images,
+    const StitchingOptions& requested_options
 ) {
     std::cout << "\n=== Using sequential stitching ===\n";
 
@@ -424,42 +585,98 @@ cv::Mat StitchingPipeline::performSequentialStitching(
         return images[0].clone();
     }
 
+    if (!validateImages(images)) {
+        return cv::Mat();
+    }
+
+    StitchingOptions options = sanitizeOptions(requested_options);
+
+    if (options.projection != "plane") {
+        std::vector<cv::Mat> projected = projectInputs(images, options);
+        if (projected.empty()) {
+            return cv::Mat();
+        }
+        options.projection = "plane";
+        return performSequentialStitching(projected, options);
+    }
+
+    std::vector<DetectionResult> all_features;
+    try {
+        all_features = detectAll(images, options);
+    } catch (const std::exception& e) {
+        std::cerr << "Error creating detector: " << e.what() << "\n";
+        return cv::Mat();
+    }
+
     size_t middle_idx = images.size() / 2;
     std::cout << "Starting from image " << (middle_idx + 1) << " as reference\n";
 
+    // Neighbours are checked against each other; the growing panorama
+    // would need a new thumbnail after every step.
+    std::unique_ptr<PairVerifier> verifier = makeVerifier(images, options);
+
     cv::Mat panorama = images[middle_idx].clone();
 
-    for (int i = middle_idx - 1; i >= 0; i--) {
+    FeatureCache cache;
+    const DetectionResult& reference_features = all_features[middle_idx];
+    cache.addImage(static_cast<int>(middle_idx), reference_features,
+                   cv::Mat::eye(3, 3, CV_64F), images[middle_idx].size());
+
+    for (int i = static_cast<int>(middle_idx) - 1; i >= 0; i--) {
         std::cout << "\n=== Stitching image " << (i + 1) << " (left side) ===\n";
 
-        cv::Mat result = performStitchingDirect(
-            images[i], panorama,
-            detector_type, blend_mode,
-            ransac_threshold, max_features,
-            visualize, PanoramaConfig::MAX_PANORAMA_DIMENSION
-        );
+        const DetectionResult& features = all_features[i];
+        PanoramaPlacement placement;
+
+        MatchingPrior prior;
+        if (options.guided_matching) {
+            prior = sequentialPrior(cache, images, i, -1, false);
+        }
+
+        cv::Mat result;
+        if (!verifier || quickVerify(*verifier, i, i + 1, options)) {
+            result = stitchWithFeatures(
+                images[i], features, panorama, cache.panoramaFeatures(),
+                options, &placement, options.guided_matching ? &prior : nullptr
+            );
+        }
 
         if (result.empty()) {
             std::cerr << "Failed to stitch image " << (i + 1) << "\n";
             if (i == 0 && middle_idx + 1 < images.size()) {
                 std::cerr << "Continuing with right side images...\n";
                 panorama = images[middle_idx].clone();
+                cache.clear();
+                cache.addImage(static_cast<int>(middle_idx), reference_features,
+                               cv::Mat::eye(3, 3, CV_64F), images[middle_idx].size());
                 break;
             }
             return cv::Mat();
         }
+
+        cache.applyTransform(placement.transform2);
+        cache.addImage(i, features, placement.transform1, images[i].size());
         panorama = result;
     }
 
     for (size_t i = middle_idx + 1; i < images.size(); i++) {
         std::cout << "\n=== Stitching image " << (i + 1) << " (right side) ===\n";
 
-        cv::Mat result = performStitchingDirect(
-            panorama, images[i],
-            detector_type, blend_mode,
-            ransac_threshold, max_features,
-            visualize, PanoramaConfig::MAX_PANORAMA_DIMENSION
-        );
+        const DetectionResult& features = all_features[i];
+        PanoramaPlacement placement;
+
+        MatchingPrior prior;
+        if (options.guided_matching) {
+            prior = sequentialPrior(cache, images, static_cast<int>(i), 1, true);
+        }
+
+        cv::Mat result;
+        if (!verifier || quickVerify(*verifier, i - 1, i, options)) {
+            result = stitchWithFeatures(
+                panorama, cache.panoramaFeatures(), images[i], features,
+                options, &placement, options.guided_matching ? &prior : nullptr
+            );
+        }
 
         if (result.empty()) {
             std::cerr << "Failed to stitch image " << (i + 1) << "\n";
@@ -469,8 +686,1953 @@ cv::Mat StitchingPipeline::performSequentialStitching(
             }
             return cv::Mat();
         }
+
+        cache.applyTransform(placement.transform1);
+        cache.addImage(static_cast<int>(i), features, placement.transform2, images[i].size());
         panorama = result;
     }
 
     return panorama;
 }
+
+MatchingPrior StitchingPipeline::sequentialPrior(
+    const FeatureCache& cache,
+    const std::vector<cv::Mat>& images,
+    int index,
+    int step,
+    bool panorama_is_query
+) {
+    MatchingPrior prior;
+    const cv::Size image_size = images[index].size();
+    prior.search_radius = PanoramaConfig::GUIDED_SEARCH_RADIUS_FRACTION *
+                          std::max(image_size.width, image_size.height);
+    prior.min_matches = PanoramaConfig::MIN_GUIDED_MATCHES;
+
+    int neighbour = index - step;
+    int previous = index - 2 * step;
+
+    cv::Mat neighbour_to_panorama = cache.transformOf(neighbour);
+    if (neighbour_to_panorama.empty()) {
+        return prior;
+    }
+
+    cv::Mat previous_to_panorama;
+    if (previous >= 0 && previous < static_cast<int>(images.size())) {
+        previous_to_panorama = cache.transformOf(previous);
+    }
+
+    if (!previous_to_panorama.empty()) {
+        cv::Mat image_to_panorama =
+            neighbour_to_panorama * previous_to_panorama.inv() * neighbour_to_panorama;
+        if (std::abs(cv::determinant(image_to_panorama)) > PanoramaConfig::HOMOGRAPHY_EPSILON) {
+            prior.homography = panorama_is_query ? cv::Mat(image_to_panorama.inv())
+                                                 : image_to_panorama;
+            return prior;
+        }
+    }
+
+    const cv::Size neighbour_size = images[neighbour].size();
+    std::vector<cv::Point2f> corners = {
+        cv::Point2f(0, 0),
+        cv::Point2f(static_cast<float>(neighbour_size.width), 0),
+        cv::Point2f(static_cast<float>(neighbour_size.width), static_cast<float>(neighbour_size.height)),
+        cv::Point2f(0, static_cast<float>(neighbour_size.height))
+    };
+    std::vector<cv::Point2f> footprint;
+    cv::perspectiveTransform(corners, footprint, neighbour_to_panorama);
+
+    int margin = static_cast<int>(prior.search_radius);
+    cv::Rect region = cv::boundingRect(footprint);
+    region -= cv::Point(margin, margin);
+    region += cv::Size(2 * margin, 2 * margin);
+
+    if (panorama_is_query) {
+        prior.query_region = region;
+    } else {
+        prior.train_region = region;
+    }
+    return prior;
+}
+
+bool StitchingPipeline::registerToReference(
+    const std::vector<cv::Mat>& images,
+    const StitchingOptions& options,
+    std::vector<cv::Mat>& to_reference,
+    size_t& first,
+    size_t& last,
+    size_t& reference_idx
+) {
+    std::vector<double> scales;
+    std::vector<cv::Mat> proxies = makeProxies(images, options, scales);
+
+    std::vector<DetectionResult> features;
+    try {
+        features = detectAll(proxies, options);
+    } catch (const std::exception& e) {
+        std::cerr << "Error creating detector: " << e.what() << "\n";
+        return false;
+    }
+
+    // pairwise[i] maps image i into image i + 1.
+    std::vector<cv::Mat> pairwise(images.size() - 1);
+    std::vector<std::unique_ptr<DescriptorIndex>> indexes(images.size());
+    std::unique_ptr<PairVerifier> verifier = makeVerifier(proxies, options);
+    for (size_t i = 0; i + 1 < images.size(); i++) {
+        std::cout << "\n=== Registering image " << (i + 1) << " -> " << (i + 2) << " ===\n";
+        if (verifier && !quickVerify(*verifier, i, i + 1, options)) {
+            continue;
+        }
+        if (scales[i] < 1.0 || scales[i + 1] < 1.0) {
+            pairwise[i] = registerCoarseToFine(images[i], features[i], scales[i],
+                                               images[i + 1], features[i + 1], scales[i + 1], options);
+        } else if (useDescriptorIndex(features[i], options)) {
+            pairwise[i] = registerPairIndexed(features, i, indexes, options);
+        } else {
+            pairwise[i] = registerPair(features[i], features[i + 1], options);
+        }
+    }
+
+    reference_idx = images.size() / 2;
+    std::cout << "\nUsing image " << (reference_idx + 1) << " as reference\n";
+
+    to_reference.assign(images.size(), cv::Mat());
+    to_reference[reference_idx] = cv::Mat::eye(3, 3, CV_64F);
+
+    first = reference_idx;
+    for (size_t i = reference_idx; i-- > 0;) {
+        if (pairwise[i].empty()) {
+            std::cerr << "Failed to register image " << (i + 1) << ", dropping images 1-" << (i + 1) << "\n";
+            break;
+        }
+        to_reference[i] = to_reference[i + 1] * pairwise[i];
+        first = i;
+    }
+
+    last = reference_idx;
+    for (size_t i = reference_idx + 1; i < images.size(); i++) {
+        cv::Mat inverse;
+        if (pairwise[i - 1].empty() || !cv::invert(pairwise[i - 1], inverse)) {
+            std::cerr << "Failed to register image " << (i + 1) << ", dropping images "
+                      << (i + 1) << "-" << images.size() << "\n";
+            break;
+        }
+        to_reference[i] = to_reference[i - 1] * inverse;
+        last = i;
+    }
+
+    if (first == last) {
+        std::cerr << "Error: No image could be registered to the reference\n";
+        return false;
+    }
+
+    return true;
+}
+
+bool StitchingPipeline::registerSpanningTree(
+    const std::vector<cv::Mat>& images,
+    const StitchingOptions& options,
+    std::vector<cv::Mat>& to_reference,
+    std::vector<size_t>& order
+) {
+    const size_t n = images.size();
+
+    std::vector<double> scales;
+    std::vector<cv::Mat> proxies = makeProxies(images, options, scales);
+
+    std::vector<DetectionResult> features;
+    try {
+        features = detectAll(proxies, options);
+    } catch (const std::exception& e) {
+        std::cerr << "Error creating detector: " << e.what() << "\n";
+        return false;
+    }
+
+    PairVerifier verifier;
+    {
+        StageProfiler::Scope timer(options.profiler, "verify");
+        for (const auto& proxy : proxies) {
+            verifier.addImage(proxy);
+        }
+    }
+
+    // homography maps image `from` into image `to`, on the proxies.
+    struct MatchEdge {
+        size_t from = 0;
+        size_t to = 0;
+        size_t weight = 0;
+        cv::Mat homography;
+    };
+
+    std::vector<MatchEdge> candidates;
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = i + 1; j < n; j++) {
+            MatchEdge edge;
+            edge.from = i;
+            edge.to = j;
+            candidates.push_back(edge);
+        }
+    }
+
+    std::cout << "Screening " << candidates.size() << " candidate pairs...\n";
+
+    auto scoreEdge = [&](MatchEdge& edge) {
+        PairVerdict verdict;
+        {
+            StageProfiler::Scope timer(options.profiler, "verify");
+            verdict = verifier.verify(edge.from, edge.to);
+        }
+        if (!verdict.overlapping) {
+            return;
+        }
+
+        std::vector<cv::DMatch> inliers;
+        edge.homography = registerPair(features[edge.from], features[edge.to], options, &inliers);
+        if (!edge.homography.empty()) {
+            edge.weight = inliers.size();
+        }
+    };
+
+    ThreadPool& pool = threadPool();
+    try {
+        if (pool.size() < 2 || pool.isWorkerThread()) {
+            for (auto& edge : candidates) {
+                scoreEdge(edge);
+            }
+        } else {
+            std::vector<std::future<void>> pending;
+            pending.reserve(candidates.size());
+            for (auto& edge : candidates) {
+                MatchEdge* target = &edge;
+                pending.push_back(pool.submit([&scoreEdge, target]() { scoreEdge(*target); }));
+            }
+
+            std::exception_ptr failure;
+            for (auto& future : pending) {
+                try {
+                    future.get();
+                } catch (...) {
+                    if (!failure) {
+                        failure = std::current_exception();
+                    }
+                }
+            }
+            if (failure) {
+                std::rethrow_exception(failure);
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error registering image pairs: " << e.what() << "\n";
+        return false;
+    }
+
+    std::vector<MatchEdge> edges;
+    for (auto& edge : candidates) {
+        if (edge.weight > 0) {
+            edges.push_back(std::move(edge));
+        }
+    }
+
+    std::cout << edges.size() << " of " << candidates.size() << " pairs overlap\n";
+    if (edges.empty()) {
+        std::cerr << "Error: No overlapping image pairs found\n";
+        return false;
+    }
+
+    // The reference is the image with the most overlapping neighbours,
+    // ties going to the one with the most inliers.
+    std::vector<size_t> degree(n, 0), strength(n, 0);
+    for (const auto& edge : edges) {
+        degree[edge.from]++;
+        degree[edge.to]++;
+        strength[edge.from] += edge.weight;
+        strength[edge.to] += edge.weight;
+    }
+    size_t reference_idx = 0;
+    for (size_t i = 1; i < n; i++) {
+        if (degree[i] > degree[reference_idx] ||
+            (degree[i] == degree[reference_idx] && strength[i] > strength[reference_idx])) {
+            reference_idx = i;
+        }
+    }
+
+    // Kruskal over descending inlier counts gives the maximum spanning
+    // forest; tree[i] lists the tree edges incident to image i.
+    std::stable_sort(edges.begin(), edges.end(), [](const MatchEdge& a, const MatchEdge& b) {
+        return a.weight > b.weight;
+    });
+
+    std::vector<size_t> component(n);
+    for (size_t i = 0; i < n; i++) {
+        component[i] = i;
+    }
+    auto root = [&component](size_t i) {
+        while (component[i] != i) {
+            component[i] = component[component[i]];
+            i = component[i];
+        }
+        return i;
+    };
+
+    std::vector<std::vector<size_t>> tree(n);
+    for (size_t k = 0; k < edges.size(); k++) {
+        size_t a = root(edges[k].from);
+        size_t b = root(edges[k].to);
+        if (a == b) continue;
+        component[a] = b;
+        tree[edges[k].from].push_back(k);
+        tree[edges[k].to].push_back(k);
+    }
+
+    std::cout << "Using image " << (reference_idx + 1) << " as reference ("
+              << degree[reference_idx] << " overlaps)\n";
+
+    to_reference.assign(n, cv::Mat());
+    to_reference[reference_idx] = cv::Mat::eye(3, 3, CV_64F);
+    order.assign(1, reference_idx);
+
+    // Only the n - 1 tree edges are brought to full resolution.
+    for (size_t head = 0; head < order.size(); head++) {
+        size_t node = order[head];
+        for (size_t k : tree[node]) {
+            const MatchEdge& edge = edges[k];
+            size_t next = edge.from == node ? edge.to : edge.from;
+            if (!to_reference[next].empty()) continue;
+
+            std::cout << "\n=== Registering image " << (edge.from + 1) << " -> " << (edge.to + 1) << " ===\n";
+
+            cv::Mat homography;
+            double scale_from = scales[edge.from], scale_to = scales[edge.to];
+            if (scale_from < 1.0 || scale_to < 1.0) {
+                homography = registerCoarseToFine(images[edge.from], features[edge.from], scale_from,
+                                                  images[edge.to], features[edge.to], scale_to, options);
+                if (homography.empty()) {
+                    cv::Mat from_full = cv::Mat::eye(3, 3, CV_64F);
+                    from_full.at<double>(0, 0) = from_full.at<double>(1, 1) = scale_from;
+                    cv::Mat to_full = cv::Mat::eye(3, 3, CV_64F);
+                    to_full.at<double>(0, 0) = to_full.at<double>(1, 1) = 1.0 / scale_to;
+                    homography = to_full * edge.homography * from_full;
+                }
+            } else {
+                homography = edge.homography;
+            }
+
+            if (next == edge.from) {
+                to_reference[next] = to_reference[node] * homography;
+            } else {
+                cv::Mat inverse;
+                if (!cv::invert(homography, inverse)) continue;
+                to_reference[next] = to_reference[node] * inverse;
+            }
+            order.push_back(next);
+        }
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        if (to_reference[i].empty()) {
+            std::cerr << "Image " << (i + 1) << " does not connect to the reference, dropping it\n";
+        }
+    }
+
+    if (order.size() < 2) {
+        std::cerr << "Error: No image could be registered to the reference\n";
+        return false;
+    }
+
+    return true;
+}
+
+std::vector<cv::Mat> StitchingPipeline::projectInputs(
+    const std::vector<cv::Mat>& images,
+    const StitchingOptions& options
+) {
+    ProjectionType projection = ImageWarper::stringToProjection(options.projection);
+
+    double focal = 0.0;
+    try {
+        focal = estimateFocal(images, options);
+    } catch (const std::exception& e) {
+        std::cerr << "Error estimating focal length: " << e.what() << "\n";
+        return {};
+    }
+
+    std::cout << "Projecting " << images.size() << " images onto a "
+              << options.projection << " surface (focal " << focal << " px)\n";
+
+    StageProfiler::Scope timer(options.profiler, "warp");
+    std::vector<cv::Mat> projected(images.size());
+    for (size_t i = 0; i < images.size(); i++) {
+        projected[i] = ImageWarper::projectImage(images[i], projection, focal);
+        if (projected[i].empty()) {
+            return {};
+        }
+    }
+    return projected;
+}
+
+double StitchingPipeline::estimateFocal(
+    const std::vector<cv::Mat>& images,
+    const StitchingOptions& options
+) {
+    if (options.focal_length > 0.0) {
+        return options.focal_length;
+    }
+
+    StitchingOptions proxy_options = options;
+    proxy_options.coarse_to_fine = true;
+    proxy_options.proxy_max_pixels = PanoramaConfig::FOCAL_PROXY_PIXELS;
+
+    size_t count = std::min(images.size(), PanoramaConfig::FOCAL_ESTIMATION_IMAGES);
+    std::vector<cv::Mat> subset(images.begin(), images.begin() + count);
+    std::vector<double> scales;
+    std::vector<cv::Mat> proxies = makeProxies(subset, proxy_options, scales);
+    std::vector<DetectionResult> features = detectAll(proxies, proxy_options);
+
+    std::vector<double> focals;
+    for (size_t i = 0; i + 1 < count; i++) {
+        cv::Mat homography = registerPair(features[i], features[i + 1], proxy_options);
+        if (homography.empty()) continue;
+
+        // Lift the proxy homography to full-resolution pixels.
+        cv::Mat from_proxy = cv::Mat::eye(3, 3, CV_64F);
+        from_proxy.at<double>(0, 0) = from_proxy.at<double>(1, 1) = 1.0 / scales[i + 1];
+        cv::Mat to_proxy = cv::Mat::eye(3, 3, CV_64F);
+        to_proxy.at<double>(0, 0) = to_proxy.at<double>(1, 1) = scales[i];
+
+        double focal = 0.0;
+        if (ImageWarper::focalFromHomography(from_proxy * homography * to_proxy,
+                                             images[i].size(), images[i + 1].size(), focal)) {
+            focals.push_back(focal);
+        }
+    }
+
+    if (focals.empty()) {
+        // The fallback OpenCV's autocalibration uses as well.
+        double sum = 0.0;
+        for (const auto& image : images) {
+            sum += image.cols + image.rows;
+        }
+        double focal = sum / images.size();
+        std::cerr << "Warning: Could not estimate the focal length, using " << focal << " px\n";
+        return focal;
+    }
+
+    std::nth_element(focals.begin(), focals.begin() + focals.size() / 2, focals.end());
+    return focals[focals.size() / 2];
+}
+
+std::vector<double> StitchingPipeline::compensationGains(
+    const std::vector<cv::Mat>& images,
+    const std::vector<cv::Mat>& transforms,
+    const cv::Size& canvas_size,
+    const StitchingOptions& options
+) {
+    if (!options.gain_compensation) {
+        return std::vector<double>(images.size(), 1.0);
+    }
+
+    StageProfiler::Scope timer(options.profiler, "gain");
+    std::vector<double> gains = GainCompensator().computeGains(images, transforms, canvas_size);
+
+    std::cout << "Exposure gains:";
+    for (size_t i = 0; i < gains.size(); i++) {
+        if (!transforms[i].empty()) {
+            std::cout << " " << gains[i];
+        }
+    }
+    std::cout << "\n";
+
+    return gains;
+}
+
+std::vector<size_t> StitchingPipeline::compositingOrder(size_t reference_idx, size_t first, size_t last) {
+    // Outward from the reference so that every source image is resampled
+    // exactly once into the shared canvas.
+    std::vector<size_t> order = {reference_idx};
+    for (size_t step = 1; reference_idx >= first + step || reference_idx + step <= last; step++) {
+        if (reference_idx >= first + step) {
+            order.push_back(reference_idx - step);
+        }
+        if (reference_idx + step <= last) {
+            order.push_back(reference_idx + step);
+        }
+    }
+    return order;
+}
+
+cv::Mat StitchingPipeline::performGlobalStitching(
+    const std::vector<cv::Mat>& images,
+    const StitchingOptions& requested_options
+) {
+    std::cout << "\n=== Using global registration ===\n";
+
+    if (images.empty()) {
+        std::cerr << "Error: No images provided for stitching\n";
+        return cv::Mat();
+    }
+
+    if (images.size() == 1) {
+        return images[0].clone();
+    }
+
+    if (!validateImages(images)) {
+        return cv::Mat();
+    }
+
+    StitchingOptions options = sanitizeOptions(requested_options);
+
+    if (options.projection != "plane") {
+        std::vector<cv::Mat> projected = projectInputs(images, options);
+        if (projected.empty()) {
+            return cv::Mat();
+        }
+        options.projection = "plane";
+        return performGlobalStitching(projected, options);
+    }
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    std::vector<cv::Mat> to_reference;
+    size_t first = 0, last = 0, reference_idx = 0;
+    if (!registerToReference(images, options, to_reference, first, last, reference_idx)) {
+        return cv::Mat();
+    }
+
+    cv::Mat panorama = composeToReference(images, to_reference,
+                                          compositingOrder(reference_idx, first, last), options);
+    if (panorama.empty()) {
+        return panorama;
+    }
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+    std::cout << "Panorama created successfully!\n";
+    std::cout << "Total time: " << duration.count() << " ms\n";
+
+    return panorama;
+}
+
+cv::Mat StitchingPipeline::performUnorderedStitching(
+    const std::vector<cv::Mat>& images,
+    const StitchingOptions& requested_options
+) {
+    std::cout << "\n=== Using unordered registration ===\n";
+
+    if (images.empty()) {
+        std::cerr << "Error: No images provided for stitching\n";
+        return cv::Mat();
+    }
+
+    if (images.size() == 1) {
+        return images[0].clone();
+    }
+
+    if (!validateImages(images)) {
+        return cv::Mat();
+    }
+
+    StitchingOptions options = sanitizeOptions(requested_options);
+
+    // The focal estimate relies on consecutive images overlapping.
+    if (options.projection != "plane") {
+        if (options.focal_length <= 0.0) {
+            std::cerr << "Warning: Unordered stitching needs --focal to reproject, using plane\n";
+            options.projection = "plane";
+        } else {
+            std::vector<cv::Mat> projected = projectInputs(images, options);
+            if (projected.empty()) {
+                return cv::Mat();
+            }
+            options.projection = "plane";
+            return performUnorderedStitching(projected, options);
+        }
+    }
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    std::vector<cv::Mat> to_reference;
+    std::vector<size_t> order;
+    if (!registerSpanningTree(images, options, to_reference, order)) {
+        return cv::Mat();
+    }
+
+    cv::Mat panorama = composeToReference(images, to_reference, order, options);
+    if (panorama.empty()) {
+        return panorama;
+    }
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+    std::cout << "Panorama created successfully!\n";
+    std::cout << "Total time: " << duration.count() << " ms\n";
+
+    return panorama;
+}
+
+cv::Mat StitchingPipeline::composeToReference(
+    const std::vector<cv::Mat>& images,
+    const std::vector<cv::Mat>& to_reference,
+    const std::vector<size_t>& order,
+    const StitchingOptions& options
+) {
+    std::vector<cv::Size> sizes;
+    std::vector<cv::Mat> transforms;
+    for (size_t idx : order) {
+        sizes.push_back(images[idx].size());
+        transforms.push_back(to_reference[idx]);
+    }
+
+    cv::Rect bounds = HomographyEstimator::calculateOutputBounds(sizes, transforms);
+    cv::Size panorama_size = bounds.size();
+
+    if (panorama_size.width <= 0 || panorama_size.height <= 0) {
+        std::cerr << "Invalid panorama size (negative)" << std::endl;
+        return cv::Mat();
+    }
+
+    if (panorama_size.width > options.max_panorama_dimension ||
+        panorama_size.height > options.max_panorama_dimension) {
+        std::cerr << "Error: Panorama size would be " << panorama_size.width
+                  << "x" << panorama_size.height << " pixels (max: " << options.max_panorama_dimension << ")\n";
+        return cv::Mat();
+    }
+
+    size_t estimated_bytes = static_cast<size_t>(panorama_size.width) * panorama_size.height * 3 * 2;
+    if (estimated_bytes > PanoramaConfig::MAX_PANORAMA_MEMORY) {
+        std::cerr << "Error: Panorama would require approximately "
+                  << (estimated_bytes / 1048576) << " MB of memory (max: "
+                  << (PanoramaConfig::MAX_PANORAMA_MEMORY / 1048576) << " MB)\n";
+        return cv::Mat();
+    }
+
+    cv::Mat translation = (cv::Mat_<double>(3, 3) <<
+        1, 0, -bounds.x,
+        0, 1, -bounds.y,
+        0, 0, 1);
+
+    std::unique_ptr<Blender> blender = createBlender(options);
+
+    std::vector<cv::Mat> placed(images.size());
+    for (size_t idx : order) {
+        placed[idx] = translation * to_reference[idx];
+    }
+    std::vector<double> gains = compensationGains(images, placed, panorama_size, options);
+
+    std::cout << "Warping and blending " << order.size() << " images into "
+              << panorama_size.width << "x" << panorama_size.height << " canvas...\n";
+
+    ImageWarper warper;
+
+    // The accumulator touches only each image's ROI; when its sums do not
+    // fit the blend budget, fall back to chaining pairwise (tiled) blends.
+    size_t blend_budget = static_cast<size_t>(options.blend_memory_mb) * 1048576;
+    if (blender->accumulatorBytes(panorama_size) <= blend_budget) {
+        blender->begin(panorama_size);
+        const bool on_device = blender->deviceAccumulation();
+        if (on_device) {
+            std::cout << "Warping and blending on " << cv::ocl::Device::getDefault().name() << "\n";
+        }
+
+        for (size_t idx : order) {
+            if (on_device) {
+                DeviceWarpedImage warped;
+                {
+                    StageProfiler::Scope timer(options.profiler, "warp");
+                    cv::UMat source;
+                    images[idx].copyTo(source);
+                    warper.setGain(gains[idx]);
+                    warped = warper.warpToFootprint(source, placed[idx], panorama_size);
+                }
+                if (warped.empty()) continue;
+
+                StageProfiler::Scope timer(options.profiler, "blend");
+                blender->add(warped.image, warped.mask, warped.roi);
+                continue;
+            }
+
+            WarpedImage warped;
+            {
+                StageProfiler::Scope timer(options.profiler, "warp");
+                warper.setGain(gains[idx]);
+                warped = warper.warpToFootprint(images[idx], placed[idx], panorama_size);
+            }
+            if (warped.empty()) continue;
+
+            StageProfiler::Scope timer(options.profiler, "blend");
+            blender->add(warped.image, warped.mask, warped.roi);
+        }
+
+        cv::Mat panorama;
+        {
+            StageProfiler::Scope timer(options.profiler, "blend");
+            panorama = blender->finalize();
+        }
+
+        return panorama;
+    }
+
+    cv::Mat panorama = cv::Mat::zeros(panorama_size, images[order.front()].type());
+    cv::Mat panorama_mask = cv::Mat::zeros(panorama_size, CV_8UC1);
+
+    for (size_t idx : order) {
+        WarpedImage warped;
+        {
+            StageProfiler::Scope timer(options.profiler, "warp");
+            warper.setGain(gains[idx]);
+            warped = warper.warpToFootprint(images[idx], placed[idx], panorama_size);
+        }
+
+        StageProfiler::Scope timer(options.profiler, "blend");
+        if (!blendIntoCanvas(*blender, warped, panorama, panorama_mask)) {
+            std::cerr << "Error: Blending failed for image " << (idx + 1) << "\n";
+            return cv::Mat();
+        }
+    }
+
+    return panorama;
+}
+
+cv::Mat StitchingPipeline::performStreamingStitching(
+    const std::vector<std::string>& image_paths,
+    const StitchingOptions& requested_options
+) {
+    std::cout << "\n=== Using streaming stitching ===\n";
+
+    if (image_paths.empty()) {
+        std::cerr << "Error: No images provided for stitching\n";
+        return cv::Mat();
+    }
+
+    StitchingOptions options = sanitizeOptions(requested_options);
+    if (options.projection != "plane") {
+        // The focal estimate needs several frames before the first warp.
+        std::cerr << "Warning: Streaming stitching does not reproject, using plane\n";
+        options.projection = "plane";
+    }
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    // With coarse_to_fine the early stages only see a grayscale proxy at
+    // `scale`; the compositor decodes the full colour image itself.
+    struct StreamFrame {
+        size_t index = 0;
+        cv::Mat image;
+        double scale = 1.0;
+        cv::Size full_size;
+        DetectionResult features;
+        cv::Mat to_first;
+    };
+
+    BoundedQueue<StreamFrame> decoded(PanoramaConfig::STREAM_QUEUE_DEPTH);
+    BoundedQueue<StreamFrame> detected(PanoramaConfig::STREAM_QUEUE_DEPTH);
+    BoundedQueue<StreamFrame> registered(PanoramaConfig::STREAM_QUEUE_DEPTH);
+    std::atomic<bool> failed{false};
+
+    auto fail = [&](const std::string& message) {
+        std::cerr << "Error: " << message << "\n";
+        failed = true;
+        decoded.close();
+        detected.close();
+        registered.close();
+    };
+
+    std::thread decoder([&]() {
+        try {
+            for (size_t i = 0; i < image_paths.size(); i++) {
+                StreamFrame frame;
+                frame.index = i;
+                frame.full_size = options.coarse_to_fine ? ImageLoader::readImageSize(image_paths[i]) : cv::Size();
+                frame.scale = frame.full_size.empty() ? 1.0 : proxyScale(frame.full_size, options);
+                {
+                    StageProfiler::Scope timer(options.profiler, "decode");
+                    if (frame.scale < 1.0) {
+                        frame.image = ImageLoader::loadProxy(image_paths[i], frame.scale, frame.full_size);
+                    } else {
+                        frame.image = cv::imread(image_paths[i]);
+                        frame.full_size = frame.image.size();
+                    }
+                }
+                if (frame.image.empty()) {
+                    fail("Could not load image: " + image_paths[i]);
+                    return;
+                }
+                // Proxies are grayscale; the colour decode is validated when
+                // the compositor loads it.
+                bool valid = frame.scale < 1.0
+                    ? !frame.full_size.empty() &&
+                      frame.full_size.width >= PanoramaConfig::MIN_IMAGE_DIMENSION &&
+                      frame.full_size.height >= PanoramaConfig::MIN_IMAGE_DIMENSION
+                    : validateImages({frame.image});
+                if (!valid) {
+                    fail("Invalid image: " + image_paths[i]);
+                    return;
+                }
+                if (!decoded.push(std::move(frame))) {
+                    return;
+                }
+            }
+            decoded.close();
+        } catch (const std::exception& e) {
+            fail(std::string("Decoding failed: ") + e.what());
+        }
+    });
+
+    std::thread detector([&]() {
+        try {
+            auto feature_detector = DetectorFactory::createDetector(options.detector_type);
+            feature_detector->setUniformSelection(options.uniform_keypoints);
+
+            StreamFrame frame;
+            while (decoded.pop(frame)) {
+                feature_detector->setMaxFeatures(
+                    calculateAdaptiveFeatures(frame.image.rows * frame.image.cols, options.max_features));
+                {
+                    StageProfiler::Scope timer(options.profiler, "detect");
+                    frame.features = feature_detector->detect(frame.image);
+                }
+                if (options.profiler) {
+                    options.profiler->record("describe", frame.features.description_time_ms);
+                }
+                std::cout << "Detected " << frame.features.getKeypointCount()
+                          << " keypoints (image " << (frame.index + 1) << ")\n";
+                if (!detected.push(std::move(frame))) {
+                    return;
+                }
+            }
+            detected.close();
+        } catch (const std::exception& e) {
+            fail(std::string("Feature detection failed: ") + e.what());
+        }
+    });
+
+    std::thread registrar([&]() {
+        try {
+            // Only the features of the last registered frame are kept.
+            DetectionResult previous;
+            cv::Mat previous_to_first;
+            double previous_scale = 1.0;
+
+            StreamFrame frame;
+            while (detected.pop(frame)) {
+                if (previous_to_first.empty()) {
+                    frame.to_first = cv::Mat::eye(3, 3, CV_64F);
+                } else {
+                    std::cout << "\n=== Registering image " << (frame.index + 1) << " ===\n";
+                    cv::Mat homography = registerPair(frame.features, previous, options);
+                    if (homography.empty()) {
+                        std::cerr << "Failed to register image " << (frame.index + 1) << ", skipping it\n";
+                        continue;
+                    }
+                    // Lift the proxy homography to full resolution.
+                    cv::Mat to_proxy = cv::Mat::diag(cv::Mat(cv::Vec3d(frame.scale, frame.scale, 1.0)));
+                    cv::Mat from_previous_proxy =
+                        cv::Mat::diag(cv::Mat(cv::Vec3d(1.0 / previous_scale, 1.0 / previous_scale, 1.0)));
+                    frame.to_first = previous_to_first * from_previous_proxy * homography * to_proxy;
+                }
+
+                previous = std::move(frame.features);
+                frame.features = DetectionResult{};
+                previous_to_first = frame.to_first;
+                previous_scale = frame.scale;
+
+                if (!registered.push(std::move(frame))) {
+                    return;
+                }
+            }
+            registered.close();
+        } catch (const std::exception& e) {
+            fail(std::string("Registration failed: ") + e.what());
+        }
+    });
+
+    cv::Mat panorama;
+    cv::Mat first_to_panorama;
+
+    try {
+        StreamFrame frame;
+        while (registered.pop(frame)) {
+            if (frame.scale < 1.0) {
+                StageProfiler::Scope timer(options.profiler, "decode");
+                frame.image = cv::imread(image_paths[frame.index]);
+                if (frame.image.size() != frame.full_size || !validateImages({frame.image})) {
+                    fail("Could not decode full-resolution image: " + image_paths[frame.index]);
+                    break;
+                }
+            }
+
+            if (panorama.empty()) {
+                panorama = frame.image;
+                first_to_panorama = cv::Mat::eye(3, 3, CV_64F);
+                continue;
+            }
+
+            std::cout << "\n=== Compositing image " << (frame.index + 1) << " ===\n";
+
+            // The panorama is img1 so it is placed by a whole-pixel copy and
+            // only the new frame is resampled.
+            cv::Mat frame_to_panorama = first_to_panorama * frame.to_first;
+            PanoramaPlacement placement;
+            cv::Mat result = composePair(panorama, frame.image, frame_to_panorama.inv(), options, &placement);
+            frame.image.release();
+
+            if (result.empty()) {
+                std::cerr << "Failed to composite image " << (frame.index + 1) << ", skipping it\n";
+                continue;
+            }
+
+            first_to_panorama = placement.transform1 * first_to_panorama;
+            panorama = result;
+        }
+    } catch (const std::exception& e) {
+        fail(std::string("Compositing failed: ") + e.what());
+    }
+
+    decoder.join();
+    detector.join();
+    registrar.join();
+
+    if (failed) {
+        return cv::Mat();
+    }
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+    std::cout << "Total time: " << duration.count() << " ms\n";
+
+    return panorama;
+}
+
+cv::Mat StitchingPipeline::performVideoStitching(
+    const std::string& source,
+    const StitchingOptions& requested_options
+) {
+    std::cout << "\n=== Using video stitching ===\n";
+
+    StitchingOptions options = sanitizeOptions(requested_options);
+    if (options.projection != "plane") {
+        std::cerr << "Warning: Video stitching does not reproject, using plane\n";
+        options.projection = "plane";
+    }
+
+    cv::VideoCapture capture(source);
+    if (!capture.isOpened()) {
+        std::cerr << "Error: Could not open video: " << source << "\n";
+        return cv::Mat();
+    }
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    struct VideoFrame {
+        int index = 0;
+        cv::Mat image;
+    };
+
+    BoundedQueue<VideoFrame> decoded(PanoramaConfig::STREAM_QUEUE_DEPTH);
+    std::atomic<bool> failed{false};
+
+    std::thread decoder([&]() {
+        try {
+            for (int i = 0;; i++) {
+                VideoFrame frame;
+                frame.index = i;
+                {
+                    StageProfiler::Scope timer(options.profiler, "decode");
+                    if (!capture.read(frame.image) || frame.image.empty()) {
+                        break;
+                    }
+                }
+                if (!validateImages({frame.image})) {
+                    failed = true;
+                    break;
+                }
+                if (!decoded.push(std::move(frame))) {
+                    return;
+                }
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Error: Decoding failed: " << e.what() << "\n";
+            failed = true;
+        }
+        decoded.close();
+    });
+
+    // Overlap of the frame with the keyframe after moving its centre by
+    // the predicted homography.
+    auto predictedOverlap = [](const cv::Mat& homography, const cv::Size& size) {
+        std::vector<cv::Point2f> centre = {cv::Point2f(size.width * 0.5f, size.height * 0.5f)};
+        std::vector<cv::Point2f> moved;
+        cv::perspectiveTransform(centre, moved, homography);
+        double dx = std::abs(moved[0].x - centre[0].x);
+        double dy = std::abs(moved[0].y - centre[0].y);
+        return std::max(0.0, size.width - dx) * std::max(0.0, size.height - dy) /
+               (static_cast<double>(size.width) * size.height);
+    };
+
+    cv::Mat panorama;
+    cv::Mat first_to_panorama;
+
+    DetectionResult key_features;
+    cv::Mat key_to_first;
+    int key_index = -1;
+    // Last measured frame -> keyframe homography and the number of frames
+    // it spanned; empty until two keyframes are registered.
+    cv::Mat motion;
+    int motion_gap = 0;
+    int keyframes = 0;
+    int failures = 0;
+    int frames_seen = 0;
+
+    try {
+        auto feature_detector = DetectorFactory::createDetector(options.detector_type);
+        feature_detector->setUniformSelection(options.uniform_keypoints);
+
+        auto detect = [&](const cv::Mat& image) {
+            feature_detector->setMaxFeatures(calculateAdaptiveFeatures(image.rows * image.cols, options.max_features));
+            StageProfiler::Scope timer(options.profiler, "detect");
+            return feature_detector->detect(image);
+        };
+
+        VideoFrame frame;
+        while (decoded.pop(frame)) {
+            frames_seen = frame.index + 1;
+            if (panorama.empty()) {
+                key_features = detect(frame.image);
+                key_to_first = cv::Mat::eye(3, 3, CV_64F);
+                key_index = frame.index;
+                panorama = frame.image;
+                first_to_panorama = cv::Mat::eye(3, 3, CV_64F);
+                keyframes = 1;
+                continue;
+            }
+
+            // Constant velocity: the motion over `gap` frames is the last
+            // measured motion scaled to first order.
+            int gap = frame.index - key_index;
+            cv::Mat predicted;
+            if (!motion.empty()) {
+                cv::Mat identity = cv::Mat::eye(3, 3, CV_64F);
+                predicted = identity + (motion - identity) * (static_cast<double>(gap) / motion_gap);
+                if (predictedOverlap(predicted, frame.image.size()) > options.keyframe_overlap &&
+                    gap < PanoramaConfig::VIDEO_MAX_KEYFRAME_GAP) {
+                    continue;
+                }
+            }
+
+            std::cout << "\n=== Keyframe " << (keyframes + 1) << " (frame " << (frame.index + 1) << ") ===\n";
+
+            DetectionResult features = detect(frame.image);
+            std::cout << "Detected " << features.getKeypointCount() << " keypoints\n";
+
+            MatchingPrior prior;
+            if (!predicted.empty()) {
+                prior.homography = predicted;
+                prior.search_radius = PanoramaConfig::GUIDED_SEARCH_RADIUS_FRACTION *
+                                      std::max(frame.image.cols, frame.image.rows);
+                prior.min_matches = PanoramaConfig::MIN_GUIDED_MATCHES;
+            }
+
+            MatchingResult matches = matchPair(features, key_features, options, predicted.empty() ? nullptr : &prior);
+            std::cout << "Found " << matches.num_good_matches << " good matches\n";
+            cv::Mat homography = estimatePair(features, key_features, matches, options, nullptr);
+
+            if (homography.empty()) {
+                // The prediction may be what went wrong; measure afresh.
+                motion.release();
+                if (++failures >= PanoramaConfig::VIDEO_MAX_FAILURES) {
+                    std::cerr << "Failed to register " << failures
+                              << " frames in a row, returning partial panorama\n";
+                    break;
+                }
+                std::cerr << "Failed to register frame " << (frame.index + 1) << ", skipping it\n";
+                continue;
+            }
+            failures = 0;
+
+            cv::Mat frame_to_first = key_to_first * homography;
+            cv::Mat frame_to_panorama = first_to_panorama * frame_to_first;
+            PanoramaPlacement placement;
+            cv::Mat result = composePair(panorama, frame.image, frame_to_panorama.inv(), options, &placement);
+            frame.image.release();
+
+            if (result.empty()) {
+                std::cerr << "Failed to composite frame " << (frame.index + 1) << ", skipping it\n";
+                continue;
+            }
+
+            first_to_panorama = placement.transform1 * first_to_panorama;
+            panorama = result;
+
+            motion = homography / homography.at<double>(2, 2);
+            motion_gap = gap;
+            key_features = std::move(features);
+            key_to_first = frame_to_first;
+            key_index = frame.index;
+            keyframes++;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Video stitching failed: " << e.what() << "\n";
+        failed = true;
+    }
+
+    decoded.close();
+    decoder.join();
+
+    if (failed) {
+        return cv::Mat();
+    }
+
+    if (keyframes < 2) {
+        std::cerr << "Error: No frame could be registered to the first one\n";
+        return cv::Mat();
+    }
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+    std::cout << "Composited " << keyframes << " keyframes out of " << frames_seen << " frames\n";
+    std::cout << "Total time: " << duration.count() << " ms\n";
+
+    return panorama;
+}
+
+std::unique_ptr<PairVerifier> StitchingPipeline::makeVerifier(
+    const std::vector<cv::Mat>& images,
+    const StitchingOptions& options
+) {
+    if (!options.quick_reject) {
+        return nullptr;
+    }
+
+    StageProfiler::Scope timer(options.profiler, "verify");
+    auto verifier = std::make_unique<PairVerifier>();
+    for (const auto& image : images) {
+        verifier->addImage(image);
+    }
+    return verifier;
+}
+
+bool StitchingPipeline::quickVerify(
+    const PairVerifier& verifier,
+    size_t i,
+    size_t j,
+    const StitchingOptions& options
+) {
+    PairVerdict verdict;
+    {
+        StageProfiler::Scope timer(options.profiler, "verify");
+        verdict = verifier.verify(i, j);
+    }
+
+    if (!verdict.overlapping) {
+        std::cerr << "Quick check rejected images " << (i + 1) << " and " << (j + 1)
+                  << " (" << verdict.matches << " thumbnail matches, "
+                  << verdict.inliers << " inliers)\n";
+    }
+    return verdict.overlapping;
+}
+
+std::vector<DetectionResult> StitchingPipeline::detectAll(
+    const std::vector<cv::Mat>& images,
+    const StitchingOptions& options
+) {
+    ResultCache cache(options.cache_dir);
+    std::vector<DetectionResult> features(images.size());
+    std::vector<std::string> keys(images.size());
+
+    std::vector<size_t> missing;
+    std::vector<cv::Mat> missing_images;
+    std::vector<std::unique_ptr<FeatureDetector>> detectors;
+    for (size_t i = 0; i < images.size(); i++) {
+        int max_features = calculateAdaptiveFeatures(images[i].rows * images[i].cols, options.max_features);
+
+        if (cache.enabled()) {
+            keys[i] = ResultCache::featureKey(images[i], options.detector_type, max_features,
+                                              options.uniform_keypoints);
+            if (cache.loadFeatures(keys[i], features[i])) {
+                if (options.profiler) {
+                    // Report the timings measured when the entry was stored.
+                    options.profiler->record("detect", features[i].detection_time_ms +
+                                                       features[i].description_time_ms);
+                    options.profiler->record("describe", features[i].description_time_ms);
+                }
+                continue;
+            }
+        }
+
+        auto detector = DetectorFactory::createDetector(options.detector_type);
+        detector->setMaxFeatures(max_features);
+        detector->setUniformSelection(options.uniform_keypoints);
+        detectors.push_back(std::move(detector));
+        missing.push_back(i);
+        missing_images.push_back(images[i]);
+    }
+
+    if (missing.size() < images.size()) {
+        std::cout << "Loaded cached features for " << (images.size() - missing.size()) << " images\n";
+    }
+
+    if (!missing.empty()) {
+        std::cout << "Detecting features in " << missing.size() << " images...\n";
+        std::vector<DetectionResult> detected;
+        {
+            StageProfiler::Scope timer(options.profiler, "detect");
+            // A single-pass AKAZE detector starts its threshold schedule where
+            // the last image settled. Detect one image first and start the
+            // others from its threshold instead of from the base threshold.
+            auto* akaze = dynamic_cast<AKAZEDetector*>(detectors.front().get());
+            if (akaze && detectors.size() > 1 &&
+                akaze->getThresholdMode() == AKAZEDetector::ThresholdMode::SINGLE_PASS) {
+                DetectionResult first = akaze->detect(missing_images.front());
+                for (size_t j = 1; j < detectors.size(); j++) {
+                    static_cast<AKAZEDetector*>(detectors[j].get())->setSceneThreshold(akaze->getSceneThreshold());
+                }
+                std::vector<cv::Mat> rest_images(missing_images.begin() + 1, missing_images.end());
+                std::vector<std::unique_ptr<FeatureDetector>> rest_detectors(
+                    std::make_move_iterator(detectors.begin() + 1), std::make_move_iterator(detectors.end()));
+                detected = detectFeatures(rest_images, rest_detectors);
+                detected.insert(detected.begin(), std::move(first));
+            } else {
+                detected = detectFeatures(missing_images, detectors);
+            }
+        }
+        if (options.profiler) {
+            // Detectors report description separately; it is part of "detect".
+            // Summed over images, so with parallel detection it is CPU time
+            // and can exceed the "detect" wall time.
+            double describe_ms = 0.0;
+            for (const auto& result : detected) {
+                describe_ms += result.description_time_ms;
+            }
+            options.profiler->record("describe", describe_ms);
+        }
+        for (size_t j = 0; j < missing.size(); j++) {
+            features[missing[j]] = std::move(detected[j]);
+            if (cache.enabled()) {
+                cache.storeFeatures(keys[missing[j]], features[missing[j]]);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < features.size(); i++) {
+        std::cout << "Detected " << features[i].getKeypointCount() << " keypoints (image " << (i + 1) << ")\n";
+    }
+
+    return features;
+}
+
+bool StitchingPipeline::performTiledStitching(
+    const std::vector<cv::Mat>& images,
+    const std::string& output_dir,
+    const StitchingOptions& requested_options
+) {
+    std::cout << "\n=== Using tiled output ===\n";
+
+    if (images.size() < 2) {
+        std::cerr << "Error: Tiled stitching needs at least two images\n";
+        return false;
+    }
+
+    if (!validateImages(images)) {
+        return false;
+    }
+
+    StitchingOptions options = sanitizeOptions(requested_options);
+
+    if (options.projection != "plane") {
+        std::vector<cv::Mat> projected = projectInputs(images, options);
+        if (projected.empty()) {
+            return false;
+        }
+        options.projection = "plane";
+        return performTiledStitching(projected, output_dir, options);
+    }
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+
+    std::vector<cv::Mat> to_reference;
+    size_t first = 0, last = 0, reference_idx = 0;
+    if (!registerToReference(images, options, to_reference, first, last, reference_idx)) {
+        return false;
+    }
+
+    std::vector<cv::Size> sizes;
+    std::vector<cv::Mat> transforms;
+    for (size_t i = first; i <= last; i++) {
+        sizes.push_back(images[i].size());
+        transforms.push_back(to_reference[i]);
+    }
+
+    cv::Rect bounds = HomographyEstimator::calculateOutputBounds(sizes, transforms);
+    cv::Size panorama_size = bounds.size();
+
+    if (panorama_size.width <= 0 || panorama_size.height <= 0) {
+        std::cerr << "Invalid panorama size (negative)" << std::endl;
+        return false;
+    }
+
+    if (panorama_size.width > PanoramaConfig::MAX_TILED_PANORAMA_DIMENSION ||
+        panorama_size.height > PanoramaConfig::MAX_TILED_PANORAMA_DIMENSION) {
+        std::cerr << "Error: Panorama size would be " << panorama_size.width
+                  << "x" << panorama_size.height << " pixels (max: "
+                  << PanoramaConfig::MAX_TILED_PANORAMA_DIMENSION << ")\n";
+        return false;
+    }
+
+    cv::Mat translation = (cv::Mat_<double>(3, 3) <<
+        1, 0, -bounds.x,
+        0, 1, -bounds.y,
+        0, 0, 1);
+
+    std::unique_ptr<Blender> blender = createBlender(options);
+    std::vector<size_t> order = compositingOrder(reference_idx, first, last);
+
+    std::vector<cv::Mat> placed(images.size());
+    for (size_t idx : order) {
+        placed[idx] = translation * to_reference[idx];
+    }
+    std::vector<double> gains = compensationGains(images, placed, panorama_size, options);
+
+    try {
+        TiledCanvas canvas(panorama_size, CV_8UC3);
+        TiledCanvas coverage(panorama_size, CV_8UC1);
+        TilePyramidWriter writer(output_dir, panorama_size, CV_8UC3, canvas.tileSize());
+
+        const int tile_size = canvas.tileSize();
+        const cv::Size grid = canvas.gridSize();
+
+        // A tile is final once no later image reaches it, so it can be
+        // written out and dropped from the canvas right away.
+        std::vector<cv::Rect> footprints;
+        std::vector<int> remaining(static_cast<size_t>(grid.width) * grid.height, 0);
+        for (size_t idx : order) {
+            cv::Rect rect = ImageWarper::footprintRect(images[idx].size(), placed[idx], panorama_size);
+            footprints.push_back(rect);
+            if (rect.empty()) continue;
+
+            for (int ty = rect.y / tile_size; ty <= (rect.br().y - 1) / tile_size; ty++) {
+                for (int tx = rect.x / tile_size; tx <= (rect.br().x - 1) / tile_size; tx++) {
+                    remaining[ty * grid.width + tx]++;
+                }
+            }
+        }
+
+        std::cout << "Warping and blending " << order.size() << " images into "
+                  << panorama_size.width << "x" << panorama_size.height << " canvas ("
+                  << grid.width << "x" << grid.height << " tiles)...\n";
+
+        ImageWarper warper;
+        for (size_t k = 0; k < order.size(); k++) {
+            size_t idx = order[k];
+            warper.setGain(gains[idx]);
+            WarpedImage warped = warper.warpToFootprint(images[idx], placed[idx], panorama_size);
+
+            if (!warped.empty()) {
+                cv::Mat existing_mask = coverage.read(warped.roi);
+
+                if (cv::countNonZero(existing_mask) == 0) {
+                    canvas.write(warped.roi, warped.image);
+                    coverage.write(warped.roi, warped.mask);
+                } else {
+                    cv::Mat existing = canvas.read(warped.roi);
+                    cv::Mat blended = blender->blend(existing, warped.image, existing_mask, warped.mask);
+                    if (blended.empty()) {
+                        std::cerr << "Error: Blending failed for image " << (idx + 1) << "\n";
+                        return false;
+                    }
+
+                    cv::bitwise_or(existing_mask, warped.mask, existing_mask);
+                    canvas.write(warped.roi, blended);
+                    coverage.write(warped.roi, existing_mask);
+                }
+            }
+
+            const cv::Rect& rect = footprints[k];
+            if (rect.empty()) continue;
+
+            for (int ty = rect.y / tile_size; ty <= (rect.br().y - 1) / tile_size; ty++) {
+                for (int tx = rect.x / tile_size; tx <= (rect.br().x - 1) / tile_size; tx++) {
+                    if (--remaining[ty * grid.width + tx] == 0) {
+                        writer.writeTile(tx, ty, canvas.readTile(tx, ty));
+                        canvas.releaseTile(tx, ty);
+                        coverage.releaseTile(tx, ty);
+                    }
+                }
+            }
+        }
+
+        if (canvas.spilledTiles() > 0) {
+            std::cout << "Spilled " << canvas.spilledTiles() << " canvas tiles to disk\n";
+        }
+
+        if (!writer.finish()) {
+            std::cerr << "Error: Could not write tile pyramid to " << output_dir << "\n";
+            return false;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Tiled stitching failed: " << e.what() << "\n";
+        return false;
+    }
+
+    auto end_time = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+    std::cout << "Panorama created successfully!\n";
+    std::cout << "Total time: " << duration.count() << " ms\n";
+
+    return true;
+}
+
+std::vector<DetectionResult> StitchingPipeline::detectFeatures(
+    const std::vector<cv::Mat>& images,
+    const std::vector<std::unique_ptr<FeatureDetector>>& detectors
+) {
+    std::vector<DetectionResult> results(images.size());
+    ThreadPool& pool = threadPool();
+
+    if (images.size() < 2 || pool.size() < 2 || pool.isWorkerThread()) {
+        for (size_t i = 0; i < images.size(); i++) {
+            results[i] = detectors[i]->detect(images[i]);
+        }
+        return results;
+    }
+
+    std::vector<std::future<DetectionResult>> pending;
+    pending.reserve(images.size());
+    for (size_t i = 0; i < images.size(); i++) {
+        FeatureDetector* detector = detectors[i].get();
+        const cv::Mat& image = images[i];
+        pending.push_back(pool.submit([detector, &image]() { return detector->detect(image); }));
+    }
+
+    std::exception_ptr failure;
+    for (size_t i = 0; i < pending.size(); i++) {
+        try {
+            results[i] = pending[i].get();
+        } catch (...) {
+            if (!failure) {
+                failure = std::current_exception();
+            }
+        }
+    }
+
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+
+    return results;
+}
+
+ThreadPool& StitchingPipeline::threadPool() {
+    static ThreadPool pool;
+    return pool;
+}
+
+cv::Mat StitchingPipeline::registerPair(
+    const DetectionResult& features1,
+    const DetectionResult& features2,
+    const StitchingOptions& options,
+    std::vector<cv::DMatch>* inliers
+) {
+    ResultCache cache(pairCacheDir(options));
+    std::string cache_key;
+    if (cache.enabled()) {
+        cache_key = ResultCache::pairKey(features1, features2, registrationSettings(options));
+        PairRegistration cached;
+        if (cache.loadPair(cache_key, cached)) {
+            std::cout << "Using cached registration (" << cached.inliers.size() << " inliers)\n";
+            if (inliers) {
+                *inliers = std::move(cached.inliers);
+            }
+            return cached.homography;
+        }
+    }
+
+    MatchingResult match_result = matchPair(features1, features2, options);
+
+    std::cout << "Found " << match_result.num_good_matches << " good matches\n";
+
+    std::vector<cv::DMatch> inlier_matches;
+    cv::Mat homography = estimatePair(features1, features2, match_result, options, &inlier_matches);
+
+    if (cache.enabled() && !homography.empty()) {
+        cache.storePair(cache_key, {homography, match_result.good_matches,
+                                    match_result.match_ratios, inlier_matches});
+    }
+
+    if (inliers) {
+        *inliers = std::move(inlier_matches);
+    }
+    return homography;
+}
+
+std::string StitchingPipeline::pairCacheDir(const StitchingOptions& options) {
+    return options.cache_registrations ? options.cache_dir : std::string();
+}
+
+std::string StitchingPipeline::registrationSettings(const StitchingOptions& options) {
+    std::ostringstream settings;
+    settings << "ratio=0.75;estimator=" << options.estimator_backend
+             << ";ransac=" << options.ransac_threshold
+             << ";ann=" << options.ann_checks;
+    return settings.str();
+}
+
+MatchingResult StitchingPipeline::matchPair(
+    const DetectionResult& features1,
+    const DetectionResult& features2,
+    const StitchingOptions& options,
+    const MatchingPrior* prior
+) {
+    FeatureMatcher matcher;
+    if (options.detector_type == "sift") {
+        matcher.setMatcherType("BruteForce-L2");
+    } else {
+        matcher.setMatcherType("HammingSIMD");
+    }
+
+    MatchingResult result;
+    {
+        StageProfiler::Scope timer(options.profiler, "match");
+        if (prior) {
+            result = matcher.matchFeaturesGuided(
+                features1.descriptors, features2.descriptors,
+                features1.keypoints, features2.keypoints,
+                *prior, 0.75
+            );
+        } else if (useDescriptorIndex(features2, options)) {
+            DescriptorIndex index(features2.descriptors, PanoramaConfig::ANN_KDTREE_TREES, options.ann_checks);
+            result = matcher.matchFeatures(
+                features1.descriptors, index,
+                features1.keypoints, features2.keypoints,
+                0.75
+            );
+        } else {
+            result = matcher.matchFeatures(
+                features1.descriptors, features2.descriptors,
+                features1.keypoints, features2.keypoints,
+                0.75
+            );
+        }
+    }
+
+    // The ratio test runs inside the matcher, so it is part of "match".
+    if (options.profiler) {
+        options.profiler->record("ratio_test", result.filtering_time_ms);
+    }
+
+    return result;
+}
+
+bool StitchingPipeline::useDescriptorIndex(const DetectionResult& features, const StitchingOptions& options) {
+    return options.ann_checks > 0 && features.descriptors.depth() == CV_32F;
+}
+
+cv::Mat StitchingPipeline::registerPairIndexed(
+    const std::vector<DetectionResult>& features,
+    size_t i,
+    std::vector<std::unique_ptr<DescriptorIndex>>& indexes,
+    const StitchingOptions& options
+) {
+    // Image i keeps the index built when it was the train side of the
+    // previous pair; querying it from image i + 1 and swapping the matches
+    // halves the number of indexes that have to be built.
+    bool reversed = indexes[i] != nullptr;
+    size_t query = reversed ? i + 1 : i;
+    size_t train = reversed ? i : i + 1;
+
+    // Same key as registerPair, whose settings include ann_checks.
+    ResultCache cache(pairCacheDir(options));
+    std::string cache_key;
+    if (cache.enabled()) {
+        cache_key = ResultCache::pairKey(features[i], features[i + 1], registrationSettings(options));
+        PairRegistration cached;
+        if (cache.loadPair(cache_key, cached)) {
+            std::cout << "Using cached registration (" << cached.inliers.size() << " inliers)\n";
+            indexes[i].reset();
+            return cached.homography;
+        }
+    }
+
+    if (!indexes[train]) {
+        indexes[train] = std::make_unique<DescriptorIndex>(
+            features[train].descriptors, PanoramaConfig::ANN_KDTREE_TREES, options.ann_checks);
+    }
+
+    FeatureMatcher matcher;
+    MatchingResult match_result;
+    {
+        StageProfiler::Scope timer(options.profiler, "match");
+        match_result = matcher.matchFeatures(
+            features[query].descriptors, *indexes[train],
+            features[query].keypoints, features[train].keypoints,
+            0.75
+        );
+    }
+    if (options.profiler) {
+        options.profiler->record("ratio_test", match_result.filtering_time_ms);
+    }
+
+    std::cout << "Found " << match_result.num_good_matches << " good matches (index build "
+              << match_result.index_build_time_ms << " ms, query "
+              << match_result.index_query_time_ms << " ms)\n";
+
+    if (reversed) {
+        for (auto& match : match_result.good_matches) {
+            std::swap(match.queryIdx, match.trainIdx);
+        }
+        indexes[i].reset();
+    }
+
+    std::vector<cv::DMatch> inlier_matches;
+    cv::Mat homography = estimatePair(features[i], features[i + 1], match_result, options, &inlier_matches);
+
+    if (cache.enabled() && !homography.empty()) {
+        cache.storePair(cache_key, {homography, match_result.good_matches,
+                                    match_result.match_ratios, inlier_matches});
+    }
+
+    return homography;
+}
+
+cv::Mat StitchingPipeline::estimatePair(
+    const DetectionResult& features1,
+    const DetectionResult& features2,
+    const MatchingResult& match_result,
+    const StitchingOptions& options,
+    std::vector<cv::DMatch>* inliers
+) {
+    HomographyEstimator h_estimator;
+    h_estimator.setRANSACThreshold(options.ransac_threshold);
+    h_estimator.setBackend(HomographyEstimator::stringToBackend(options.estimator_backend));
+
+    std::vector<cv::DMatch> inlier_matches;
+    cv::Mat homography;
+    {
+        StageProfiler::Scope timer(options.profiler, "ransac");
+        homography = h_estimator.estimateHomography(
+            features1.keypoints, features2.keypoints,
+            match_result.good_matches, match_result.match_ratios, inlier_matches
+        );
+    }
+
+    if (!validateHomography(homography, h_estimator.getLastResult().num_inliers)) {
+        return cv::Mat();
+    }
+
+    if (inliers) {
+        *inliers = std::move(inlier_matches);
+    }
+
+    return homography;
+}
+
+double StitchingPipeline::proxyScale(const cv::Size& size, const StitchingOptions& options) {
+    double pixels = static_cast<double>(size.width) * size.height;
+    if (!options.coarse_to_fine || pixels <= options.proxy_max_pixels) {
+        return 1.0;
+    }
+    return std::sqrt(options.proxy_max_pixels / pixels);
+}
+
+std::vector<cv::Mat> StitchingPipeline::makeProxies(
+    const std::vector<cv::Mat>& images,
+    const StitchingOptions& options,
+    std::vector<double>& scales
+) {
+    std::vector<cv::Mat> proxies;
+    scales.clear();
+
+    for (const auto& image : images) {
+        double scale = proxyScale(image.size(), options);
+        scales.push_back(scale);
+
+        if (scale >= 1.0) {
+            proxies.push_back(image);
+            continue;
+        }
+
+        cv::Mat proxy;
+        cv::resize(image, proxy, cv::Size(), scale, scale, cv::INTER_AREA);
+        proxies.push_back(proxy);
+    }
+
+    return proxies;
+}
+
+cv::Mat StitchingPipeline::registerCoarseToFine(
+    const cv::Mat& img1,
+    const DetectionResult& proxy1,
+    double scale1,
+    const cv::Mat& img2,
+    const DetectionResult& proxy2,
+    double scale2,
+    const StitchingOptions& options
+) {
+    ResultCache cache(pairCacheDir(options));
+    std::string cache_key;
+    if (cache.enabled()) {
+        std::ostringstream settings;
+        settings << registrationSettings(options) << ";refine=" << scale1 << "," << scale2
+                 << ";features=" << options.max_features << "," << options.uniform_keypoints;
+        cache_key = ResultCache::pairKey(proxy1, proxy2, settings.str());
+        PairRegistration cached;
+        if (cache.loadPair(cache_key, cached)) {
+            std::cout << "Using cached coarse-to-fine registration\n";
+            return cached.homography;
+        }
+    }
+
+    cv::Mat homography = refineProxyRegistration(img1, proxy1, scale1, img2, proxy2, scale2, options);
+
+    if (cache.enabled() && !homography.empty()) {
+        PairRegistration entry;
+        entry.homography = homography;
+        cache.storePair(cache_key, entry);
+    }
+    return homography;
+}
+
+cv::Mat StitchingPipeline::refineProxyRegistration(
+    const cv::Mat& img1,
+    const DetectionResult& proxy1,
+    double scale1,
+    const cv::Mat& img2,
+    const DetectionResult& proxy2,
+    double scale2,
+    const StitchingOptions& options
+) {
+    std::vector<cv::DMatch> proxy_inliers;
+    cv::Mat proxy_homography = registerPair(proxy1, proxy2, options, &proxy_inliers);
+    if (proxy_homography.empty()) {
+        return cv::Mat();
+    }
+
+    cv::Mat to_proxy1 = (cv::Mat_<double>(3, 3) << scale1, 0, 0, 0, scale1, 0, 0, 0, 1);
+    cv::Mat from_proxy2 = (cv::Mat_<double>(3, 3) << 1.0 / scale2, 0, 0, 0, 1.0 / scale2, 0, 0, 0, 1);
+    cv::Mat coarse = from_proxy2 * proxy_homography * to_proxy1;
+
+    if (scale1 >= 1.0 && scale2 >= 1.0) {
+        return coarse;
+    }
+
+    // Full-resolution features are only detected in small patches around the
+    // best proxy inliers and only matches consistent with the coarse model
+    // are kept for the final estimate.
+    std::sort(proxy_inliers.begin(), proxy_inliers.end(),
+              [](const cv::DMatch& a, const cv::DMatch& b) { return a.distance < b.distance; });
+    if (proxy_inliers.size() > static_cast<size_t>(PanoramaConfig::REFINE_MAX_ANCHORS)) {
+        proxy_inliers.resize(PanoramaConfig::REFINE_MAX_ANCHORS);
+    }
+
+    int radius1 = cvRound(PanoramaConfig::REFINE_PATCH_RADIUS / scale1);
+    int radius2 = cvRound(PanoramaConfig::REFINE_PATCH_RADIUS / scale2);
+    cv::Mat mask1 = cv::Mat::zeros(img1.size(), CV_8UC1);
+    cv::Mat mask2 = cv::Mat::zeros(img2.size(), CV_8UC1);
+    for (const auto& match : proxy_inliers) {
+        cv::Point2f p1 = proxy1.keypoints[match.queryIdx].pt * (1.0 / scale1);
+        cv::Point2f p2 = proxy2.keypoints[match.trainIdx].pt * (1.0 / scale2);
+        cv::circle(mask1, p1, radius1, cv::Scalar(255), cv::FILLED);
+        cv::circle(mask2, p2, radius2, cv::Scalar(255), cv::FILLED);
+    }
+
+    int refine_features = std::min(options.max_features,
+                                   static_cast<int>(proxy_inliers.size()) * PanoramaConfig::REFINE_FEATURES_PER_ANCHOR);
+
+    DetectionResult fine1, fine2;
+    try {
+        auto detector = DetectorFactory::createDetector(options.detector_type);
+        detector->setMaxFeatures(refine_features);
+        detector->setUniformSelection(options.uniform_keypoints);
+        fine1 = detector->detectInRegion(img1, mask1);
+        fine2 = detector->detectInRegion(img2, mask2);
+    } catch (const std::exception& e) {
+        std::cerr << "Error creating detector: " << e.what() << "\n";
+        return coarse;
+    }
+
+    std::cout << "Refining with " << fine1.getKeypointCount() << " / " << fine2.getKeypointCount()
+              << " full-resolution keypoints near " << proxy_inliers.size() << " proxy inliers\n";
+
+    if (fine1.keypoints.empty() || fine2.keypoints.empty()) {
+        return coarse;
+    }
+
+    MatchingResult fine_matches = matchPair(fine1, fine2, options);
+
+    std::vector<cv::Point2f> points1, predicted;
+    points1.reserve(fine_matches.good_matches.size());
+    for (const auto& match : fine_matches.good_matches) {
+        points1.push_back(fine1.keypoints[match.queryIdx].pt);
+    }
+    if (!points1.empty()) {
+        cv::perspectiveTransform(points1, predicted, coarse);
+    }
+
+    MatchingResult consistent = fine_matches;
+    consistent.good_matches.clear();
+    consistent.match_ratios.clear();
+    double max_offset_sq = static_cast<double>(radius2) * radius2;
+    for (size_t i = 0; i < fine_matches.good_matches.size(); i++) {
+        cv::Point2f offset = fine2.keypoints[fine_matches.good_matches[i].trainIdx].pt - predicted[i];
+        if (offset.dot(offset) <= max_offset_sq) {
+            consistent.good_matches.push_back(fine_matches.good_matches[i]);
+            if (i < fine_matches.match_ratios.size()) {
+                consistent.match_ratios.push_back(fine_matches.match_ratios[i]);
+            }
+        }
+    }
+    consistent.num_good_matches = static_cast<int>(consistent.good_matches.size());
+
+    if (consistent.num_good_matches < PanoramaConfig::MIN_INLIERS_REQUIRED * 2) {
+        std::cout << "Too few full-resolution matches (" << consistent.num_good_matches
+                  << "), keeping proxy homography\n";
+        return coarse;
+    }
+
+    cv::Mat refined = estimatePair(fine1, fine2, consistent, options, nullptr);
+    if (refined.empty()) {
+        std::cout << "Full-resolution refinement failed, keeping proxy homography\n";
+        return coarse;
+    }
+
+    return refined;
+}
+
+std::unique_ptr<Blender> StitchingPipeline::createBlender(const StitchingOptions& options) {
+    std::unique_ptr<Blender> blender;
+    try {
+        blender = BlenderFactory::createBlender(options.blend_mode);
+    } catch (const std::exception& e) {
+        std::cerr << "Error creating blender: " << e.what() << "\n";
+        std::cerr << "Falling back to feathering blend mode\n";
+        blender = BlenderFactory::createBlender(BlendMode::FEATHERING);
+    }
+    blender->setMemoryBudget(static_cast<size_t>(options.blend_memory_mb) * 1048576);
+    blender->setUseOpenCL(options.opencl);
+
+    return blender;
+}
+
+StitchingOptions StitchingPipeline::sanitizeOptions(const StitchingOptions& options) {
+    StitchingOptions sanitized = options;
+
+    if (sanitized.ransac_threshold <= 0 || sanitized.ransac_threshold > PanoramaConfig::MAX_RANSAC_THRESHOLD) {
+        std::cerr << "Warning: Invalid RANSAC threshold, using default " << PanoramaConfig::DEFAULT_RANSAC_THRESHOLD << "\n";
+        sanitized.ransac_threshold = PanoramaConfig::DEFAULT_RANSAC_THRESHOLD;
+    }
+
+    if (sanitized.max_features < PanoramaConfig::MIN_FEATURES || sanitized.max_features > PanoramaConfig::MAX_FEATURES) {
+        std::cerr << "Warning: Invalid max_features, using default " << PanoramaConfig::DEFAULT_MAX_FEATURES << "\n";
+        sanitized.max_features = PanoramaConfig::DEFAULT_MAX_FEATURES;
+    }
+
+    if (sanitized.proxy_max_pixels <= 0) {
+        sanitized.proxy_max_pixels = PanoramaConfig::PROXY_MAX_PIXELS;
+    }
+
+    if (sanitized.ann_checks < 0 || sanitized.ann_checks > PanoramaConfig::MAX_ANN_CHECKS) {
+        std::cerr << "Warning: Invalid ANN checks, using exact matching\n";
+        sanitized.ann_checks = 0;
+    }
+
+    try {
+        ImageWarper::stringToProjection(sanitized.projection);
+    } catch (const std::invalid_argument&) {
+        std::cerr << "Warning: Unknown projection '" << sanitized.projection << "', using plane\n";
+        sanitized.projection = "plane";
+    }
+
+    if (sanitized.focal_length < 0 || !std::isfinite(sanitized.focal_length)) {
+        sanitized.focal_length = 0.0;
+    }
+
+    if (!(sanitized.keyframe_overlap >= PanoramaConfig::MIN_KEYFRAME_OVERLAP &&
+          sanitized.keyframe_overlap <= PanoramaConfig::MAX_KEYFRAME_OVERLAP)) {
+        sanitized.keyframe_overlap = PanoramaConfig::VIDEO_KEYFRAME_OVERLAP;
+    }
+
+    if (sanitized.opencl && !cv::ocl::useOpenCL()) {
+        std::cerr << "Warning: No OpenCL device available, warping and blending on the CPU\n";
+        sanitized.opencl = false;
+    }
+
+    try {
+        HomographyEstimator::stringToBackend(sanitized.estimator_backend);
+    } catch (const std::invalid_argument&) {
+        std::cerr << "Warning: Unknown estimator backend '" << sanitized.estimator_backend << "', using opencv\n";
+        sanitized.estimator_backend = "opencv";
+    }
+
+    return sanitized;
+}
+
+bool StitchingPipeline::validateImages(const std::vector<cv::Mat>& images) {
+    for (size_t i = 0; i < images.size(); i++) {
+        if (images[i].empty()) {
+            std::cerr << "Error: Image " << (i + 1) << " is empty\n";
+            return false;
+        }
+        if (images[i].type() != CV_8UC3) {
+            std::cerr << "Error: Input images must be 8-bit 3-channel (BGR)\n";
+            return false;
+        }
+        if (images[i].cols < PanoramaConfig::MIN_IMAGE_DIMENSION || images[i].rows < PanoramaConfig::MIN_IMAGE_DIMENSION) {
+            std::cerr << "Error: Images too small (minimum " << PanoramaConfig::MIN_IMAGE_DIMENSION << "x" << PanoramaConfig::MIN_IMAGE_DIMENSION << " pixels)\n";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool StitchingPipeline::validateHomography(const cv::Mat& homography, int num_inliers) {
+    if (homography.empty()) {
+        std::cerr << "Failed to compute homography\n";
+        return false;
+    }
+
+    for (int i = 0; i < homography.rows; i++) {
+        for (int j = 0; j < homography.cols; j++) {
+            double val = homography.at<double>(i, j);
+            if (std::isnan(val) || std::isinf(val)) {
+                std::cerr << "Error: Invalid homography matrix (contains NaN or Inf)\n";
+                return false;
+            }
+        }
+    }
+
+    double det = cv::determinant(homography);
+    if (std::abs(det) < PanoramaConfig::MIN_HOMOGRAPHY_DETERMINANT || std::abs(det) > PanoramaConfig::MAX_HOMOGRAPHY_DETERMINANT) {
+        std::cerr << "Error: Homography determinant out of reasonable range: " << det << std::endl;
+        std::cerr << "This indicates poor feature matches or incompatible images\n";
+        std::cerr << "Try: 1) Using ORB detector instead of AKAZE\n";
+        std::cerr << "     2) Ensuring images have sufficient overlap (30-40%)\n";
+        std::cerr << "     3) Increasing max_features for better matching\n";
+        return false;
+    }
+
+    cv::Mat H_normalized = homography.clone();
+    double h22 = H_normalized.at<double>(2, 2);
+    if (std::abs(h22) < 1e-10) {
+        std::cerr << "Error: Homography matrix is singular (H[2,2] = " << h22 << ")\n";
+        return false;
+    }
+    H_normalized /= h22;
+
+    double scale_x = std::sqrt(H_normalized.at<double>(0,0) * H_normalized.at<double>(0,0) +
+                               H_normalized.at<double>(1,0) * H_normalized.at<double>(1,0));
+    double scale_y = std::sqrt(H_normalized.at<double>(0,1) * H_normalized.at<double>(0,1) +
+                               H_normalized.at<double>(1,1) * H_normalized.at<double>(1,1));
+
+    if (scale_x < PanoramaConfig::MIN_HOMOGRAPHY_SCALE || scale_x > PanoramaConfig::MAX_HOMOGRAPHY_SCALE ||
+        scale_y < PanoramaConfig::MIN_HOMOGRAPHY_SCALE || scale_y > PanoramaConfig::MAX_HOMOGRAPHY_SCALE) {
+        std::cerr << "Error: Homography implies extreme scaling (x=" << scale_x << ", y=" << scale_y << ")\n";
+        std::cerr << "Images may not be from the same scene or have insufficient overlap\n";
+        return false;
+    }
+
+    if (num_inliers < PanoramaConfig::MIN_INLIERS_REQUIRED) {
+        std::cerr << "Error: Too few inliers (" << num_inliers << ") for reliable stitching\n";
+        std::cerr << "Minimum " << PanoramaConfig::MIN_INLIERS_REQUIRED << " inliers required for stable homography\n";
+        return false;
+    }
+
+    return true;
+}
@@ -3,9 +3,73 @@
 
 #include <opencv2/core.hpp>
 #include <string>
+#include <memory>
 #include <vector>
+#include "../config.h"
+#include "../feature_detection/feature_detector.h"
+#include "../feature_matching/matcher.h"
+#include "diagnostics.h"
+#include "thread_pool.h"
+
+class Blender;
+class BufferPool;
+class FeatureCache;
+class PairVerifier;
+class StageProfiler;
+struct WarpedImage;
+
+struct StitchingOptions {
+    std::string detector_type = "orb";
+    std::string blend_mode = "feather";
+    std::string estimator_backend = "opencv";
+    double ransac_threshold = 3.0;
+    int max_features = PanoramaConfig::DEFAULT_MAX_FEATURES;
+    bool visualize = false;
+    int max_panorama_dimension = PanoramaConfig::MAX_PANORAMA_DIMENSION;
+    int blend_memory_mb = PanoramaConfig::DEFAULT_BLEND_MEMORY_MB;
+    bool coarse_to_fine = false;
+    // Skip full registration of pairs that fail a thumbnail match check.
+    bool quick_reject = false;
+    // Equalise exposure across overlaps before blending.
+    bool gain_compensation = false;
+    // Warp and blend multi-image panoramas on an OpenCL device when one is
+    // available; each input is uploaded once and the result downloaded once.
+    bool opencl = false;
+    // plane, cylindrical or spherical. Non-planar inputs are reprojected
+    // before registration; focal_length 0 estimates it from the images.
+    std::string projection = "plane";
+    double focal_length = 0.0;
+    // Video input: target overlap of consecutive keyframes.
+    double keyframe_overlap = PanoramaConfig::VIDEO_KEYFRAME_OVERLAP;
+    double proxy_max_pixels = PanoramaConfig::PROXY_MAX_PIXELS;
+    bool guided_matching = false;
+    bool uniform_keypoints = true;
+    // > 0 matches float descriptors against a KD-forest visiting this many
+    // leaves per query instead of brute force.
+    int ann_checks = 0;
+    // On-disk cache of features and pair registrations; empty disables it.
+    std::string cache_dir;
+    // False only caches features, e.g. when matching and RANSAC are timed.
+    bool cache_registrations = true;
+    DiagnosticsSink* diagnostics = nullptr;
+    // Receives per-stage timings, allocation peaks and match statistics.
+    StageProfiler* profiler = nullptr;
+};
+
+// Homographies that place each input of a pairwise stitch into the
+// resulting panorama canvas.
+struct PanoramaPlacement {
+    cv::Mat transform1;
+    cv::Mat transform2;
+};
 
 class StitchingPipeline {
+    // Sessions reuse the registration and compositing helpers below with
+    // their own long-lived components; experiment sweeps run them as
+    // separate, shared stages.
+    friend class StitchingSession;
+    friend class ExperimentRunner;
+
 public:
     static cv::Mat performStitching(
         const std::string& img1_path,
@@ -13,10 +77,16 @@ public:
         const std::string& detector_type = "orb",
         const std::string& blend_mode = "feather",
         double ransac_threshold = 3.0,
-        int max_features = 20000,
+        int max_features = PanoramaConfig::DEFAULT_MAX_FEATURES,
         bool visualize = false
     );
 
+    static cv::Mat performStitching(
+        const std::string& img1_path,
+        const std::string& img2_path,
+        const StitchingOptions& options
+    );
+
     static cv::Mat performStitchingDirect(
         const cv::Mat& img1,
         const cv::Mat& img2,
@@ -28,6 +98,12 @@ public:
         int max_panorama_dimension
     );
 
+    static cv::Mat performStitchingDirect(
+        const cv::Mat& img1,
+        const cv::Mat& img2,
+        const StitchingOptions& options
+    );
+
     static cv::Mat performSequentialStitching(
         const std::vector<cv::Mat>& images,
         const std::string& detector_type,
@@ -37,9 +113,257 @@ public:
         bool visualize
     );
 
+    static cv::Mat performSequentialStitching(
+        const std::vector<cv::Mat>& images,
+        const StitchingOptions& options
+    );
+
+    static cv::Mat performGlobalStitching(
+        const std::vector<cv::Mat>& images,
+        const StitchingOptions& options
+    );
+
+    // Images in any order. Every pair is screened on thumbnails in parallel
+    // and only the survivors are registered; images are then placed along
+    // the maximum spanning tree of the inlier-weighted match graph, rooted
+    // at the best connected image. Images the tree cannot reach are dropped.
+    static cv::Mat performUnorderedStitching(
+        const std::vector<cv::Mat>& images,
+        const StitchingOptions& options
+    );
+
+    // Decodes, detects, registers and composites on separate threads joined
+    // by bounded queues, so only a few frames are decoded at any time. The
+    // first image is the reference and each frame is registered to the
+    // previous one.
+    static cv::Mat performStreamingStitching(
+        const std::vector<std::string>& image_paths,
+        const StitchingOptions& options
+    );
+
+    // Panorama from a video or image sequence (anything cv::VideoCapture
+    // opens, e.g. burst_%03d.jpg). Each frame's motion relative to the last
+    // keyframe is predicted assuming constant velocity; frames are skipped
+    // until the predicted overlap drops to options.keyframe_overlap, and a
+    // keyframe is matched only around its predicted position. Keyframes are
+    // composited as they arrive, so memory follows the canvas size rather
+    // than the frame count.
+    static cv::Mat performVideoStitching(
+        const std::string& source,
+        const StitchingOptions& options
+    );
+
+    // Global registration into a tiled canvas that spills to disk, written
+    // out as a JPEG tile pyramid in output_dir instead of a single image.
+    static bool performTiledStitching(
+        const std::vector<cv::Mat>& images,
+        const std::string& output_dir,
+        const StitchingOptions& options
+    );
+
+    static std::vector<DetectionResult> detectFeatures(
+        const std::vector<cv::Mat>& images,
+        const std::vector<std::unique_ptr<FeatureDetector>>& detectors
+    );
+
+    static ThreadPool& threadPool();
+
     static int calculateAdaptiveFeatures(int image_pixels, int max_features);
 
 private:
+    // Coarse-to-fine stitch that detects on proxies decoded at reduced
+    // resolution and decodes the full colour images afterwards.
+    static cv::Mat stitchFromProxyFiles(
+        const std::string& img1_path,
+        cv::Size size1,
+        const std::string& img2_path,
+        cv::Size size2,
+        const StitchingOptions& options
+    );
+
+    static cv::Mat stitchWithFeatures(
+        const cv::Mat& img1,
+        const DetectionResult& result1,
+        const cv::Mat& img2,
+        const DetectionResult& result2,
+        const StitchingOptions& options,
+        PanoramaPlacement* placement,
+        const MatchingPrior* prior = nullptr
+    );
+
+    // Predicts where image `index` lands on the panorama from its placed
+    // neighbour `index - step`, assuming the motion from `index - 2 * step`
+    // to the neighbour repeats. Without that second image only the
+    // neighbour's footprint is used as an overlap hint.
+    static MatchingPrior sequentialPrior(
+        const FeatureCache& cache,
+        const std::vector<cv::Mat>& images,
+        int index,
+        int step,
+        bool panorama_is_query
+    );
+
+    static std::vector<DetectionResult> detectAll(
+        const std::vector<cv::Mat>& images,
+        const StitchingOptions& options
+    );
+
+    // Thumbnail verifier over all images, or null unless quick_reject is
+    // set.
+    static std::unique_ptr<PairVerifier> makeVerifier(
+        const std::vector<cv::Mat>& images,
+        const StitchingOptions& options
+    );
+
+    // False, with a message, when the verifier rejects images i and j.
+    static bool quickVerify(
+        const PairVerifier& verifier,
+        size_t i,
+        size_t j,
+        const StitchingOptions& options
+    );
+
+    static bool registerToReference(
+        const std::vector<cv::Mat>& images,
+        const StitchingOptions& options,
+        std::vector<cv::Mat>& to_reference,
+        size_t& first,
+        size_t& last,
+        size_t& reference_idx
+    );
+
+    // Registration of unordered inputs. order lists the placed images
+    // breadth-first from the reference along the spanning tree.
+    static bool registerSpanningTree(
+        const std::vector<cv::Mat>& images,
+        const StitchingOptions& options,
+        std::vector<cv::Mat>& to_reference,
+        std::vector<size_t>& order
+    );
+
+    // Warps and blends images[order] into one canvas; order should start
+    // at the reference and grow outwards.
+    static cv::Mat composeToReference(
+        const std::vector<cv::Mat>& images,
+        const std::vector<cv::Mat>& to_reference,
+        const std::vector<size_t>& order,
+        const StitchingOptions& options
+    );
+
+    // Inputs reprojected onto the options' cylinder or sphere; empty on
+    // failure.
+    static std::vector<cv::Mat> projectInputs(
+        const std::vector<cv::Mat>& images,
+        const StitchingOptions& options
+    );
+
+    // Median focal length (pixels) of the rotation-only homographies
+    // between consecutive images, or options.focal_length when set.
+    static double estimateFocal(
+        const std::vector<cv::Mat>& images,
+        const StitchingOptions& options
+    );
+
+    // Per-image exposure gains, all 1 unless gain_compensation is set.
+    static std::vector<double> compensationGains(
+        const std::vector<cv::Mat>& images,
+        const std::vector<cv::Mat>& transforms,
+        const cv::Size& canvas_size,
+        const StitchingOptions& options
+    );
+
+    static std::vector<size_t> compositingOrder(size_t reference_idx, size_t first, size_t last);
+
+    // Blends a warped image into the canvas within its ROI only; false when
+    // the blender fails.
+    static bool blendIntoCanvas(
+        Blender& blender,
+        const WarpedImage& warped,
+        cv::Mat& canvas,
+        cv::Mat& coverage
+    );
+
+    // Without a blender one is created from the options for this call.
+    static cv::Mat composePair(
+        const cv::Mat& img1,
+        const cv::Mat& img2,
+        const cv::Mat& homography,
+        const StitchingOptions& options,
+        PanoramaPlacement* placement,
+        Blender* blender = nullptr,
+        BufferPool* pool = nullptr
+    );
+
+    static cv::Mat registerPair(
+        const DetectionResult& features1,
+        const DetectionResult& features2,
+        const StitchingOptions& options,
+        std::vector<cv::DMatch>* inliers = nullptr
+    );
+
+    static MatchingResult matchPair(
+        const DetectionResult& features1,
+        const DetectionResult& features2,
+        const StitchingOptions& options,
+        const MatchingPrior* prior = nullptr
+    );
+
+    static bool useDescriptorIndex(const DetectionResult& features, const StitchingOptions& options);
+
+    static cv::Mat registerPairIndexed(
+        const std::vector<DetectionResult>& features,
+        size_t i,
+        std::vector<std::unique_ptr<DescriptorIndex>>& indexes,
+        const StitchingOptions& options
+    );
+
+    static cv::Mat estimatePair(
+        const DetectionResult& features1,
+        const DetectionResult& features2,
+        const MatchingResult& match_result,
+        const StitchingOptions& options,
+        std::vector<cv::DMatch>* inliers
+    );
+
+    static double proxyScale(const cv::Size& size, const StitchingOptions& options);
+
+    static std::vector<cv::Mat> makeProxies(
+        const std::vector<cv::Mat>& images,
+        const StitchingOptions& options,
+        std::vector<double>& scales
+    );
+
+    // Registers downscaled proxies, lifts the homography to full resolution
+    // and refines it with features detected around the proxy inliers.
+    static cv::Mat registerCoarseToFine(
+        const cv::Mat& img1,
+        const DetectionResult& proxy1,
+        double scale1,
+        const cv::Mat& img2,
+        const DetectionResult& proxy2,
+        double scale2,
+        const StitchingOptions& options
+    );
+
+    static cv::Mat refineProxyRegistration(
+        const cv::Mat& img1,
+        const DetectionResult& proxy1,
+        double scale1,
+        const cv::Mat& img2,
+        const DetectionResult& proxy2,
+        double scale2,
+        const StitchingOptions& options
+    );
+
+    // Everything besides the features that decides a pair registration;
+    // part of the result cache key.
+    static std::string registrationSettings(const StitchingOptions& options);
+    static std::string pairCacheDir(const StitchingOptions& options);
+
+    static std::unique_ptr<Blender> createBlender(const StitchingOptions& options);
+    static StitchingOptions sanitizeOptions(const StitchingOptions& options);
+    static bool validateImages(const std::vector<cv::Mat>& images);
+    static bool validateHomography(const cv::Mat& homography, int num_inliers);
     static bool validatePanoramaSize(int width, int height);
     static cv::Mat createEmptyPanorama();
 };
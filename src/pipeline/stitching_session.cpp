@@ -0,0 +1,102 @@
+#include "stitching_session.h"
+#include "../feature_detection/detector_factory.h"
+#include <iostream>
+
+StitchingSession::StitchingSession(const StitchingOptions& options)
+    : options_(StitchingPipeline::sanitizeOptions(options)) {
+    // One detector per input so both images can be detected concurrently.
+    for (int i = 0; i < 2; i++) {
+        auto detector = DetectorFactory::createDetector(options_.detector_type);
+        detector->setUniformSelection(options_.uniform_keypoints);
+        detectors_.push_back(std::move(detector));
+    }
+
+    if (options_.detector_type == "sift") {
+        matcher_.setMatcherType("BruteForce-L2");
+    } else {
+        matcher_.setMatcherType("HammingSIMD");
+    }
+
+    estimator_.setRANSACThreshold(options_.ransac_threshold);
+    estimator_.setBackend(HomographyEstimator::stringToBackend(options_.estimator_backend));
+
+    blender_ = StitchingPipeline::createBlender(options_);
+    blender_->setBufferPool(&pool_);
+}
+
+cv::Mat StitchingSession::stitch(const cv::Mat& img1, const cv::Mat& img2, PanoramaPlacement* placement) {
+    if (!StitchingPipeline::validateImages({img1, img2})) {
+        return cv::Mat();
+    }
+
+    size_t total_pixels = static_cast<size_t>(img1.rows) * img1.cols +
+                         static_cast<size_t>(img2.rows) * img2.cols;
+    if (total_pixels > PanoramaConfig::MAX_IMAGE_PIXELS) {
+        std::cerr << "Error: Combined image size exceeds maximum allowed ("
+                  << PanoramaConfig::MAX_IMAGE_PIXELS / 1000000 << " megapixels)\n";
+        return cv::Mat();
+    }
+
+    stitch_count_++;
+
+    std::vector<double> scales;
+    std::vector<cv::Mat> proxies = StitchingPipeline::makeProxies({img1, img2}, options_, scales);
+    configureDetectors(proxies);
+
+    std::vector<DetectionResult> results;
+    try {
+        results = StitchingPipeline::detectFeatures(proxies, detectors_);
+    } catch (const std::exception& e) {
+        std::cerr << "Error detecting features: " << e.what() << "\n";
+        return cv::Mat();
+    }
+
+    cv::Mat homography;
+    if (scales[0] < 1.0 || scales[1] < 1.0) {
+        homography = StitchingPipeline::registerCoarseToFine(img1, results[0], scales[0],
+                                                             img2, results[1], scales[1], options_);
+    } else {
+        homography = registerPair(results[0], results[1]);
+    }
+    if (homography.empty()) {
+        return cv::Mat();
+    }
+
+    return StitchingPipeline::composePair(img1, img2, homography, options_, placement,
+                                          blender_.get(), &pool_);
+}
+
+void StitchingSession::configureDetectors(const std::vector<cv::Mat>& images) {
+    // The detectors only rebuild their OpenCV objects when the budget
+    // actually changes, which stays rare for a fixed camera resolution.
+    for (size_t i = 0; i < images.size(); i++) {
+        detectors_[i]->setMaxFeatures(StitchingPipeline::calculateAdaptiveFeatures(
+            images[i].rows * images[i].cols, options_.max_features));
+    }
+}
+
+cv::Mat StitchingSession::registerPair(const DetectionResult& features1, const DetectionResult& features2) {
+    MatchingResult match_result;
+    if (StitchingPipeline::useDescriptorIndex(features2, options_)) {
+        DescriptorIndex index(features2.descriptors, PanoramaConfig::ANN_KDTREE_TREES, options_.ann_checks);
+        match_result = matcher_.matchFeatures(features1.descriptors, index,
+                                              features1.keypoints, features2.keypoints, 0.75);
+    } else {
+        match_result = matcher_.matchFeatures(features1.descriptors, features2.descriptors,
+                                              features1.keypoints, features2.keypoints, 0.75);
+    }
+
+    std::cout << "Found " << match_result.num_good_matches << " good matches\n";
+
+    std::vector<cv::DMatch> inlier_matches;
+    cv::Mat homography = estimator_.estimateHomography(
+        features1.keypoints, features2.keypoints,
+        match_result.good_matches, match_result.match_ratios, inlier_matches
+    );
+
+    if (!StitchingPipeline::validateHomography(homography, estimator_.getLastResult().num_inliers)) {
+        return cv::Mat();
+    }
+
+    return homography;
+}
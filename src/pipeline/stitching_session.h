@@ -0,0 +1,46 @@
+#ifndef STITCHING_SESSION_H
+#define STITCHING_SESSION_H
+
+#include <opencv2/core.hpp>
+#include <memory>
+#include <vector>
+#include "stitching_pipeline.h"
+#include "../feature_detection/feature_detector.h"
+#include "../feature_matching/matcher.h"
+#include "../homography/homography_estimator.h"
+#include "../stitching/blender.h"
+#include "../stitching/buffer_pool.h"
+
+// Pairwise stitcher for long-running callers. The detectors, matcher,
+// estimator and blender are configured once and kept alive, and canvases,
+// masks and blend scratch buffers are recycled through a BufferPool. The
+// returned panorama is itself a pooled buffer: it goes back to the pool
+// when released, so clone it if it outlives many further stitches.
+// A session is not thread-safe; give each worker thread its own.
+class StitchingSession {
+public:
+    explicit StitchingSession(const StitchingOptions& options = StitchingOptions());
+
+    StitchingSession(const StitchingSession&) = delete;
+    StitchingSession& operator=(const StitchingSession&) = delete;
+
+    cv::Mat stitch(const cv::Mat& img1, const cv::Mat& img2, PanoramaPlacement* placement = nullptr);
+
+    const StitchingOptions& options() const { return options_; }
+    const BufferPool& bufferPool() const { return pool_; }
+    int stitchCount() const { return stitch_count_; }
+
+private:
+    StitchingOptions options_;
+    std::vector<std::unique_ptr<FeatureDetector>> detectors_;
+    FeatureMatcher matcher_;
+    HomographyEstimator estimator_;
+    std::unique_ptr<Blender> blender_;
+    BufferPool pool_;
+    int stitch_count_ = 0;
+
+    void configureDetectors(const std::vector<cv::Mat>& images);
+    cv::Mat registerPair(const DetectionResult& features1, const DetectionResult& features2);
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t num_threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    template<typename Func>
+    auto submit(Func func) -> std::future<std::invoke_result_t<Func>>;
+
+    size_t size() const { return workers_.size(); }
+
+    // True when called from one of this pool's workers. Callers that would
+    // block on their own submissions should run the work inline instead.
+    bool isWorkerThread() const;
+
+private:
+    std::vector<std::thread> workers_;
+    std::queue<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    bool stopping_ = false;
+
+    void workerLoop();
+};
+
+template<typename Func>
+auto ThreadPool::submit(Func func) -> std::future<std::invoke_result_t<Func>> {
+    using ResultType = std::invoke_result_t<Func>;
+
+    auto task = std::make_shared<std::packaged_task<ResultType()>>(std::move(func));
+    std::future<ResultType> future = task->get_future();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.emplace([task]() { (*task)(); });
+    }
+    condition_.notify_one();
+
+    return future;
+}
+
+#endif
@@ -1,8 +1,17 @@
 #include "blender.h"
+#include "buffer_pool.h"
+#include "../config.h"
+#include "../kernels/kernel_dispatch.h"
 #include <opencv2/imgproc.hpp>
+#include <opencv2/core/utility.hpp>
+#include <opencv2/core/ocl.hpp>
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
-Blender::Blender() : blend_mode_(BlendMode::FEATHERING) {}
+Blender::Blender()
+    : blend_mode_(BlendMode::FEATHERING),
+      memory_budget_(static_cast<size_t>(PanoramaConfig::DEFAULT_BLEND_MEMORY_MB) * 1048576) {}
 
 cv::Mat Blender::blend(const cv::Mat& img1, const cv::Mat& img2,
                       const cv::Mat& mask1, const cv::Mat& mask2) {
@@ -10,15 +19,460 @@ cv::Mat Blender::blend(const cv::Mat& img1, const cv::Mat& img2,
         case BlendMode::SIMPLE_OVERLAY:
             return simpleOverlay(img1, img2, mask1, mask2);
         case BlendMode::FEATHERING:
-            return featherBlend(img1, img2, mask1, mask2);
         case BlendMode::MULTIBAND:
-            return multibandBlend(img1, img2, mask1, mask2);
+        case BlendMode::SEAM:
+            return blendOverlap(img1, img2, mask1, mask2);
         default:
             std::cerr << "Unknown blend mode, using simple overlay\n";
             return simpleOverlay(img1, img2, mask1, mask2);
     }
 }
 
+cv::Mat Blender::allocate(const cv::Size& size, int type, bool zeroed) {
+    if (!pool_) {
+        return zeroed ? cv::Mat::zeros(size, type) : cv::Mat(size, type);
+    }
+    return zeroed ? pool_->zeros(size, type) : pool_->acquire(size, type);
+}
+
+cv::Mat Blender::blendOverlap(const cv::Mat& img1, const cv::Mat& img2,
+                              const cv::Mat& mask1, const cv::Mat& mask2) {
+    if (img1.size() != img2.size() || img1.type() != img2.type() ||
+        mask1.size() != img1.size() || mask2.size() != img2.size()) {
+        std::cerr << "Error: Images must have same size and type for blending\n";
+        return cv::Mat();
+    }
+
+    cv::Rect bounds1 = cv::boundingRect(mask1);
+    cv::Rect bounds2 = cv::boundingRect(mask2);
+
+    cv::Mat result = allocate(img1.size(), img1.type(), true);
+    if (!bounds1.empty()) {
+        img1(bounds1).copyTo(result(bounds1), mask1(bounds1));
+    }
+    if (!bounds2.empty()) {
+        img2(bounds2).copyTo(result(bounds2), mask2(bounds2));
+    }
+
+    cv::Rect candidate = bounds1 & bounds2;
+    if (candidate.empty()) {
+        return result;
+    }
+
+    cv::Mat overlap;
+    cv::bitwise_and(mask1(candidate), mask2(candidate), overlap);
+    cv::Rect overlap_rect = cv::boundingRect(overlap);
+    if (overlap_rect.empty()) {
+        return result;
+    }
+    overlap_rect += candidate.tl();
+
+    // The feather weights only see mask edges within the radius, and the
+    // pyramid support roughly doubles per level. A seam never leaves the
+    // overlap.
+    int margin = feather_radius_ + 1;
+    if (blend_mode_ == BlendMode::MULTIBAND) {
+        margin = 2 << num_bands_;
+    } else if (blend_mode_ == BlendMode::SEAM) {
+        margin = 0;
+    }
+    cv::Rect roi(overlap_rect.x - margin, overlap_rect.y - margin,
+                 overlap_rect.width + 2 * margin, overlap_rect.height + 2 * margin);
+    roi &= cv::Rect(0, 0, img1.cols, img1.rows);
+
+    cv::Mat blended;
+    if (blend_mode_ == BlendMode::MULTIBAND) {
+        blended = multibandBlend(img1(roi), img2(roi), mask1(roi), mask2(roi), num_bands_);
+    } else if (blend_mode_ == BlendMode::SEAM) {
+        blended = seamBlend(img1(roi), img2(roi), mask1(roi), mask2(roi));
+    } else {
+        blended = featherBlend(img1(roi), img2(roi), mask1(roi), mask2(roi), feather_radius_);
+    }
+
+    if (blended.empty()) {
+        return cv::Mat();
+    }
+
+    cv::Mat coverage;
+    cv::bitwise_or(mask1(roi), mask2(roi), coverage);
+    blended.copyTo(result(roi), coverage);
+
+    return result;
+}
+
+bool Blender::deviceAccumulation() const {
+    return use_opencl_ && (blend_mode_ == BlendMode::FEATHERING || blend_mode_ == BlendMode::MULTIBAND) &&
+           cv::ocl::useOpenCL();
+}
+
+void Blender::begin(const cv::Size& canvas_size) {
+    canvas_size_ = canvas_size;
+    coverage_ = allocate(canvas_size, CV_8UC1, true);
+    canvas_.release();
+    level_sums_.clear();
+    level_weights_.clear();
+    device_sums_.clear();
+    device_weights_.clear();
+
+    on_device_ = deviceAccumulation();
+    if (on_device_) {
+        int levels = blend_mode_ == BlendMode::MULTIBAND ? num_bands_ : 1;
+        int align = 1 << (levels - 1);
+        cv::Size padded((canvas_size.width + align - 1) / align * align,
+                        (canvas_size.height + align - 1) / align * align);
+        for (int i = 0; i < levels; i++) {
+            cv::Size level(padded.width >> i, padded.height >> i);
+            device_sums_.push_back(cv::UMat(level, CV_32FC3, cv::Scalar::all(0)));
+            device_weights_.push_back(cv::UMat(level, CV_32F, cv::Scalar::all(0)));
+        }
+        return;
+    }
+
+    switch (blend_mode_) {
+        case BlendMode::FEATHERING:
+            level_sums_.push_back(allocate(canvas_size, CV_32FC3, true));
+            level_weights_.push_back(allocate(canvas_size, CV_32F, true));
+            break;
+        case BlendMode::MULTIBAND: {
+            // The pyramid canvas is padded so that every level halves exactly
+            // and per-image ROIs can be aligned to the coarsest level.
+            int align = 1 << (num_bands_ - 1);
+            cv::Size padded((canvas_size.width + align - 1) / align * align,
+                            (canvas_size.height + align - 1) / align * align);
+            for (int i = 0; i < num_bands_; i++) {
+                cv::Size level(padded.width >> i, padded.height >> i);
+                level_sums_.push_back(allocate(level, CV_32FC3, true));
+                level_weights_.push_back(allocate(level, CV_32F, true));
+            }
+            break;
+        }
+        default:
+            canvas_ = allocate(canvas_size, CV_8UC3, true);
+            break;
+    }
+}
+
+bool Blender::validROI(const cv::Size& image_size, int image_type, const cv::Mat& mask,
+                       const cv::Rect& roi) const {
+    if (coverage_.empty()) {
+        std::cerr << "Error: Blender::add called before begin\n";
+        return false;
+    }
+    if (roi.empty()) {
+        return false;
+    }
+    if (image_type != CV_8UC3 || image_size != roi.size() || mask.size() != roi.size() ||
+        (roi & cv::Rect(0, 0, canvas_size_.width, canvas_size_.height)) != roi) {
+        std::cerr << "Error: Blended image must be 8-bit 3-channel and lie inside the canvas\n";
+        return false;
+    }
+    return true;
+}
+
+void Blender::add(const cv::Mat& image, const cv::Mat& mask, const cv::Rect& roi) {
+    if (on_device_) {
+        cv::UMat device_image;
+        image.copyTo(device_image);
+        add(device_image, mask, roi);
+        return;
+    }
+    if (!validROI(image.size(), image.type(), mask, roi)) {
+        return;
+    }
+
+    cv::Mat covered = coverage_(roi);
+
+    switch (blend_mode_) {
+        case BlendMode::FEATHERING:
+            addFeather(image, mask, roi);
+            break;
+        case BlendMode::MULTIBAND:
+            addMultiband(image, mask, roi);
+            break;
+        default:
+            if (cv::countNonZero(covered) == 0) {
+                image.copyTo(canvas_(roi), mask);
+            } else {
+                cv::Mat blended = blend(canvas_(roi), image, covered, mask);
+                if (!blended.empty()) {
+                    blended.copyTo(canvas_(roi));
+                }
+            }
+            break;
+    }
+
+    cv::bitwise_or(covered, mask, covered);
+}
+
+void Blender::add(const cv::UMat& image, const cv::Mat& mask, const cv::Rect& roi) {
+    if (!on_device_) {
+        cv::Mat host_image;
+        image.copyTo(host_image);
+        add(host_image, mask, roi);
+        return;
+    }
+    if (!validROI(image.size(), image.type(), mask, roi)) {
+        return;
+    }
+
+    if (blend_mode_ == BlendMode::MULTIBAND) {
+        addMultibandDevice(image, mask, roi);
+    } else {
+        addFeatherDevice(image, mask, roi);
+    }
+
+    cv::Mat covered = coverage_(roi);
+    cv::bitwise_or(covered, mask, covered);
+}
+
+cv::Mat Blender::finalize() {
+    cv::Mat result;
+    switch (blend_mode_) {
+        case BlendMode::FEATHERING:
+            result = on_device_ ? finalizeFeatherDevice() : finalizeFeather();
+            break;
+        case BlendMode::MULTIBAND:
+            result = on_device_ ? finalizeMultibandDevice() : finalizeMultiband();
+            break;
+        default:
+            result = canvas_;
+            break;
+    }
+
+    canvas_.release();
+    coverage_.release();
+    level_sums_.clear();
+    level_weights_.clear();
+    device_sums_.clear();
+    device_weights_.clear();
+    on_device_ = false;
+
+    return result;
+}
+
+size_t Blender::accumulatorBytes(const cv::Size& canvas_size) const {
+    size_t pixels = static_cast<size_t>(canvas_size.width) * canvas_size.height;
+
+    switch (blend_mode_) {
+        case BlendMode::FEATHERING:
+            // Colour and weight sums, coverage and the 8-bit result.
+            return pixels * (12 + 4 + 1 + 3);
+        case BlendMode::MULTIBAND: {
+            // Sums over all levels (4/3 of the base), plus the float
+            // reconstruction and the result.
+            size_t align = static_cast<size_t>(1) << (num_bands_ - 1);
+            size_t padded = ((canvas_size.width + align - 1) / align * align) *
+                            ((canvas_size.height + align - 1) / align * align);
+            return padded * (16 * 4 / 3 + 24) + pixels * (1 + 3);
+        }
+        default:
+            return pixels * (1 + 3);
+    }
+}
+
+void Blender::addFeather(const cv::Mat& image, const cv::Mat& mask, const cv::Rect& roi) {
+    const bool use_distance = feather_radius_ > 0;
+    cv::Mat dist;
+    if (use_distance) {
+        // A zero border makes the ROI edges count as footprint edges, as
+        // they are on the canvas.
+        cv::Mat padded;
+        cv::copyMakeBorder(mask, padded, 1, 1, 1, 1, cv::BORDER_CONSTANT, cv::Scalar(0));
+        cv::distanceTransform(padded, dist, cv::DIST_L2, 3);
+        dist = dist(cv::Rect(1, 1, mask.cols, mask.rows));
+    }
+
+    const float radius = static_cast<float>(feather_radius_);
+    const KernelTable& kernels = KernelDispatch::active();
+    cv::Mat sums = level_sums_[0](roi);
+    cv::Mat weights = level_weights_[0](roi);
+
+    cv::parallel_for_(cv::Range(0, image.rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; y++) {
+            kernels.feather_accumulate(image.ptr<uchar>(y), mask.ptr<uchar>(y),
+                                       use_distance ? dist.ptr<float>(y) : nullptr,
+                                       image.cols, radius, sums.ptr<float>(y), weights.ptr<float>(y));
+        }
+    });
+}
+
+void Blender::addMultiband(const cv::Mat& image, const cv::Mat& mask, const cv::Rect& roi) {
+    cv::Rect expanded = pyramidRect(roi, level_sums_[0].size());
+
+    cv::Mat source = cv::Mat::zeros(expanded.size(), CV_8UC3);
+    cv::Mat source_mask = cv::Mat::zeros(expanded.size(), CV_8UC1);
+    cv::Rect inner = roi - expanded.tl();
+    image.copyTo(source(inner));
+    mask.copyTo(source_mask(inner));
+
+    std::vector<cv::Mat> pyramid = createLaplacianPyramid(source, num_bands_);
+    source.release();
+
+    cv::Mat level_mask = source_mask;
+    for (int i = 0; i < num_bands_; i++) {
+        if (i > 0) {
+            cv::Mat down;
+            cv::pyrDown(level_mask, down, pyramid[i].size());
+            level_mask = down;
+        }
+
+        cv::Mat weight, weight3;
+        level_mask.convertTo(weight, CV_32F, 1.0 / 255.0);
+        cv::cvtColor(weight, weight3, cv::COLOR_GRAY2BGR);
+
+        cv::Rect level_rect(expanded.x >> i, expanded.y >> i, pyramid[i].cols, pyramid[i].rows);
+        cv::Mat sums = level_sums_[i](level_rect);
+        cv::Mat weights = level_weights_[i](level_rect);
+        cv::accumulateProduct(pyramid[i], weight3, sums);
+        cv::accumulate(weight, weights);
+        pyramid[i].release();
+    }
+}
+
+cv::Rect Blender::pyramidRect(const cv::Rect& roi, const cv::Size& padded) const {
+    // The image is decomposed over its ROI grown by the pyramid reach and
+    // aligned to the coarsest level, so its levels line up with the canvas.
+    const int align = 1 << (num_bands_ - 1);
+    const int margin = 2 << num_bands_;
+
+    int x0 = std::max(0, roi.x - margin) / align * align;
+    int y0 = std::max(0, roi.y - margin) / align * align;
+    int x1 = std::min(padded.width, (roi.x + roi.width + margin + align - 1) / align * align);
+    int y1 = std::min(padded.height, (roi.y + roi.height + margin + align - 1) / align * align);
+    return cv::Rect(x0, y0, x1 - x0, y1 - y0);
+}
+
+cv::Mat Blender::featherWeights(const cv::Mat& mask) const {
+    cv::Mat weights;
+    if (feather_radius_ <= 0) {
+        mask.convertTo(weights, CV_32F, 1.0 / 255.0);
+        return weights;
+    }
+
+    cv::Mat padded, dist;
+    cv::copyMakeBorder(mask, padded, 1, 1, 1, 1, cv::BORDER_CONSTANT, cv::Scalar(0));
+    cv::distanceTransform(padded, dist, cv::DIST_L2, 3);
+    cv::min(dist(cv::Rect(1, 1, mask.cols, mask.rows)), static_cast<double>(feather_radius_), weights);
+    weights *= 1.0 / feather_radius_;
+    return weights;
+}
+
+void Blender::addFeatherDevice(const cv::UMat& image, const cv::Mat& mask, const cv::Rect& roi) {
+    // distanceTransform has no OpenCL kernel, so the weights come from the
+    // host footprint and are uploaded next to the image.
+    cv::UMat weight, weight3, pixels;
+    featherWeights(mask).copyTo(weight);
+    cv::cvtColor(weight, weight3, cv::COLOR_GRAY2BGR);
+    image.convertTo(pixels, CV_32F);
+
+    cv::UMat sums = device_sums_[0](roi);
+    cv::UMat weights = device_weights_[0](roi);
+    cv::accumulateProduct(pixels, weight3, sums);
+    cv::accumulate(weight, weights);
+}
+
+void Blender::addMultibandDevice(const cv::UMat& image, const cv::Mat& mask, const cv::Rect& roi) {
+    cv::Rect expanded = pyramidRect(roi, device_sums_[0].size());
+    cv::Rect inner = roi - expanded.tl();
+
+    cv::UMat source(expanded.size(), CV_8UC3, cv::Scalar::all(0));
+    image.copyTo(source(inner));
+    cv::Mat host_mask = cv::Mat::zeros(expanded.size(), CV_8UC1);
+    mask.copyTo(host_mask(inner));
+
+    cv::UMat level_mask;
+    host_mask.copyTo(level_mask);
+
+    std::vector<cv::UMat> pyramid = createLaplacianPyramid(source, num_bands_);
+    source.release();
+
+    for (int i = 0; i < num_bands_; i++) {
+        if (i > 0) {
+            cv::UMat down;
+            cv::pyrDown(level_mask, down, pyramid[i].size());
+            level_mask = down;
+        }
+
+        cv::UMat weight, weight3;
+        level_mask.convertTo(weight, CV_32F, 1.0 / 255.0);
+        cv::cvtColor(weight, weight3, cv::COLOR_GRAY2BGR);
+
+        cv::Rect level_rect(expanded.x >> i, expanded.y >> i, pyramid[i].cols, pyramid[i].rows);
+        cv::UMat sums = device_sums_[i](level_rect);
+        cv::UMat weights = device_weights_[i](level_rect);
+        cv::accumulateProduct(pyramid[i], weight3, sums);
+        cv::accumulate(weight, weights);
+        pyramid[i].release();
+    }
+}
+
+cv::Mat Blender::finalizeFeatherDevice() {
+    // Uncovered pixels have zero sums, so a tiny denominator leaves them 0.
+    cv::UMat denominator, denominator3, normalized, blended;
+    cv::max(device_weights_[0], 1e-5, denominator);
+    cv::cvtColor(denominator, denominator3, cv::COLOR_GRAY2BGR);
+    cv::divide(device_sums_[0], denominator3, normalized);
+    normalized.convertTo(blended, CV_8UC3);
+
+    cv::Mat result = allocate(canvas_size_, CV_8UC3);
+    blended(cv::Rect(0, 0, canvas_size_.width, canvas_size_.height)).copyTo(result);
+    return result;
+}
+
+cv::Mat Blender::finalizeMultibandDevice() {
+    for (size_t i = 0; i < device_sums_.size(); i++) {
+        cv::UMat denominator, denominator3;
+        cv::max(device_weights_[i], 1e-5, denominator);
+        cv::cvtColor(denominator, denominator3, cv::COLOR_GRAY2BGR);
+        cv::divide(device_sums_[i], denominator3, device_sums_[i]);
+        device_weights_[i].release();
+    }
+
+    cv::UMat reconstructed = reconstructFromPyramid(device_sums_);
+    device_sums_.clear();
+
+    cv::Mat blended;
+    reconstructed(cv::Rect(0, 0, canvas_size_.width, canvas_size_.height)).copyTo(blended);
+
+    cv::Mat result = allocate(canvas_size_, CV_8UC3, true);
+    blended.copyTo(result, coverage_);
+    return result;
+}
+
+cv::Mat Blender::finalizeFeather() {
+    cv::Mat result = allocate(canvas_size_, CV_8UC3);
+    const cv::Mat& sums = level_sums_[0];
+    const cv::Mat& weights = level_weights_[0];
+
+    const KernelTable& kernels = KernelDispatch::active();
+
+    cv::parallel_for_(cv::Range(0, result.rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; y++) {
+            kernels.feather_normalize(sums.ptr<float>(y), weights.ptr<float>(y), result.cols,
+                                      result.ptr<uchar>(y));
+        }
+    });
+
+    return result;
+}
+
+cv::Mat Blender::finalizeMultiband() {
+    for (size_t i = 0; i < level_sums_.size(); i++) {
+        cv::Mat denominator, denominator3;
+        cv::max(level_weights_[i], 1e-5, denominator);
+        cv::cvtColor(denominator, denominator3, cv::COLOR_GRAY2BGR);
+        cv::divide(level_sums_[i], denominator3, level_sums_[i]);
+        level_weights_[i].release();
+    }
+
+    cv::Mat reconstructed = reconstructFromPyramid(level_sums_);
+    level_sums_.clear();
+
+    cv::Mat result = allocate(canvas_size_, CV_8UC3, true);
+    reconstructed(cv::Rect(0, 0, canvas_size_.width, canvas_size_.height)).copyTo(result, coverage_);
+    return result;
+}
+
 cv::Mat Blender::simpleOverlay(const cv::Mat& img1, const cv::Mat& img2,
                               [[maybe_unused]] const cv::Mat& mask1, const cv::Mat& mask2) {
     if (img1.size() != img2.size() || img1.type() != img2.type()) {
@@ -26,7 +480,8 @@ cv::Mat Blender::simpleOverlay(const cv::Mat& img1, const cv::Mat& img2,
         return cv::Mat();
     }
 
-    cv::Mat result = img1.clone();
+    cv::Mat result = allocate(img1.size(), img1.type());
+    img1.copyTo(result);
 
     img2.copyTo(result, mask2);
 
@@ -41,51 +496,176 @@ cv::Mat Blender::featherBlend(const cv::Mat& img1, const cv::Mat& img2,
         return cv::Mat();
     }
 
-    cv::Mat result = cv::Mat::zeros(img1.size(), img1.type());
+    if (img1.type() != CV_8UC3) {
+        std::cerr << "Error: Feather blending expects 8-bit 3-channel images\n";
+        return cv::Mat();
+    }
 
-    cv::Mat weight1, weight2;
+    cv::Mat result = allocate(img1.size(), CV_8UC3);
 
+    cv::Mat dist1, dist2;
     if (feather_radius > 0) {
-        cv::Mat dist1, dist2;
+        dist1 = allocate(img1.size(), CV_32F);
+        dist2 = allocate(img1.size(), CV_32F);
         cv::distanceTransform(mask1, dist1, cv::DIST_L2, 3);
         cv::distanceTransform(mask2, dist2, cv::DIST_L2, 3);
+    }
 
-        dist1 = cv::min(dist1, static_cast<double>(feather_radius)) / feather_radius;
-        dist2 = cv::min(dist2, static_cast<double>(feather_radius)) / feather_radius;
+    const bool use_distance = feather_radius > 0;
+    const float radius = static_cast<float>(feather_radius);
+    const KernelTable& kernels = KernelDispatch::active();
+
+    // Weights are computed and applied per pixel directly on the interleaved
+    // 8-bit data, so the only full-size temporaries are the distance maps.
+    cv::parallel_for_(cv::Range(0, img1.rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; y++) {
+            kernels.feather_blend(img1.ptr<uchar>(y), img2.ptr<uchar>(y),
+                                  mask1.ptr<uchar>(y), mask2.ptr<uchar>(y),
+                                  use_distance ? dist1.ptr<float>(y) : nullptr,
+                                  use_distance ? dist2.ptr<float>(y) : nullptr,
+                                  img1.cols, radius, result.ptr<uchar>(y));
+        }
+    });
 
-        dist1.convertTo(weight1, CV_32F);
-        dist2.convertTo(weight2, CV_32F);
-    } else {
-        mask1.convertTo(weight1, CV_32F, 1.0/255.0);
-        mask2.convertTo(weight2, CV_32F, 1.0/255.0);
+    return result;
+}
+
+cv::Mat Blender::seamBlend(const cv::Mat& img1, const cv::Mat& img2,
+                           const cv::Mat& mask1, const cv::Mat& mask2) {
+    if (img1.size() != img2.size() || img1.type() != img2.type()) {
+        std::cerr << "Error: Images must have same size and type for blending\n";
+        return cv::Mat();
     }
 
-    cv::Mat overlap;
-    cv::bitwise_and(mask1, mask2, overlap);
+    if (img1.type() != CV_8UC3) {
+        std::cerr << "Error: Seam blending expects 8-bit 3-channel images\n";
+        return cv::Mat();
+    }
 
-    cv::Mat weight_sum = weight1 + weight2;
-    cv::Mat zero_mask = (weight_sum == 0);
-    zero_mask.convertTo(zero_mask, CV_32F, 1.0/255.0);
-    weight_sum += zero_mask;
+    double pixels = static_cast<double>(img1.rows) * img1.cols;
+    double scale = std::min(1.0, std::sqrt(PanoramaConfig::SEAM_MAX_PIXELS / pixels));
+    cv::Size small_size(std::max(1, cvRound(img1.cols * scale)), std::max(1, cvRound(img1.rows * scale)));
+
+    cv::Mat small1, small2, small_mask1, small_mask2;
+    cv::resize(img1, small1, small_size, 0, 0, cv::INTER_AREA);
+    cv::resize(img2, small2, small_size, 0, 0, cv::INTER_AREA);
+    cv::resize(mask1, small_mask1, small_size, 0, 0, cv::INTER_NEAREST);
+    cv::resize(mask2, small_mask2, small_size, 0, 0, cv::INTER_NEAREST);
+
+    // The seam runs across the longer side of the overlap; which image lies
+    // on which side of it follows from the centroids of their footprints.
+    cv::Rect overlap_rect = cv::boundingRect(small_mask1 & small_mask2);
+    bool vertical = overlap_rect.height >= overlap_rect.width;
+    cv::Moments m1 = cv::moments(small_mask1, true);
+    cv::Moments m2 = cv::moments(small_mask2, true);
+    if (m1.m00 <= 0 || m2.m00 <= 0) {
+        return simpleOverlay(img1, img2, mask1, mask2);
+    }
+    double c1 = vertical ? m1.m10 / m1.m00 : m1.m01 / m1.m00;
+    double c2 = vertical ? m2.m10 / m2.m00 : m2.m01 / m2.m00;
+    bool img1_before_seam = c1 <= c2;
+
+    cv::Mat diff, cost;
+    cv::absdiff(small1, small2, diff);
+    cv::cvtColor(diff, diff, cv::COLOR_BGR2GRAY);
+    diff.convertTo(cost, CV_32F, 1.0, 1.0);
+    cost.setTo(PanoramaConfig::SEAM_OUTSIDE_COST, ~(small_mask1 & small_mask2));
+    if (!vertical) {
+        cost = cost.t();
+    }
 
-    cv::Mat img1_float, img2_float;
-    img1.convertTo(img1_float, CV_32FC3);
-    img2.convertTo(img2_float, CV_32FC3);
+    // Minimum-cost 8-connected path from the first to the last row. The
+    // energy is accumulated in double: summing SEAM_OUTSIDE_COST over many
+    // rows in float would swamp the intensity differences.
+    const int rows = cost.rows;
+    const int cols = cost.cols;
+    std::vector<double> energy(cost.begin<float>(), cost.end<float>());
+    std::vector<signed char> step(static_cast<size_t>(rows) * cols, 0);
+    for (int y = 1; y < rows; y++) {
+        const double* prev = &energy[static_cast<size_t>(y - 1) * cols];
+        double* cur = &energy[static_cast<size_t>(y) * cols];
+        signed char* from = &step[static_cast<size_t>(y) * cols];
+        for (int x = 0; x < cols; x++) {
+            double best = prev[x];
+            signed char dir = 0;
+            if (x > 0 && prev[x - 1] < best) {
+                best = prev[x - 1];
+                dir = -1;
+            }
+            if (x + 1 < cols && prev[x + 1] < best) {
+                best = prev[x + 1];
+                dir = 1;
+            }
+            cur[x] += best;
+            from[x] = dir;
+        }
+    }
 
-    std::vector<cv::Mat> channels1, channels2, result_channels;
-    cv::split(img1_float, channels1);
-    cv::split(img2_float, channels2);
+    const double* last = &energy[static_cast<size_t>(rows - 1) * cols];
+    int x = static_cast<int>(std::min_element(last, last + cols) - last);
+    std::vector<float> seam(rows);
+    for (int y = rows - 1; y >= 0; y--) {
+        seam[y] = x + 0.5f;
+        x += step[static_cast<size_t>(y) * cols + x];
+    }
 
-    for (int c = 0; c < 3; c++) {
-        cv::Mat weighted1 = channels1[c].mul(weight1);
-        cv::Mat weighted2 = channels2[c].mul(weight2);
-        cv::Mat blended = (weighted1 + weighted2) / weight_sum;
-        result_channels.push_back(blended);
+    // Seam position in full-resolution pixels for every full-resolution
+    // row (or column), interpolated between the downsampled ones.
+    int length = vertical ? img1.rows : img1.cols;
+    float seam_scale = static_cast<float>(vertical ? img1.cols : img1.rows) / cols;
+    float along_scale = static_cast<float>(rows) / length;
+    std::vector<float> seam_full(length);
+    for (int i = 0; i < length; i++) {
+        float t = std::max(0.0f, (i + 0.5f) * along_scale - 0.5f);
+        int i0 = std::min(static_cast<int>(t), rows - 1);
+        int i1 = std::min(i0 + 1, rows - 1);
+        float f = t - i0;
+        seam_full[i] = ((1.0f - f) * seam[i0] + f * seam[i1]) * seam_scale;
     }
 
-    cv::Mat result_float;
-    cv::merge(result_channels, result_float);
-    result_float.convertTo(result, CV_8UC3);
+    cv::Mat result = allocate(img1.size(), CV_8UC3);
+    const float inv_band = 1.0f / std::max(1, seam_band_);
+
+    cv::parallel_for_(cv::Range(0, img1.rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; y++) {
+            const uchar* p1 = img1.ptr<uchar>(y);
+            const uchar* p2 = img2.ptr<uchar>(y);
+            const uchar* m1 = mask1.ptr<uchar>(y);
+            const uchar* m2 = mask2.ptr<uchar>(y);
+            uchar* out = result.ptr<uchar>(y);
+
+            for (int x = 0; x < img1.cols; x++) {
+                float w1;
+                if (m1[x] && m2[x]) {
+                    float offset = vertical ? seam_full[y] - (x + 0.5f) : seam_full[x] - (y + 0.5f);
+                    float before = std::min(1.0f, std::max(0.0f, 0.5f + offset * inv_band));
+                    w1 = img1_before_seam ? before : 1.0f - before;
+                } else if (m1[x]) {
+                    w1 = 1.0f;
+                } else if (m2[x]) {
+                    w1 = 0.0f;
+                } else {
+                    out[3 * x] = out[3 * x + 1] = out[3 * x + 2] = 0;
+                    continue;
+                }
+
+                if (w1 >= 1.0f) {
+                    out[3 * x] = p1[3 * x];
+                    out[3 * x + 1] = p1[3 * x + 1];
+                    out[3 * x + 2] = p1[3 * x + 2];
+                } else if (w1 <= 0.0f) {
+                    out[3 * x] = p2[3 * x];
+                    out[3 * x + 1] = p2[3 * x + 1];
+                    out[3 * x + 2] = p2[3 * x + 2];
+                } else {
+                    float w2 = 1.0f - w1;
+                    for (int c = 0; c < 3; c++) {
+                        out[3 * x + c] = cv::saturate_cast<uchar>(p1[3 * x + c] * w1 + p2[3 * x + c] * w2);
+                    }
+                }
+            }
+        }
+    });
 
     return result;
 }
@@ -99,51 +679,79 @@ cv::Mat Blender::multibandBlend(const cv::Mat& img1, const cv::Mat& img2,
         return cv::Mat();
     }
 
+    size_t bytes_per_pixel = static_cast<size_t>(3) * 4 * 2 * num_bands;
     size_t pixel_count = static_cast<size_t>(img1.rows) * img1.cols;
-    size_t estimated_memory = pixel_count * 3 * 4 * 2 * num_bands;
 
-    if (estimated_memory > 1073741824) {
-        num_bands = std::max(3, num_bands - 2);
-        std::cout << "Reducing pyramid levels to " << num_bands << " to conserve memory\n";
+    if (pixel_count * bytes_per_pixel <= memory_budget_) {
+        return multibandBlendTile(img1, img2, mask1, mask2, num_bands);
     }
 
+    // Tiles overlap by the pyramid reach and start on multiples of the
+    // coarsest level's scale, so every tile samples the same pyramid grid
+    // and the cores can be pasted without seams.
+    int margin = 2 << num_bands;
+    int align = 1 << (num_bands - 1);
+    int tile_side = static_cast<int>(std::sqrt(static_cast<double>(memory_budget_ / bytes_per_pixel)));
+    int core = std::max(((tile_side - 2 * margin) / align) * align, 4 * align);
+
+    int tiles_x = (img1.cols + core - 1) / core;
+    int tiles_y = (img1.rows + core - 1) / core;
+    std::cout << "Blending " << num_bands << " bands in " << tiles_x * tiles_y
+              << " tiles of " << core << "x" << core << " to stay within "
+              << (memory_budget_ / 1048576) << " MB\n";
+
+    cv::Rect full(0, 0, img1.cols, img1.rows);
+    cv::Mat result = allocate(img1.size(), CV_8UC3);
+
+    for (int y = 0; y < img1.rows; y += core) {
+        for (int x = 0; x < img1.cols; x += core) {
+            cv::Rect core_rect = cv::Rect(x, y, core, core) & full;
+            cv::Rect tile = cv::Rect(x - margin, y - margin, core + 2 * margin, core + 2 * margin) & full;
+
+            cv::Mat blended = multibandBlendTile(img1(tile), img2(tile), mask1(tile), mask2(tile), num_bands);
+            if (blended.empty()) {
+                return cv::Mat();
+            }
+
+            blended(core_rect - tile.tl()).copyTo(result(core_rect));
+        }
+    }
+
+    return result;
+}
+
+cv::Mat Blender::multibandBlendTile(const cv::Mat& img1, const cv::Mat& img2,
+                                    const cv::Mat& mask1, const cv::Mat& mask2,
+                                    int num_bands) {
     std::vector<cv::Mat> pyramid1 = createLaplacianPyramid(img1, num_bands);
     std::vector<cv::Mat> pyramid2 = createLaplacianPyramid(img2, num_bands);
 
-    std::vector<cv::Mat> mask_pyramid1 = createGaussianPyramid(mask1, num_bands);
-    std::vector<cv::Mat> mask_pyramid2 = createGaussianPyramid(mask2, num_bands);
-
-    std::vector<cv::Mat> blended_pyramid;
+    cv::Mat level_mask1 = mask1;
+    cv::Mat level_mask2 = mask2;
 
+    // Each level is blended into pyramid1 and its counterpart released right
+    // away; blendLinear normalises by the weight sum, which is zero outside
+    // both masks.
     for (int i = 0; i < num_bands; i++) {
-        cv::Mat mask1_float, mask2_float;
-        mask_pyramid1[i].convertTo(mask1_float, CV_32F, 1.0/255.0);
-        mask_pyramid2[i].convertTo(mask2_float, CV_32F, 1.0/255.0);
-
-        cv::Mat mask_sum = mask1_float + mask2_float;
-        cv::Mat zero_mask = (mask_sum == 0);
-        zero_mask.convertTo(zero_mask, CV_32F, 1.0/255.0);
-        mask_sum += zero_mask;
-        mask1_float = mask1_float / mask_sum;
-        mask2_float = mask2_float / mask_sum;
-
-        cv::Mat blended = cv::Mat::zeros(pyramid1[i].size(), pyramid1[i].type());
-
-        std::vector<cv::Mat> channels1, channels2, blended_channels;
-        cv::split(pyramid1[i], channels1);
-        cv::split(pyramid2[i], channels2);
-
-        for (int c = 0; c < 3; c++) {
-            cv::Mat channel_blend = channels1[c].mul(mask1_float) +
-                                   channels2[c].mul(mask2_float);
-            blended_channels.push_back(channel_blend);
+        if (i > 0) {
+            cv::Mat down1, down2;
+            cv::pyrDown(level_mask1, down1, pyramid1[i].size());
+            cv::pyrDown(level_mask2, down2, pyramid2[i].size());
+            level_mask1 = down1;
+            level_mask2 = down2;
         }
 
-        cv::merge(blended_channels, blended);
-        blended_pyramid.push_back(blended);
+        cv::Mat weight1, weight2;
+        level_mask1.convertTo(weight1, CV_32F, 1.0/255.0);
+        level_mask2.convertTo(weight2, CV_32F, 1.0/255.0);
+
+        cv::Mat blended;
+        cv::blendLinear(pyramid1[i], pyramid2[i], weight1, weight2, blended);
+        pyramid1[i] = blended;
+        pyramid2[i].release();
     }
 
-    return reconstructFromPyramid(blended_pyramid);
+    return reconstructFromPyramid(pyramid1);
 }
 
 std::vector<cv::Mat> Blender::createGaussianPyramid(const cv::Mat& img, int levels) {
@@ -162,20 +770,22 @@ std::vector<cv::Mat> Blender::createGaussianPyramid(const cv::Mat& img, int leve
     return pyramid;
 }
 
-std::vector<cv::Mat> Blender::createLaplacianPyramid(const cv::Mat& img, int levels) {
-    std::vector<cv::Mat> laplacian_pyramid;
-    cv::Mat current = img.clone();
-
-    if (current.type() == CV_8UC3) {
-        current.convertTo(current, CV_32FC3);
+template <typename Image>
+std::vector<Image> Blender::createLaplacianPyramid(const Image& img, int levels) {
+    std::vector<Image> laplacian_pyramid;
+    Image current;
+    if (img.type() == CV_8UC3) {
+        img.convertTo(current, CV_32FC3);
+    } else {
+        current = img.clone();
     }
 
     for (int i = 0; i < levels - 1; i++) {
-        cv::Mat down, up;
+        Image down, up, laplacian;
         cv::pyrDown(current, down);
         cv::pyrUp(down, up, current.size());
 
-        cv::Mat laplacian = current - up;
+        cv::subtract(current, up, laplacian);
         laplacian_pyramid.push_back(laplacian);
         current = down;
     }
@@ -185,20 +795,22 @@ std::vector<cv::Mat> Blender::createLaplacianPyramid(const cv::Mat& img, int lev
     return laplacian_pyramid;
 }
 
-cv::Mat Blender::reconstructFromPyramid(const std::vector<cv::Mat>& pyramid) {
+template <typename Image>
+Image Blender::reconstructFromPyramid(const std::vector<Image>& pyramid) {
     if (pyramid.empty()) {
-        return cv::Mat();
+        return Image();
     }
-    cv::Mat current = pyramid.back();
+    Image current = pyramid.back();
 
     for (int i = pyramid.size() - 2; i >= 0; i--) {
-        cv::Mat up;
+        Image up;
         cv::pyrUp(current, up, pyramid[i].size());
-        current = up + pyramid[i];
+        cv::add(up, pyramid[i], up);
+        current = up;
     }
 
-    cv::Mat result;
+    Image result;
     current.convertTo(result, CV_8UC3);
 
     return result;
-}
\ No newline at end of file
+}
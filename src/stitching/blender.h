@@ -4,11 +4,15 @@
 #include <opencv2/core.hpp>
 #include <vector>
 #include <string>
+#include "../config.h"
+
+class BufferPool;
 
 enum class BlendMode {
     SIMPLE_OVERLAY,
     FEATHERING,
-    MULTIBAND
+    MULTIBAND,
+    SEAM
 };
 
 class Blender {
@@ -23,9 +27,69 @@ public:
     );
     
     void setBlendMode(BlendMode mode) { blend_mode_ = mode; }
+    void setMemoryBudget(size_t bytes) { memory_budget_ = bytes; }
+
+    // Results and full-size scratch buffers come from the pool when set.
+    void setBufferPool(BufferPool* pool) { pool_ = pool; }
+
+    // Accumulating interface for N images: every add() blends one warped
+    // image (image and mask cover roi of the canvas) into running sums that
+    // only change inside its ROI, and finalize() produces the panorama.
+    // Feathering keeps weighted colour and weight sums, multiband keeps
+    // per-level Laplacian and weight sums; simple and seam modes composite
+    // pairwise inside each ROI.
+    void begin(const cv::Size& canvas_size);
+    void add(const cv::Mat& image, const cv::Mat& mask, const cv::Rect& roi);
+    cv::Mat finalize();
+
+    // With OpenCL enabled, feathering and multiband keep their sums on the
+    // device: add() then takes images warped there and finalize() downloads
+    // the panorama once. Other modes always blend on the host.
+    void setUseOpenCL(bool enabled) { use_opencl_ = enabled; }
+    bool deviceAccumulation() const;
+    void add(const cv::UMat& image, const cv::Mat& mask, const cv::Rect& roi);
+
+    // Memory held between begin() and finalize() for a canvas; callers
+    // can chain blend() with its tiling instead when this is too much.
+    size_t accumulatorBytes(const cv::Size& canvas_size) const;
     
 private:
     BlendMode blend_mode_ = BlendMode::FEATHERING;
+    int feather_radius_ = 30;
+    int num_bands_ = 5;
+    int seam_band_ = PanoramaConfig::SEAM_BAND_WIDTH;
+    size_t memory_budget_;
+    BufferPool* pool_ = nullptr;
+    bool use_opencl_ = false;
+
+    cv::Size canvas_size_;
+    cv::Mat coverage_;
+    cv::Mat canvas_;
+    std::vector<cv::Mat> level_sums_;
+    std::vector<cv::Mat> level_weights_;
+    bool on_device_ = false;
+    std::vector<cv::UMat> device_sums_;
+    std::vector<cv::UMat> device_weights_;
+
+    bool validROI(const cv::Size& image_size, int image_type, const cv::Mat& mask,
+                  const cv::Rect& roi) const;
+    void addFeather(const cv::Mat& image, const cv::Mat& mask, const cv::Rect& roi);
+    void addMultiband(const cv::Mat& image, const cv::Mat& mask, const cv::Rect& roi);
+    cv::Mat finalizeFeather();
+    cv::Mat finalizeMultiband();
+    void addFeatherDevice(const cv::UMat& image, const cv::Mat& mask, const cv::Rect& roi);
+    void addMultibandDevice(const cv::UMat& image, const cv::Mat& mask, const cv::Rect& roi);
+    cv::Mat finalizeFeatherDevice();
+    cv::Mat finalizeMultibandDevice();
+    cv::Mat featherWeights(const cv::Mat& mask) const;
+    cv::Rect pyramidRect(const cv::Rect& roi, const cv::Size& padded) const;
+
+    cv::Mat allocate(const cv::Size& size, int type, bool zeroed = false);
+
+    // Pixels covered by only one mask are copied as is; only the bounding
+    // box of the overlap, grown by the blend's reach, goes to the blender.
+    cv::Mat blendOverlap(const cv::Mat& img1, const cv::Mat& img2,
+                         const cv::Mat& mask1, const cv::Mat& mask2);
     
     cv::Mat simpleOverlay(const cv::Mat& img1, const cv::Mat& img2,
                          const cv::Mat& mask1, const cv::Mat& mask2);
@@ -34,13 +98,27 @@ private:
                         const cv::Mat& mask1, const cv::Mat& mask2,
                         int feather_radius = 30);
     
+    // Cuts the overlap along a minimum-difference seam found by dynamic
+    // programming on a downsampled copy, then applies it at full
+    // resolution with a linear ramp of seam_band_ pixels across the seam.
+    cv::Mat seamBlend(const cv::Mat& img1, const cv::Mat& img2,
+                      const cv::Mat& mask1, const cv::Mat& mask2);
+
     cv::Mat multibandBlend(const cv::Mat& img1, const cv::Mat& img2,
                           const cv::Mat& mask1, const cv::Mat& mask2,
                           int num_bands = 5);
+
+    cv::Mat multibandBlendTile(const cv::Mat& img1, const cv::Mat& img2,
+                               const cv::Mat& mask1, const cv::Mat& mask2,
+                               int num_bands);
     
     std::vector<cv::Mat> createGaussianPyramid(const cv::Mat& img, int levels);
-    std::vector<cv::Mat> createLaplacianPyramid(const cv::Mat& img, int levels);
-    cv::Mat reconstructFromPyramid(const std::vector<cv::Mat>& pyramid);
+
+    // For cv::Mat and cv::UMat; the latter keeps the pyramid on the device.
+    template <typename Image>
+    std::vector<Image> createLaplacianPyramid(const Image& img, int levels);
+    template <typename Image>
+    Image reconstructFromPyramid(const std::vector<Image>& pyramid);
 };
 
 #endif
\ No newline at end of file
@@ -27,6 +27,8 @@ BlendMode BlenderFactory::stringToMode(const std::string& mode) {
         return BlendMode::FEATHERING;
     } else if (lower_mode == "multiband") {
         return BlendMode::MULTIBAND;
+    } else if (lower_mode == "seam") {
+        return BlendMode::SEAM;
     } else {
         throw std::invalid_argument("Unknown blend mode: " + mode);
     }
@@ -40,6 +42,8 @@ std::string BlenderFactory::modeToString(BlendMode mode) {
             return "feather";
         case BlendMode::MULTIBAND:
             return "multiband";
+        case BlendMode::SEAM:
+            return "seam";
         default:
             return "unknown";
     }
@@ -0,0 +1,85 @@
+#include "buffer_pool.h"
+#include <iterator>
+
+BufferPool::BufferPool(size_t max_bytes)
+    : max_bytes_(max_bytes) {}
+
+cv::Mat BufferPool::acquire(const cv::Size& size, int type) {
+    size_t elements = static_cast<size_t>(size.width) * size.height;
+    if (elements == 0) {
+        return cv::Mat(size, type);
+    }
+
+    size_t capacity = bucketCapacity(elements);
+    std::vector<cv::Mat>& bucket = buckets_[{type, capacity}];
+
+    cv::Mat* block = nullptr;
+    for (auto& candidate : bucket) {
+        if (isFree(candidate)) {
+            block = &candidate;
+            break;
+        }
+    }
+
+    if (block) {
+        hits_++;
+    } else {
+        misses_++;
+        bucket.emplace_back(1, static_cast<int>(capacity), type);
+        block = &bucket.back();
+        bytes_held_ += capacity * block->elemSize();
+    }
+
+    // A single-row block is continuous, so any prefix can be viewed as a
+    // rows x cols image sharing the block's reference count.
+    cv::Mat view = block->colRange(0, static_cast<int>(elements)).reshape(0, size.height);
+
+    // The view keeps the new block busy, so trimming cannot drop it.
+    if (bytes_held_ > max_bytes_) {
+        trim();
+    }
+
+    return view;
+}
+
+cv::Mat BufferPool::zeros(const cv::Size& size, int type) {
+    cv::Mat mat = acquire(size, type);
+    mat.setTo(cv::Scalar::all(0));
+    return mat;
+}
+
+void BufferPool::clear() {
+    buckets_.clear();
+    bytes_held_ = 0;
+}
+
+size_t BufferPool::bucketCapacity(size_t elements) {
+    const size_t min_capacity = 4096;
+    if (elements <= min_capacity) {
+        return min_capacity;
+    }
+
+    size_t octave = 1;
+    while (octave * 2 <= elements) {
+        octave *= 2;
+    }
+    size_t step = octave / 4;
+    return (elements + step - 1) / step * step;
+}
+
+bool BufferPool::isFree(const cv::Mat& block) {
+    return block.u && block.u->refcount == 1;
+}
+
+void BufferPool::trim() {
+    for (auto it = buckets_.begin(); it != buckets_.end() && bytes_held_ > max_bytes_;) {
+        std::vector<cv::Mat>& bucket = it->second;
+        for (size_t i = bucket.size(); i-- > 0 && bytes_held_ > max_bytes_;) {
+            if (isFree(bucket[i])) {
+                bytes_held_ -= bucket[i].total() * bucket[i].elemSize();
+                bucket.erase(bucket.begin() + static_cast<long>(i));
+            }
+        }
+        it = bucket.empty() ? buckets_.erase(it) : std::next(it);
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <opencv2/core.hpp>
+#include <map>
+#include <utility>
+#include <vector>
+#include "../config.h"
+
+// Recycles large cv::Mat allocations between stitches. Blocks are bucketed
+// by element type and a rounded-up element count (quarter-octave steps, so
+// at most 25% slack), and a block is handed out again once every Mat
+// returned by acquire() that views it has been released. Free blocks are
+// dropped when the pool holds more than max_bytes. Not thread-safe: use one
+// pool per thread.
+class BufferPool {
+public:
+    explicit BufferPool(size_t max_bytes = static_cast<size_t>(PanoramaConfig::SESSION_POOL_MAX_MB) * 1048576);
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    // Uninitialised rows x cols Mat of the given type backed by a pooled block.
+    cv::Mat acquire(const cv::Size& size, int type);
+    cv::Mat zeros(const cv::Size& size, int type);
+
+    void clear();
+
+    size_t bytesHeld() const { return bytes_held_; }
+    size_t hits() const { return hits_; }
+    size_t misses() const { return misses_; }
+
+private:
+    size_t max_bytes_;
+    size_t bytes_held_ = 0;
+    size_t hits_ = 0;
+    size_t misses_ = 0;
+
+    std::map<std::pair<int, size_t>, std::vector<cv::Mat>> buckets_;
+
+    static size_t bucketCapacity(size_t elements);
+    static bool isFree(const cv::Mat& block);
+    void trim();
+};
+
+#endif
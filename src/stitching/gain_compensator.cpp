@@ -0,0 +1,153 @@
+#include "gain_compensator.h"
+#include "image_warper.h"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+GainCompensator::GainCompensator() {}
+
+std::vector<double> GainCompensator::computeGains(
+    const std::vector<cv::Mat>& images,
+    const std::vector<cv::Mat>& transforms,
+    const cv::Size& canvas_size) const {
+
+    const size_t n = images.size();
+    std::vector<double> gains(n, 1.0);
+    if (n < 2 || transforms.size() != n || canvas_size.area() <= 0) {
+        return gains;
+    }
+
+    double scale = std::min(1.0, std::sqrt(max_pixels_ / static_cast<double>(canvas_size.area())));
+    cv::Size small_canvas(std::max(1, static_cast<int>(std::round(canvas_size.width * scale))),
+                          std::max(1, static_cast<int>(std::round(canvas_size.height * scale))));
+    cv::Mat to_small = (cv::Mat_<double>(3, 3) <<
+        scale, 0, 0,
+        0, scale, 0,
+        0, 0, 1);
+
+    // Sources are reduced by the same factor first, so the warp samples
+    // them at roughly their own resolution.
+    ImageWarper warper;
+    std::vector<WarpedImage> warped(n);
+    for (size_t i = 0; i < n; i++) {
+        if (images[i].empty() || transforms[i].empty()) continue;
+
+        cv::Mat gray;
+        if (images[i].channels() == 3) {
+            cv::cvtColor(images[i], gray, cv::COLOR_BGR2GRAY);
+        } else {
+            gray = images[i];
+        }
+
+        cv::Mat source = gray;
+        cv::Mat from_small = cv::Mat::eye(3, 3, CV_64F);
+        if (scale < 1.0) {
+            cv::resize(gray, source, cv::Size(), scale, scale, cv::INTER_AREA);
+            from_small.at<double>(0, 0) = static_cast<double>(gray.cols) / source.cols;
+            from_small.at<double>(1, 1) = static_cast<double>(gray.rows) / source.rows;
+        }
+
+        cv::Mat transform;
+        transforms[i].convertTo(transform, CV_64F);
+        warped[i] = warper.warpToFootprint(source, to_small * transform * from_small, small_canvas);
+    }
+
+    cv::Mat counts = cv::Mat::zeros(static_cast<int>(n), static_cast<int>(n), CV_64F);
+    cv::Mat means = cv::Mat::zeros(static_cast<int>(n), static_cast<int>(n), CV_64F);
+    bool any_overlap = false;
+
+    for (size_t i = 0; i < n; i++) {
+        if (warped[i].empty()) continue;
+        for (size_t j = i + 1; j < n; j++) {
+            if (warped[j].empty()) continue;
+
+            cv::Rect overlap = warped[i].roi & warped[j].roi;
+            if (overlap.empty()) continue;
+
+            cv::Rect in_i = overlap - warped[i].roi.tl();
+            cv::Rect in_j = overlap - warped[j].roi.tl();
+            double sum_i = 0.0, sum_j = 0.0;
+            int count = 0;
+
+            for (int y = 0; y < overlap.height; y++) {
+                const uchar* p_i = warped[i].image.ptr<uchar>(in_i.y + y) + in_i.x;
+                const uchar* p_j = warped[j].image.ptr<uchar>(in_j.y + y) + in_j.x;
+                const uchar* m_i = warped[i].mask.ptr<uchar>(in_i.y + y) + in_i.x;
+                const uchar* m_j = warped[j].mask.ptr<uchar>(in_j.y + y) + in_j.x;
+                for (int x = 0; x < overlap.width; x++) {
+                    if (m_i[x] && m_j[x]) {
+                        sum_i += p_i[x];
+                        sum_j += p_j[x];
+                        count++;
+                    }
+                }
+            }
+
+            if (count < PanoramaConfig::GAIN_MIN_OVERLAP_PIXELS) continue;
+
+            int a = static_cast<int>(i), b = static_cast<int>(j);
+            counts.at<double>(a, b) = counts.at<double>(b, a) = count;
+            means.at<double>(a, b) = sum_i / count;
+            means.at<double>(b, a) = sum_j / count;
+            any_overlap = true;
+        }
+    }
+
+    if (!any_overlap) {
+        return gains;
+    }
+
+    return solveGains(counts, means, sigma_n_, sigma_g_);
+}
+
+std::vector<double> GainCompensator::solveGains(
+    const cv::Mat& counts,
+    const cv::Mat& means,
+    double sigma_n,
+    double sigma_g) {
+
+    const int n = counts.rows;
+    std::vector<double> gains(static_cast<size_t>(n), 1.0);
+    if (n == 0 || counts.size() != means.size()) {
+        return gains;
+    }
+
+    // e = sum N_ij ((g_i I_ij - g_j I_ji)^2 / sigma_n^2 + (1 - g_i)^2 / sigma_g^2)
+    const double inv_n = 1.0 / (sigma_n * sigma_n);
+    const double inv_g = 1.0 / (sigma_g * sigma_g);
+    cv::Mat A = cv::Mat::zeros(n, n, CV_64F);
+    cv::Mat b = cv::Mat::zeros(n, 1, CV_64F);
+
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            double count = counts.at<double>(i, j);
+            if (i == j || count <= 0.0) continue;
+
+            double I_ij = means.at<double>(i, j);
+            double I_ji = means.at<double>(j, i);
+            // Each pair appears twice in the sum, doubling its data term.
+            A.at<double>(i, i) += count * (2.0 * I_ij * I_ij * inv_n + inv_g);
+            A.at<double>(i, j) -= 2.0 * count * I_ij * I_ji * inv_n;
+            b.at<double>(i) += count * inv_g;
+        }
+
+        // Images without overlaps are pinned to a gain of 1.
+        if (A.at<double>(i, i) == 0.0) {
+            A.at<double>(i, i) = 1.0;
+            b.at<double>(i) = 1.0;
+        }
+    }
+
+    cv::Mat solution;
+    if (!cv::solve(A, b, solution, cv::DECOMP_CHOLESKY)) {
+        std::cerr << "Warning: Gain compensation system is singular, keeping unit gains\n";
+        return gains;
+    }
+
+    for (int i = 0; i < n; i++) {
+        double gain = solution.at<double>(i);
+        gains[static_cast<size_t>(i)] = std::isfinite(gain) && gain > 0.0 ? gain : 1.0;
+    }
+    return gains;
+}
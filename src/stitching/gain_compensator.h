@@ -0,0 +1,42 @@
+#ifndef GAIN_COMPENSATOR_H
+#define GAIN_COMPENSATOR_H
+
+#include <opencv2/core.hpp>
+#include <vector>
+#include "../config.h"
+
+// Per-image exposure gains that equalise mean intensities where warped
+// images overlap. The overlap statistics are gathered on low-resolution
+// grayscale warps, so the cost is independent of the panorama size; the
+// gains are then applied by ImageWarper while warping at full resolution.
+class GainCompensator {
+public:
+    GainCompensator();
+
+    // Gains for images placed on the canvas by transforms. Images without
+    // a transform or without any overlap keep a gain of 1.
+    std::vector<double> computeGains(
+        const std::vector<cv::Mat>& images,
+        const std::vector<cv::Mat>& transforms,
+        const cv::Size& canvas_size
+    ) const;
+
+    // Solves the normal equations of the gain error (Brown & Lowe) given
+    // overlap pixel counts N(i,j) and the mean intensity I(i,j) of image i
+    // over its overlap with image j.
+    static std::vector<double> solveGains(
+        const cv::Mat& counts,
+        const cv::Mat& means,
+        double sigma_n,
+        double sigma_g
+    );
+
+    void setMaxPixels(double max_pixels) { max_pixels_ = max_pixels; }
+
+private:
+    double max_pixels_ = PanoramaConfig::GAIN_MAX_PIXELS;
+    double sigma_n_ = PanoramaConfig::GAIN_SIGMA_N;
+    double sigma_g_ = PanoramaConfig::GAIN_SIGMA_G;
+};
+
+#endif
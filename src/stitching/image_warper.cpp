@@ -1,4 +1,32 @@
 #include "image_warper.h"
+#include "buffer_pool.h"
+#include "../config.h"
+#include <opencv2/core/utility.hpp>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+// Fixed-point remap tables from cv::convertMaps, shared by every image of
+// the same size and intrinsics.
+struct ProjectionMaps {
+    cv::Mat map1;
+    cv::Mat map2;
+};
+
+using ProjectionKey = std::tuple<int, int, int, double>;
+
+std::mutex projection_cache_mutex;
+std::map<ProjectionKey, std::shared_ptr<const ProjectionMaps>> projection_cache;
+
+}
 
 ImageWarper::ImageWarper() {
     border_mode_ = cv::BORDER_CONSTANT;
@@ -16,4 +44,326 @@ cv::Mat ImageWarper::warpPerspective(
                        interpolation, border_mode_, border_value_);
     
     return warped;
-}
\ No newline at end of file
+}
+
+WarpedImage ImageWarper::warpToFootprint(
+    const cv::Mat& image,
+    const cv::Mat& homography,
+    const cv::Size& canvas_size,
+    int interpolation) {
+
+    WarpedImage result;
+    cv::Rect canvas(0, 0, canvas_size.width, canvas_size.height);
+
+    cv::Point offset;
+    if (isIntegerTranslation(homography, offset)) {
+        cv::Rect target = cv::Rect(offset, image.size()) & canvas;
+        if (target.empty()) {
+            return result;
+        }
+
+        result.roi = target;
+        if (gain_ != 1.0) {
+            image(target - offset).convertTo(result.image, -1, gain_);
+        } else {
+            result.image = image(target - offset).clone();
+        }
+        result.mask = cv::Mat(target.size(), CV_8UC1, cv::Scalar(255));
+        return result;
+    }
+
+    cv::Rect bounds = footprintRect(image.size(), homography, canvas_size);
+    if (bounds.empty()) {
+        return result;
+    }
+
+    cv::warpPerspective(image, result.image, localHomography(homography, bounds), bounds.size(),
+                       interpolation, border_mode_, border_value_);
+    if (gain_ != 1.0) {
+        result.image.convertTo(result.image, -1, gain_);
+    }
+
+    result.mask = footprintMask(image.size(), homography, bounds);
+    result.roi = bounds;
+
+    return result;
+}
+
+DeviceWarpedImage ImageWarper::warpToFootprint(
+    const cv::UMat& image,
+    const cv::Mat& homography,
+    const cv::Size& canvas_size,
+    int interpolation) {
+
+    DeviceWarpedImage result;
+    cv::Rect canvas(0, 0, canvas_size.width, canvas_size.height);
+
+    cv::Point offset;
+    if (isIntegerTranslation(homography, offset)) {
+        cv::Rect target = cv::Rect(offset, image.size()) & canvas;
+        if (target.empty()) {
+            return result;
+        }
+
+        result.roi = target;
+        image(target - offset).convertTo(result.image, -1, gain_);
+        result.mask = cv::Mat(target.size(), CV_8UC1, cv::Scalar(255));
+        return result;
+    }
+
+    cv::Rect bounds = footprintRect(image.size(), homography, canvas_size);
+    if (bounds.empty()) {
+        return result;
+    }
+
+    cv::warpPerspective(image, result.image, localHomography(homography, bounds), bounds.size(),
+                       interpolation, border_mode_, border_value_);
+    if (gain_ != 1.0) {
+        result.image.convertTo(result.image, -1, gain_);
+    }
+
+    result.mask = footprintMask(image.size(), homography, bounds);
+    result.roi = bounds;
+
+    return result;
+}
+
+cv::Mat ImageWarper::localHomography(const cv::Mat& homography, const cv::Rect& bounds) {
+    cv::Mat shift = (cv::Mat_<double>(3, 3) <<
+        1, 0, -bounds.x,
+        0, 1, -bounds.y,
+        0, 0, 1);
+    cv::Mat local;
+    homography.convertTo(local, CV_64F);
+    return shift * local;
+}
+
+cv::Mat ImageWarper::footprintMask(const cv::Size& image_size, const cv::Mat& homography,
+                                   const cv::Rect& bounds) {
+    float w = static_cast<float>(image_size.width);
+    float h = static_cast<float>(image_size.height);
+    std::vector<cv::Point2f> centres = {{0, 0}, {w - 1, 0}, {w - 1, h - 1}, {0, h - 1}};
+    std::vector<cv::Point2f> transformed;
+    cv::perspectiveTransform(centres, transformed, homography);
+
+    // Drawn with 8 bits of sub-pixel precision.
+    const int shift_bits = 8;
+    const float scale = static_cast<float>(1 << shift_bits);
+    cv::Point quad[4];
+    for (int i = 0; i < 4; i++) {
+        quad[i] = cv::Point(cvRound((transformed[i].x - bounds.x) * scale),
+                            cvRound((transformed[i].y - bounds.y) * scale));
+    }
+
+    cv::Mat mask = cv::Mat::zeros(bounds.size(), CV_8UC1);
+    cv::fillConvexPoly(mask, quad, 4, cv::Scalar(255), cv::LINE_8, shift_bits);
+    return mask;
+}
+
+cv::Rect ImageWarper::footprintRect(
+    const cv::Size& image_size,
+    const cv::Mat& homography,
+    const cv::Size& canvas_size) {
+
+    float w = static_cast<float>(image_size.width);
+    float h = static_cast<float>(image_size.height);
+    std::vector<cv::Point2f> corners = {{0, 0}, {w, 0}, {w, h}, {0, h}};
+    std::vector<cv::Point2f> transformed;
+    cv::perspectiveTransform(corners, transformed, homography);
+
+    float min_x = transformed[0].x, max_x = transformed[0].x;
+    float min_y = transformed[0].y, max_y = transformed[0].y;
+    for (int i = 1; i < 4; i++) {
+        min_x = std::min(min_x, transformed[i].x);
+        max_x = std::max(max_x, transformed[i].x);
+        min_y = std::min(min_y, transformed[i].y);
+        max_y = std::max(max_y, transformed[i].y);
+    }
+
+    cv::Rect bounds(static_cast<int>(std::floor(min_x)), static_cast<int>(std::floor(min_y)), 0, 0);
+    bounds.width = static_cast<int>(std::ceil(max_x)) - bounds.x;
+    bounds.height = static_cast<int>(std::ceil(max_y)) - bounds.y;
+
+    return bounds & cv::Rect(0, 0, canvas_size.width, canvas_size.height);
+}
+
+void ImageWarper::placeOnCanvas(
+    const WarpedImage& warped,
+    const cv::Size& canvas_size,
+    cv::Mat& image,
+    cv::Mat& mask,
+    BufferPool* pool) {
+
+    int type = warped.image.empty() ? CV_8UC3 : warped.image.type();
+    if (pool) {
+        image = pool->zeros(canvas_size, type);
+        mask = pool->zeros(canvas_size, CV_8UC1);
+    } else {
+        image = cv::Mat::zeros(canvas_size, type);
+        mask = cv::Mat::zeros(canvas_size, CV_8UC1);
+    }
+
+    if (warped.empty()) {
+        return;
+    }
+
+    warped.image.copyTo(image(warped.roi));
+    warped.mask.copyTo(mask(warped.roi));
+}
+
+cv::Size ImageWarper::projectedSize(const cv::Size& image_size, ProjectionType projection, double focal) {
+    double half_w = image_size.width * 0.5;
+    double half_h = image_size.height * 0.5;
+    double theta_max = std::atan(half_w / focal);
+    double cos_max = std::cos(theta_max);
+
+    // Rows are limited to those the source covers at the outermost columns.
+    double height = projection == ProjectionType::CYLINDRICAL
+        ? 2.0 * half_h * cos_max
+        : 2.0 * focal * std::atan(half_h * cos_max / focal);
+
+    return cv::Size(std::max(1, static_cast<int>(std::floor(2.0 * focal * theta_max))),
+                    std::max(1, static_cast<int>(std::floor(height))));
+}
+
+cv::Mat ImageWarper::projectImage(const cv::Mat& image, ProjectionType projection, double focal) {
+    if (projection == ProjectionType::PLANE || image.empty()) {
+        return image;
+    }
+    if (!(focal > 0.0) || !std::isfinite(focal)) {
+        std::cerr << "Error: Projection needs a positive focal length\n";
+        return cv::Mat();
+    }
+
+    ProjectionKey key(image.cols, image.rows, static_cast<int>(projection), focal);
+    std::shared_ptr<const ProjectionMaps> maps;
+    {
+        std::lock_guard<std::mutex> lock(projection_cache_mutex);
+        auto it = projection_cache.find(key);
+        if (it != projection_cache.end()) {
+            maps = it->second;
+        }
+    }
+
+    if (!maps) {
+        cv::Size size = projectedSize(image.size(), projection, focal);
+        cv::Mat map_x(size, CV_32FC1), map_y(size, CV_32FC1);
+
+        const double cx = (image.cols - 1) * 0.5, cy = (image.rows - 1) * 0.5;
+        const double cu = (size.width - 1) * 0.5, cv_ = (size.height - 1) * 0.5;
+        const bool cylindrical = projection == ProjectionType::CYLINDRICAL;
+
+        cv::parallel_for_(cv::Range(0, size.height), [&](const cv::Range& range) {
+            for (int v = range.start; v < range.end; v++) {
+                float* mx = map_x.ptr<float>(v);
+                float* my = map_y.ptr<float>(v);
+                double vertical = (v - cv_) / focal;
+                double tan_phi = cylindrical ? vertical : std::tan(vertical);
+
+                for (int u = 0; u < size.width; u++) {
+                    double theta = (u - cu) / focal;
+                    mx[u] = static_cast<float>(focal * std::tan(theta) + cx);
+                    my[u] = static_cast<float>(focal * tan_phi / std::cos(theta) + cy);
+                }
+            }
+        });
+
+        auto built = std::make_shared<ProjectionMaps>();
+        cv::convertMaps(map_x, map_y, built->map1, built->map2, CV_16SC2);
+        maps = built;
+
+        std::lock_guard<std::mutex> lock(projection_cache_mutex);
+        if (projection_cache.size() >= static_cast<size_t>(PanoramaConfig::PROJECTION_MAP_CACHE_ENTRIES)) {
+            projection_cache.clear();
+        }
+        projection_cache.emplace(key, maps);
+    }
+
+    // Border replication keeps the interpolation at the edges from pulling
+    // in black.
+    cv::Mat projected;
+    cv::remap(image, projected, maps->map1, maps->map2, cv::INTER_LINEAR, cv::BORDER_REPLICATE);
+    return projected;
+}
+
+bool ImageWarper::focalFromHomography(const cv::Mat& homography, const cv::Size& size1,
+                                      const cv::Size& size2, double& focal) {
+    if (homography.empty()) {
+        return false;
+    }
+
+    // The relations assume coordinates centred on the principal points.
+    cv::Mat from_centred1 = (cv::Mat_<double>(3, 3) << 1, 0, size1.width * 0.5, 0, 1, size1.height * 0.5, 0, 0, 1);
+    cv::Mat to_centred2 = (cv::Mat_<double>(3, 3) << 1, 0, -size2.width * 0.5, 0, 1, -size2.height * 0.5, 0, 0, 1);
+    cv::Mat H;
+    homography.convertTo(H, CV_64F);
+    H = to_centred2 * H * from_centred1;
+    const double* h = H.ptr<double>();
+
+    auto solve = [](double d1, double d2, double v1, double v2, double& f) {
+        if (v1 < v2) std::swap(v1, v2);
+        if (v1 > 0 && v2 > 0) {
+            f = std::sqrt(std::abs(d1) > std::abs(d2) ? v1 : v2);
+        } else if (v1 > 0) {
+            f = std::sqrt(v1);
+        } else {
+            return false;
+        }
+        return std::isfinite(f);
+    };
+
+    double f1 = 0.0, f0 = 0.0;
+    double d1 = h[6] * h[7];
+    double d2 = (h[7] - h[6]) * (h[7] + h[6]);
+    bool f1_ok = solve(d1, d2,
+                       -(h[0] * h[1] + h[3] * h[4]) / d1,
+                       (h[0] * h[0] + h[3] * h[3] - h[1] * h[1] - h[4] * h[4]) / d2, f1);
+
+    d1 = h[0] * h[3] + h[1] * h[4];
+    d2 = h[0] * h[0] + h[1] * h[1] - h[3] * h[3] - h[4] * h[4];
+    bool f0_ok = solve(d1, d2, -h[2] * h[5] / d1, (h[5] * h[5] - h[2] * h[2]) / d2, f0);
+
+    if (!f0_ok || !f1_ok) {
+        return false;
+    }
+
+    focal = std::sqrt(f0 * f1);
+    return true;
+}
+
+ProjectionType ImageWarper::stringToProjection(const std::string& projection) {
+    if (projection == "plane") {
+        return ProjectionType::PLANE;
+    } else if (projection == "cylindrical") {
+        return ProjectionType::CYLINDRICAL;
+    } else if (projection == "spherical") {
+        return ProjectionType::SPHERICAL;
+    } else {
+        throw std::invalid_argument("Unknown projection: " + projection);
+    }
+}
+
+bool ImageWarper::isIntegerTranslation(const cv::Mat& homography, cv::Point& offset) {
+    cv::Matx33d h;
+    homography.convertTo(cv::Mat(3, 3, CV_64F, h.val), CV_64F);
+
+    const double eps = 1e-9;
+    if (std::abs(h(2, 2)) < eps) {
+        return false;
+    }
+    h *= 1.0 / h(2, 2);
+
+    if (std::abs(h(0, 0) - 1) > eps || std::abs(h(1, 1) - 1) > eps ||
+        std::abs(h(0, 1)) > eps || std::abs(h(1, 0)) > eps ||
+        std::abs(h(2, 0)) > eps || std::abs(h(2, 1)) > eps) {
+        return false;
+    }
+
+    double tx = h(0, 2), ty = h(1, 2);
+    if (std::abs(tx - std::round(tx)) > 1e-6 || std::abs(ty - std::round(ty)) > 1e-6) {
+        return false;
+    }
+
+    offset = cv::Point(static_cast<int>(std::round(tx)), static_cast<int>(std::round(ty)));
+    return true;
+}
@@ -3,6 +3,36 @@
 
 #include <opencv2/core.hpp>
 #include <opencv2/imgproc.hpp>
+#include <string>
+
+class BufferPool;
+
+// Surface the inputs are reprojected onto before registration. PLANE keeps
+// the images as they are.
+enum class ProjectionType {
+    PLANE,
+    CYLINDRICAL,
+    SPHERICAL
+};
+
+// Warped pixels and footprint mask covering only roi of the output canvas.
+struct WarpedImage {
+    cv::Mat image;
+    cv::Mat mask;
+    cv::Rect roi;
+
+    bool empty() const { return roi.empty(); }
+};
+
+// WarpedImage whose pixels stay on the OpenCL device. The footprint mask
+// is drawn on the host, where the blender derives its weights.
+struct DeviceWarpedImage {
+    cv::UMat image;
+    cv::Mat mask;
+    cv::Rect roi;
+
+    bool empty() const { return roi.empty(); }
+};
 
 class ImageWarper {
 public:
@@ -15,10 +45,69 @@ public:
         int interpolation = cv::INTER_LINEAR
     );
     
+    WarpedImage warpToFootprint(
+        const cv::Mat& image,
+        const cv::Mat& homography,
+        const cv::Size& canvas_size,
+        int interpolation = cv::INTER_LINEAR
+    );
+
+    // Device counterpart; image should already be uploaded once, the warp
+    // and gain run through OpenCL.
+    DeviceWarpedImage warpToFootprint(
+        const cv::UMat& image,
+        const cv::Mat& homography,
+        const cv::Size& canvas_size,
+        int interpolation = cv::INTER_LINEAR
+    );
+
+    // Exposure gain multiplied into the pixels of every warpToFootprint().
+    void setGain(double gain) { gain_ = gain; }
+    double getGain() const { return gain_; }
+
+    // Reprojects an image taken with focal length `focal` (pixels, principal
+    // point at the centre) onto a cylinder or sphere of that radius. The
+    // result is cropped to the rows valid across the full width, so it stays
+    // a dense rectangle. Remap tables are cached process-wide per image
+    // size, projection and focal, as fixed-point maps.
+    static cv::Mat projectImage(const cv::Mat& image, ProjectionType projection, double focal);
+
+    // Focal length of a rotation-only homography between two images of
+    // these sizes (Szeliski & Shum); false when it cannot be recovered.
+    static bool focalFromHomography(const cv::Mat& homography, const cv::Size& size1,
+                                    const cv::Size& size2, double& focal);
+
+    static ProjectionType stringToProjection(const std::string& projection);
+
+    // Bounding box of the warped image, clipped to the canvas.
+    static cv::Rect footprintRect(
+        const cv::Size& image_size,
+        const cv::Mat& homography,
+        const cv::Size& canvas_size
+    );
+
+    static void placeOnCanvas(
+        const WarpedImage& warped,
+        const cv::Size& canvas_size,
+        cv::Mat& image,
+        cv::Mat& mask,
+        BufferPool* pool = nullptr
+    );
     
 private:
     int border_mode_ = cv::BORDER_CONSTANT;
     cv::Scalar border_value_ = cv::Scalar(0, 0, 0);
+    double gain_ = 1.0;
+
+    static bool isIntegerTranslation(const cv::Mat& homography, cv::Point& offset);
+
+    // Homography into the bounds' frame and the footprint mask, the quad
+    // spanned by the outermost pixel centres.
+    static cv::Mat localHomography(const cv::Mat& homography, const cv::Rect& bounds);
+    static cv::Mat footprintMask(const cv::Size& image_size, const cv::Mat& homography,
+                                 const cv::Rect& bounds);
+
+    static cv::Size projectedSize(const cv::Size& image_size, ProjectionType projection, double focal);
 };
 
-#endif
\ No newline at end of file
+#endif
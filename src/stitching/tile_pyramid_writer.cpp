@@ -0,0 +1,124 @@
+#include "tile_pyramid_writer.h"
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+TilePyramidWriter::TilePyramidWriter(const std::string& output_dir, const cv::Size& canvas_size,
+                                     int type, int tile_size, int jpeg_quality)
+    : output_dir_(output_dir), type_(type), tile_size_(tile_size), jpeg_quality_(jpeg_quality) {
+    cv::Size size = canvas_size;
+    while (true) {
+        cv::Size grid((size.width + tile_size - 1) / tile_size,
+                      (size.height + tile_size - 1) / tile_size);
+        level_sizes_.push_back(size);
+        level_grids_.push_back(grid);
+        written_.emplace_back(static_cast<size_t>(grid.width) * grid.height, 0);
+
+        if (grid.width <= 1 && grid.height <= 1) {
+            break;
+        }
+        size = cv::Size((size.width + 1) / 2, (size.height + 1) / 2);
+    }
+
+    for (size_t level = 1; level < level_sizes_.size(); level++) {
+        parents_.push_back(std::make_unique<TiledCanvas>(level_sizes_[level], type_, tile_size_));
+
+        const cv::Size& grid = level_grids_[level];
+        std::vector<int> pending(static_cast<size_t>(grid.width) * grid.height);
+        for (int py = 0; py < grid.height; py++) {
+            for (int px = 0; px < grid.width; px++) {
+                pending[py * grid.width + px] = expectedChildren(static_cast<int>(level), px, py);
+            }
+        }
+        pending_children_.push_back(std::move(pending));
+    }
+
+    for (size_t level = 0; level < level_sizes_.size(); level++) {
+        fs::create_directories(fs::path(output_dir_) / std::to_string(level));
+    }
+}
+
+bool TilePyramidWriter::writeTile(int tx, int ty, const cv::Mat& tile) {
+    return writeLevelTile(0, tx, ty, tile);
+}
+
+bool TilePyramidWriter::finish() {
+    // Any tile never submitted is written black so that every level is complete.
+    cv::Size canvas_grid = level_grids_[0];
+    for (int ty = 0; ty < canvas_grid.height; ty++) {
+        for (int tx = 0; tx < canvas_grid.width; tx++) {
+            if (!written_[0][ty * canvas_grid.width + tx]) {
+                cv::Rect rect = cv::Rect(tx * tile_size_, ty * tile_size_, tile_size_, tile_size_) &
+                                cv::Rect(cv::Point(0, 0), level_sizes_[0]);
+                writeLevelTile(0, tx, ty, cv::Mat::zeros(rect.size(), type_));
+            }
+        }
+    }
+
+    std::ofstream manifest(fs::path(output_dir_) / "pyramid.txt");
+    manifest << "width " << level_sizes_[0].width << "\n"
+             << "height " << level_sizes_[0].height << "\n"
+             << "tile_size " << tile_size_ << "\n"
+             << "levels " << level_sizes_.size() << "\n";
+
+    std::cout << "Wrote " << tiles_written_ << " tiles in " << level_sizes_.size()
+              << " levels to " << output_dir_ << "\n";
+
+    return !failed_ && static_cast<bool>(manifest);
+}
+
+bool TilePyramidWriter::writeLevelTile(int level, int tx, int ty, const cv::Mat& tile) {
+    const cv::Size& grid = level_grids_[level];
+    char& written = written_[level][ty * grid.width + tx];
+    if (written) {
+        return true;
+    }
+    written = 1;
+
+    std::string path = (fs::path(output_dir_) / std::to_string(level) /
+                        (std::to_string(ty) + "_" + std::to_string(tx) + ".jpg")).string();
+    if (!cv::imwrite(path, tile, {cv::IMWRITE_JPEG_QUALITY, jpeg_quality_})) {
+        std::cerr << "Error: Could not write tile " << path << "\n";
+        failed_ = true;
+    }
+    tiles_written_++;
+
+    if (level + 1 >= static_cast<int>(level_sizes_.size())) {
+        return !failed_;
+    }
+
+    TiledCanvas& parent = *parents_[level];
+    cv::Mat half;
+    cv::resize(tile, half, cv::Size((tile.cols + 1) / 2, (tile.rows + 1) / 2), 0, 0, cv::INTER_AREA);
+
+    cv::Rect target(tx * tile_size_ / 2, ty * tile_size_ / 2, half.cols, half.rows);
+    target &= cv::Rect(cv::Point(0, 0), parent.size());
+    parent.write(target, half(cv::Rect(0, 0, target.width, target.height)));
+
+    int px = tx / 2, py = ty / 2;
+    int parent_index = py * level_grids_[level + 1].width + px;
+    if (--pending_children_[level][parent_index] == 0) {
+        cv::Mat parent_tile = parent.readTile(px, py);
+        parent.releaseTile(px, py);
+        writeLevelTile(level + 1, px, py, parent_tile);
+    }
+
+    return !failed_;
+}
+
+int TilePyramidWriter::expectedChildren(int level, int px, int py) const {
+    const cv::Size& child_grid = level_grids_[level - 1];
+    int count = 0;
+    for (int dy = 0; dy < 2; dy++) {
+        for (int dx = 0; dx < 2; dx++) {
+            if (2 * px + dx < child_grid.width && 2 * py + dy < child_grid.height) {
+                count++;
+            }
+        }
+    }
+    return count;
+}
@@ -0,0 +1,44 @@
+#ifndef TILE_PYRAMID_WRITER_H
+#define TILE_PYRAMID_WRITER_H
+
+#include <opencv2/core.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+#include "tiled_canvas.h"
+
+// Writes a canvas as a pyramid of JPEG tiles, output_dir/<level>/<row>_<col>.jpg,
+// where level 0 is full resolution and each further level halves it. Tiles
+// may be submitted in any order; a coarser tile is written and dropped as
+// soon as all of its children have arrived.
+class TilePyramidWriter {
+public:
+    TilePyramidWriter(const std::string& output_dir, const cv::Size& canvas_size,
+                      int type, int tile_size = PanoramaConfig::CANVAS_TILE_SIZE,
+                      int jpeg_quality = PanoramaConfig::TILE_JPEG_QUALITY);
+
+    bool writeTile(int tx, int ty, const cv::Mat& tile);
+    bool finish();
+
+    int levels() const { return static_cast<int>(level_sizes_.size()); }
+    int tilesWritten() const { return tiles_written_; }
+
+private:
+    std::string output_dir_;
+    int type_;
+    int tile_size_;
+    int jpeg_quality_;
+    int tiles_written_ = 0;
+    bool failed_ = false;
+
+    std::vector<cv::Size> level_sizes_;
+    std::vector<cv::Size> level_grids_;
+    std::vector<std::unique_ptr<TiledCanvas>> parents_;
+    std::vector<std::vector<int>> pending_children_;
+    std::vector<std::vector<char>> written_;
+
+    bool writeLevelTile(int level, int tx, int ty, const cv::Mat& tile);
+    int expectedChildren(int level, int px, int py) const;
+};
+
+#endif
@@ -0,0 +1,179 @@
+#include "tiled_canvas.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+TiledCanvas::TiledCanvas(const cv::Size& size, int type, int tile_size, size_t cache_bytes)
+    : size_(size), type_(type), tile_size_(tile_size), cache_bytes_(cache_bytes) {
+    if (size.width <= 0 || size.height <= 0 || tile_size <= 0) {
+        throw std::invalid_argument("Invalid tiled canvas geometry");
+    }
+
+    grid_ = cv::Size((size.width + tile_size - 1) / tile_size,
+                     (size.height + tile_size - 1) / tile_size);
+    tiles_.resize(static_cast<size_t>(grid_.width) * grid_.height);
+}
+
+TiledCanvas::~TiledCanvas() {
+    if (!spill_dir_.empty()) {
+        std::error_code ec;
+        fs::remove_all(spill_dir_, ec);
+    }
+}
+
+cv::Rect TiledCanvas::tileRect(int tx, int ty) const {
+    return cv::Rect(tx * tile_size_, ty * tile_size_, tile_size_, tile_size_) &
+           cv::Rect(0, 0, size_.width, size_.height);
+}
+
+cv::Mat TiledCanvas::read(const cv::Rect& roi) {
+    cv::Rect clipped = roi & cv::Rect(0, 0, size_.width, size_.height);
+    cv::Mat result = cv::Mat::zeros(roi.size(), type_);
+    if (clipped.empty()) {
+        return result;
+    }
+
+    int tx0 = clipped.x / tile_size_, tx1 = (clipped.br().x - 1) / tile_size_;
+    int ty0 = clipped.y / tile_size_, ty1 = (clipped.br().y - 1) / tile_size_;
+
+    for (int ty = ty0; ty <= ty1; ty++) {
+        for (int tx = tx0; tx <= tx1; tx++) {
+            int index = ty * grid_.width + tx;
+            if (!tiles_[index].resident && !tiles_[index].spilled) {
+                continue;
+            }
+
+            cv::Rect rect = tileRect(tx, ty);
+            cv::Rect part = rect & clipped;
+            acquire(index)(part - rect.tl()).copyTo(result(part - roi.tl()));
+        }
+    }
+
+    evictIfNeeded();
+
+    return result;
+}
+
+void TiledCanvas::write(const cv::Rect& roi, const cv::Mat& src) {
+    if (src.size() != roi.size() || src.type() != type_) {
+        throw std::invalid_argument("Tiled canvas write does not match region or type");
+    }
+
+    cv::Rect clipped = roi & cv::Rect(0, 0, size_.width, size_.height);
+    if (clipped.empty()) {
+        return;
+    }
+
+    int tx0 = clipped.x / tile_size_, tx1 = (clipped.br().x - 1) / tile_size_;
+    int ty0 = clipped.y / tile_size_, ty1 = (clipped.br().y - 1) / tile_size_;
+
+    for (int ty = ty0; ty <= ty1; ty++) {
+        for (int tx = tx0; tx <= tx1; tx++) {
+            cv::Rect rect = tileRect(tx, ty);
+            cv::Rect part = rect & clipped;
+            int index = ty * grid_.width + tx;
+            src(part - roi.tl()).copyTo(acquire(index)(part - rect.tl()));
+            tiles_[index].dirty = true;
+        }
+    }
+
+    evictIfNeeded();
+}
+
+cv::Mat TiledCanvas::readTile(int tx, int ty) {
+    return read(tileRect(tx, ty));
+}
+
+void TiledCanvas::releaseTile(int tx, int ty) {
+    int index = ty * grid_.width + tx;
+    Tile& tile = tiles_[index];
+
+    if (tile.resident) {
+        resident_bytes_ -= tile.data.total() * tile.data.elemSize();
+        lru_.erase(tile.lru_pos);
+        tile.data.release();
+        tile.resident = false;
+        tile.dirty = false;
+    }
+
+    if (tile.spilled) {
+        std::error_code ec;
+        fs::remove(spillPath(index), ec);
+        tile.spilled = false;
+    }
+}
+
+cv::Mat& TiledCanvas::acquire(int index) {
+    Tile& tile = tiles_[index];
+
+    if (tile.resident) {
+        touch(index);
+        return tile.data;
+    }
+
+    cv::Rect rect = tileRect(index % grid_.width, index / grid_.width);
+    tile.data = cv::Mat::zeros(rect.size(), type_);
+
+    if (tile.spilled) {
+        std::ifstream in(spillPath(index), std::ios::binary);
+        in.read(reinterpret_cast<char*>(tile.data.data),
+                static_cast<std::streamsize>(tile.data.total() * tile.data.elemSize()));
+        if (!in) {
+            std::cerr << "Warning: Could not reload canvas tile " << index << "\n";
+        }
+    }
+
+    tile.resident = true;
+    resident_bytes_ += tile.data.total() * tile.data.elemSize();
+    lru_.push_front(index);
+    tile.lru_pos = lru_.begin();
+
+    return tile.data;
+}
+
+void TiledCanvas::touch(int index) {
+    lru_.splice(lru_.begin(), lru_, tiles_[index].lru_pos);
+}
+
+void TiledCanvas::evictIfNeeded() {
+    while (resident_bytes_ > cache_bytes_ && lru_.size() > 1) {
+        int index = lru_.back();
+        Tile& tile = tiles_[index];
+
+        if (spill_dir_.empty()) {
+            std::random_device rd;
+            fs::path dir = fs::temp_directory_path() / ("panorama_tiles_" + std::to_string(rd()));
+            fs::create_directories(dir);
+            spill_dir_ = dir.string();
+        }
+
+        if (tile.dirty || !tile.spilled) {
+            std::ofstream out(spillPath(index), std::ios::binary | std::ios::trunc);
+            out.write(reinterpret_cast<const char*>(tile.data.data),
+                      static_cast<std::streamsize>(tile.data.total() * tile.data.elemSize()));
+            if (!out) {
+                throw std::runtime_error("Could not spill canvas tile to " + spillPath(index));
+            }
+
+            if (!tile.spilled) {
+                spill_count_++;
+            }
+            tile.spilled = true;
+            tile.dirty = false;
+        }
+
+        resident_bytes_ -= tile.data.total() * tile.data.elemSize();
+        tile.data.release();
+        tile.resident = false;
+        lru_.pop_back();
+    }
+}
+
+std::string TiledCanvas::spillPath(int index) const {
+    return spill_dir_ + "/" + std::to_string(index) + ".raw";
+}
@@ -0,0 +1,65 @@
+#ifndef TILED_CANVAS_H
+#define TILED_CANVAS_H
+
+#include <opencv2/core.hpp>
+#include <list>
+#include <string>
+#include <vector>
+#include "../config.h"
+
+// Large canvas stored as fixed-size tiles. At most cache_bytes worth of
+// tiles stay resident; the least recently used ones are spilled to raw
+// files in a private temporary directory. Tiles that were never written
+// read back as zeros without being allocated.
+class TiledCanvas {
+public:
+    TiledCanvas(const cv::Size& size, int type,
+                int tile_size = PanoramaConfig::CANVAS_TILE_SIZE,
+                size_t cache_bytes = static_cast<size_t>(PanoramaConfig::CANVAS_CACHE_MB) * 1048576);
+    ~TiledCanvas();
+
+    TiledCanvas(const TiledCanvas&) = delete;
+    TiledCanvas& operator=(const TiledCanvas&) = delete;
+
+    cv::Size size() const { return size_; }
+    int type() const { return type_; }
+    int tileSize() const { return tile_size_; }
+    cv::Size gridSize() const { return grid_; }
+    cv::Rect tileRect(int tx, int ty) const;
+
+    cv::Mat read(const cv::Rect& roi);
+    void write(const cv::Rect& roi, const cv::Mat& src);
+
+    cv::Mat readTile(int tx, int ty);
+    void releaseTile(int tx, int ty);
+
+    int spilledTiles() const { return spill_count_; }
+
+private:
+    struct Tile {
+        cv::Mat data;
+        bool spilled = false;
+        bool resident = false;
+        bool dirty = false;
+        std::list<int>::iterator lru_pos;
+    };
+
+    cv::Size size_;
+    int type_;
+    int tile_size_;
+    size_t cache_bytes_;
+    size_t resident_bytes_ = 0;
+    cv::Size grid_;
+
+    std::vector<Tile> tiles_;
+    std::list<int> lru_;
+    std::string spill_dir_;
+    int spill_count_ = 0;
+
+    cv::Mat& acquire(int index);
+    void touch(int index);
+    void evictIfNeeded();
+    std::string spillPath(int index) const;
+};
+
+#endif